@@ -0,0 +1,167 @@
+#include "AsyncLogSink.h"
+#include <chrono>
+#include <cstring>
+
+namespace vw {
+	static const char LOGGER_NAME[] = "Main";
+	static const char TRUNCATED[] = "...";
+
+	static size_t RoundUpToPowerOfTwo(size_t value)
+	{
+		size_t result = 2;
+		while (result < value) result *= 2;
+		return result;
+	}
+
+	AsyncLogSink::AsyncLogSink(std::shared_ptr<spdlog::sinks::sink> target, size_t capacity) :
+		m_target(target),
+		m_ring(RoundUpToPowerOfTwo(capacity)),
+		m_mask(m_ring.size() - 1),
+		m_enqueuePosition(0),
+		m_enqueuePadding(),
+		m_dequeuePosition(0),
+		m_dropped(0),
+		m_flushRequested(false),
+		m_stopping(false)
+	{
+		for (size_t i = 0; i < m_ring.size(); i++) m_ring[i].sequence.store(i, std::memory_order_relaxed);
+		std::thread t(&AsyncLogSink::WriterThreadFunction, this);
+		m_writerThread.swap(t);
+	}
+
+	AsyncLogSink::~AsyncLogSink()
+	{
+		//everything logged before is written
+		m_stopping.store(true);
+		m_wakeCondition.notify_one();
+		m_writerThread.join();
+	}
+
+	//bounded multi-producer queue, every cell has sequence telling whose turn it is
+	void AsyncLogSink::log(const spdlog::details::log_msg & msg)
+	{
+		size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+		Record* record;
+		while (true)
+		{
+			record = &m_ring[position & m_mask];
+			size_t sequence = record->sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+			if (difference == 0)
+			{
+				if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+			}
+			else if (difference < 0)
+			{
+				//full, writer is behind
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			else position = m_enqueuePosition.load(std::memory_order_relaxed);
+		}
+
+		record->time = msg.time;
+		record->threadId = msg.thread_id;
+		record->level = msg.level;
+		size_t length = msg.payload.size();
+		if (length > MAX_TEXT)
+		{
+			//whole receive buffers do not fit, end is marked
+			const size_t kept = MAX_TEXT - (sizeof(TRUNCATED) - 1);
+			std::memcpy(record->text, msg.payload.data(), kept);
+			std::memcpy(record->text + kept, TRUNCATED, sizeof(TRUNCATED) - 1);
+			length = MAX_TEXT;
+		}
+		else std::memcpy(record->text, msg.payload.data(), length);
+		record->length = (uint16_t)length;
+		record->sequence.store(position + 1, std::memory_order_release);
+	}
+
+	void AsyncLogSink::flush()
+	{
+		m_flushRequested.store(true, std::memory_order_relaxed);
+		m_wakeCondition.notify_one();
+	}
+
+	void AsyncLogSink::set_pattern(const std::string & pattern)
+	{
+		m_target->set_pattern(pattern);
+	}
+
+	void AsyncLogSink::set_formatter(std::unique_ptr<spdlog::formatter> sinkFormatter)
+	{
+		m_target->set_formatter(std::move(sinkFormatter));
+	}
+
+	size_t AsyncLogSink::GetDroppedCount() const
+	{
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+
+	bool AsyncLogSink::Pop(Record *& record)
+	{
+		record = &m_ring[m_dequeuePosition & m_mask];
+		size_t sequence = record->sequence.load(std::memory_order_acquire);
+		return sequence == m_dequeuePosition + 1;
+	}
+
+	void AsyncLogSink::Release(Record & record)
+	{
+		record.sequence.store(m_dequeuePosition + m_ring.size(), std::memory_order_release);
+		m_dequeuePosition++;
+	}
+
+	void AsyncLogSink::WriterThreadFunction()
+	{
+		size_t droppedReported = 0;
+		while (true)
+		{
+			bool stopping = m_stopping.load();
+			size_t written = 0;
+			Record* record;
+			while (Pop(record))
+			{
+				spdlog::details::log_msg msg(spdlog::source_loc(), spdlog::string_view_t(LOGGER_NAME, sizeof(LOGGER_NAME) - 1),
+					record->level, spdlog::string_view_t(record->text, record->length));
+				msg.time = record->time;
+				msg.thread_id = record->threadId;
+				try
+				{
+					m_target->log(msg);
+				}
+				catch (...)
+				{
+					//nowhere to report, message is lost
+				}
+				Release(*record);
+				written++;
+			}
+
+			size_t dropped = m_dropped.load(std::memory_order_relaxed);
+			if (dropped != droppedReported)
+			{
+				std::string text = std::to_string(dropped - droppedReported) + " log messages dropped, writer was behind";
+				spdlog::details::log_msg msg(spdlog::string_view_t(LOGGER_NAME, sizeof(LOGGER_NAME) - 1), spdlog::level::warn, text);
+				m_target->log(msg);
+				droppedReported = dropped;
+				written++;
+			}
+
+			//one flush per burst instead of one per message
+			if (written != 0 || m_flushRequested.exchange(false))
+			{
+				try
+				{
+					m_target->flush();
+				}
+				catch (...)
+				{
+				}
+			}
+			if (stopping) break;
+
+			std::unique_lock<std::mutex> lock(m_wakeMutex);
+			m_wakeCondition.wait_for(lock, std::chrono::milliseconds(20), [this] { return m_flushRequested.load() || m_stopping.load(); });
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "spdlog/sinks/sink.h"
+
+namespace vw {
+	//messages are copied into a lock-free ring by logging threads and written to file by own thread,
+	//so logging in packet and frame code does not wait for disk. When ring is full messages are dropped and counted
+	class AsyncLogSink : public spdlog::sinks::sink
+	{
+	public:
+		//capacity is rounded up to power of 2
+		AsyncLogSink(std::shared_ptr<spdlog::sinks::sink> target, size_t capacity);
+		~AsyncLogSink();
+
+		void log(const spdlog::details::log_msg& msg) override;
+		//does not wait, writer wakes up and flushes file, called by logger for errors
+		void flush() override;
+		void set_pattern(const std::string& pattern) override;
+		void set_formatter(std::unique_ptr<spdlog::formatter> sinkFormatter) override;
+
+		size_t GetDroppedCount() const;
+
+	private:
+		static const size_t MAX_TEXT = 480;  //longer messages are cut
+
+		struct Record
+		{
+			std::atomic<size_t> sequence;
+			spdlog::log_clock::time_point time;
+			size_t threadId;
+			spdlog::level::level_enum level;
+			uint16_t length;
+			char text[MAX_TEXT];
+		};
+
+		bool Pop(Record*& record);
+		void Release(Record& record);
+		void WriterThreadFunction();
+
+		std::shared_ptr<spdlog::sinks::sink> m_target;
+		std::vector<Record> m_ring;
+		const size_t m_mask;
+		//producers and writer positions on different cache lines
+		std::atomic<size_t> m_enqueuePosition;
+		char m_enqueuePadding[64 - sizeof(std::atomic<size_t>)];
+		size_t m_dequeuePosition;
+		std::atomic<size_t> m_dropped;
+		std::atomic<bool> m_flushRequested;
+		std::atomic<bool> m_stopping;
+		std::mutex m_wakeMutex;
+		std::condition_variable m_wakeCondition;
+		std::thread m_writerThread;
+	};
+}
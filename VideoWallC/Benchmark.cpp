@@ -0,0 +1,432 @@
+#include "Benchmark.h"
+#include "Log.h"
+#include "FieldsManager.h"
+#include "SoftwareRenderBackend.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <Windows.h>
+#include <Psapi.h>
+
+static const unsigned int KERNEL_CANVAS_WIDTH = 1920;
+static const unsigned int KERNEL_CANVAS_HEIGHT = 1080;
+
+//board cells, text size is $1F (16 pixels)
+static const unsigned int CELL_WIDTH = 120;
+static const unsigned int CELL_HEIGHT = 20;
+static const unsigned int MAX_COORDINATE = 999;  //3 digit coordinates of protocol
+static const unsigned int MAX_COORDINATE_WALL = 9999;  //Wall.CoordinateDigits=4
+static const sf::Int64 FRAME_MICRO = 16667;  //60 FPS
+static const std::chrono::seconds RASTER_TIMEOUT(60);
+
+Benchmark::Benchmark(INIFile* settingsObject) :
+	m_pSettings(settingsObject),
+	m_iterations(std::max(settingsObject->GetUInt(S_BENCHMARKITERATIONS), 1u)),
+	m_random(1251)
+{
+}
+
+bool Benchmark::Run(const std::string & mode)
+{
+	LOG_INFO("Benchmark started with mode={0}, iterations={1}", mode, m_iterations);
+	//debug logging of every command would be measured instead of rendering
+	vw::Log::SetLogLevel(spdlog::level::info);
+
+	if (mode == "kernels") RunKernels();
+	else if (mode == "render")
+	{
+		RunRender();
+		RunCompositeScaling();
+	}
+	else if (mode == "all")
+	{
+		RunKernels();
+		RunRender();
+		RunCompositeScaling();
+	}
+	else
+	{
+		LOG_ERROR("Unknown benchmark mode={}", mode);
+		return false;
+	}
+	LOG_INFO("Benchmark finished");
+	return true;
+}
+
+void Benchmark::RunKernels()
+{
+	const int pixelCount = int(KERNEL_CANVAS_WIDTH * KERNEL_CANVAS_HEIGHT);
+	std::mt19937 random(1251);
+
+	//field bitmap with all 16 transparency levels of $T/$H, in blocks like real fields
+	const uint32_t transparencyArray[16] = { 0, 17, 34, 51, 68, 85, 102, 119, 136, 153, 170, 187, 204, 221, 238, 255 };
+	std::vector<sf::Uint8> source(size_t(pixelCount) * 4);
+	for (unsigned int y = 0; y < KERNEL_CANVAS_HEIGHT; y++)
+	{
+		for (unsigned int x = 0; x < KERNEL_CANVAS_WIDTH; x++)
+		{
+			sf::Uint8* pixel = &source[(size_t(y) * KERNEL_CANVAS_WIDTH + x) * 4];
+			pixel[0] = sf::Uint8(random());
+			pixel[1] = sf::Uint8(random());
+			pixel[2] = sf::Uint8(random());
+			pixel[3] = sf::Uint8(transparencyArray[(x / 64 + y / 32) % 16]);
+		}
+	}
+
+	//glyph coverage, about half of pixels are empty
+	std::vector<sf::Uint8> coverage(pixelCount);
+	for (sf::Uint8& value : coverage) value = (random() % 2 == 0) ? 0 : sf::Uint8(random());
+
+	std::vector<sf::Uint8> reference(size_t(pixelCount) * 4);
+	const KernelResult scalar = MeasureKernels(*BlendKernels::GetLevel(BlendKernels::Level::Scalar), source, coverage, reference);
+
+	Report(fmt::format("Blend kernels, canvas {0}x{1}, {2} iterations, selected={3}",
+		KERNEL_CANVAS_WIDTH, KERNEL_CANVAS_HEIGHT, m_iterations, BlendKernels::Get().name));
+	Report("kernels  fill ms  blend ms  coverage ms  fill x  blend x  coverage x  exact");
+	const std::pair<BlendKernels::Level, const char*> levels[] = {
+		{ BlendKernels::Level::Scalar, "Scalar" },
+		{ BlendKernels::Level::SSE2, "SSE2" },
+		{ BlendKernels::Level::AVX2, "AVX2" } };
+	for (const auto& levelName : levels)
+	{
+		BlendKernels::Level level = levelName.first;
+		const BlendKernels* kernels = BlendKernels::GetLevel(level);
+		if (kernels == nullptr)
+		{
+			Report(fmt::format("{:<7}  not supported by CPU", levelName.second));
+			continue;
+		}
+
+		std::vector<sf::Uint8> canvas(reference.size());
+		KernelResult result = (level == BlendKernels::Level::Scalar) ? scalar : MeasureKernels(*kernels, source, coverage, canvas);
+		bool exact = (level == BlendKernels::Level::Scalar) || (canvas == reference);
+		Report(fmt::format("{0:<7}  {1:7.3f}  {2:8.3f}  {3:11.3f}  {4:6.2f}  {5:7.2f}  {6:10.2f}  {7}",
+			kernels->name, result.fillMs, result.blendMs, result.coverageMs,
+			scalar.fillMs / result.fillMs, scalar.blendMs / result.blendMs, scalar.coverageMs / result.coverageMs,
+			exact ? "yes" : "NO"));
+	}
+}
+
+Benchmark::KernelResult Benchmark::MeasureKernels(const BlendKernels & kernels, const std::vector<sf::Uint8>& source,
+	const std::vector<sf::Uint8>& coverage, std::vector<sf::Uint8>& canvas)
+{
+	typedef std::chrono::duration<double, std::milli> Milliseconds;
+	const sf::Color fillColor(16, 32, 64, 255);
+	const sf::Color textColor(255, 200, 0, 221);
+	Milliseconds fill(0), blend(0), blendCoverage(0);
+
+	//every iteration is fill, field bitmap, text over it, row by row like the compositor does
+	for (unsigned int i = 0; i < m_iterations; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned int y = 0; y < KERNEL_CANVAS_HEIGHT; y++)
+			kernels.FillRow(&canvas[size_t(y) * KERNEL_CANVAS_WIDTH * 4], fillColor, KERNEL_CANVAS_WIDTH);
+		auto filled = std::chrono::steady_clock::now();
+		for (unsigned int y = 0; y < KERNEL_CANVAS_HEIGHT; y++)
+			kernels.BlendRow(&canvas[size_t(y) * KERNEL_CANVAS_WIDTH * 4], &source[size_t(y) * KERNEL_CANVAS_WIDTH * 4], KERNEL_CANVAS_WIDTH);
+		auto blended = std::chrono::steady_clock::now();
+		for (unsigned int y = 0; y < KERNEL_CANVAS_HEIGHT; y++)
+			kernels.BlendCoverageRow(&canvas[size_t(y) * KERNEL_CANVAS_WIDTH * 4], &coverage[size_t(y) * KERNEL_CANVAS_WIDTH], textColor, KERNEL_CANVAS_WIDTH);
+		auto finish = std::chrono::steady_clock::now();
+
+		fill += filled - start;
+		blend += blended - filled;
+		blendCoverage += finish - blended;
+	}
+
+	KernelResult result;
+	result.fillMs = fill.count() / m_iterations;
+	result.blendMs = blend.count() / m_iterations;
+	result.coverageMs = blendCoverage.count() / m_iterations;
+	return result;
+}
+
+void Benchmark::RunRender()
+{
+	const sf::Vector2u resolutions[] = { {640, 480}, {1024, 768}, {1280, 720}, {1920, 1080}, {2560, 1440}, {3840, 2160} };
+
+	Report(fmt::format("Render benchmark, software backend, {0} frames of {1} us, {2} raster threads, font={3}",
+		m_iterations, FRAME_MICRO, m_pSettings->GetUInt(S_RASTERTHREADS), m_pSettings->GetString(S_DEFAULTFONT)));
+	Report(fmt::format("Fields are {0}x{1} cells, coordinates are limited to 0..{2} by protocol", CELL_WIDTH, CELL_HEIGHT, MAX_COORDINATE));
+	Report("resolution  text/run/rect/clock  parse ms  raster ms  refresh ms  restart ms  create us/field  update us mean/p99  draw us mean/p99  max fps  memory B/field  bitmaps B/field");
+	for (const sf::Vector2u& resolution : resolutions)
+	{
+		//quarter, half and full board
+		unsigned int rows = (std::min(resolution.y, MAX_COORDINATE + 1)) / CELL_HEIGHT;
+		for (unsigned int usedRows : { rows / 4, rows / 2, rows })
+		{
+			BoardDescription board = { resolution.x, resolution.y, std::max(usedRows, 1u), 3 };
+			BoardResult result = MeasureBoard(board);
+
+			size_t fields = std::max(result.fieldsCreated, (size_t)1);
+			double createMicro = (result.parseMs + result.rasterMs) * 1000.0 / fields;
+			double frameMicro = result.updateMicro.GetMean() + result.drawMicro.GetMean();
+			Report(fmt::format("{0:>4}x{1:<5}  {2:>4}/{3:>3}/{4:>4}/{5:>5}  {6:8.2f}  {7:9.2f}  {8:10.2f}  {9:10.2f}  {10:15.1f}  {11:>8.1f}/{12:<8}  {13:>7.1f}/{14:<8}  {15:7.0f}  {16:14}  {17:15}",
+				resolution.x, resolution.y, result.textFields, result.runningFields, result.rectangles, result.clockFields,
+				result.parseMs, result.rasterMs, result.refreshMs, result.restartMs, createMicro,
+				result.updateMicro.GetMean(), result.updateMicro.GetPercentile(99),
+				result.drawMicro.GetMean(), result.drawMicro.GetPercentile(99),
+				(frameMicro > 0) ? 1000000.0 / frameMicro : 0.0,
+				result.memoryBytes / (int64_t)fields, result.bitmapBytes / fields));
+			if (result.fieldsCreated != result.textFields + result.runningFields + result.rectangles + result.clockFields)
+				Report(fmt::format("  WARNING: {0} fields created from {1} commands", result.fieldsCreated,
+					result.textFields + result.runningFields + result.rectangles + result.clockFields));
+			if (result.fieldsRestored != result.fieldsCreated)
+				Report(fmt::format("  WARNING: {0} of {1} fields restored after restart", result.fieldsRestored, result.fieldsCreated));
+		}
+	}
+}
+
+Benchmark::BoardResult Benchmark::MeasureBoard(const BoardDescription & board)
+{
+	typedef std::chrono::duration<double, std::milli> Milliseconds;
+	BoardResult result;
+	std::vector<std::string> packets = BuildBoardPackets(board, result);
+
+	//manager reads screen size for bounds check and fallback
+	m_pSettings->SetUInt(S_CUSTOMWIDTH, board.width);
+	m_pSettings->SetUInt(S_CUSTOMHEIGHT, board.height);
+	m_pSettings->SetUInt(S_WALLCOORDINATEDIGITS, board.coordinateDigits);
+	//scene is saved while board is shown, restart restores it
+	const std::string sceneFile = "benchmark.snapshot";
+	std::remove(sceneFile.c_str());
+	m_pSettings->SetString(S_SCENEFILE, sceneFile);
+	TimerWheel timers;
+	std::unique_ptr<FieldsManager> manager(new FieldsManager("", 19200, m_pSettings, &timers));
+	SoftwareRenderBackend backend(board.width, board.height, 0, m_pSettings->GetUInt(S_COMPOSITETHREADS));
+	int64_t memoryBefore = GetProcessMemory();
+
+	//field creation, parsing and first rendering of text
+	auto start = std::chrono::steady_clock::now();
+	for (const std::string& packet : packets) manager->ExecutePacket(packet);
+	auto parsed = std::chrono::steady_clock::now();
+	while (manager->GetRenderPendingCount() != 0 && std::chrono::steady_clock::now() - parsed < RASTER_TIMEOUT)
+	{
+		manager->UpdateFields(backend, 0, false);
+		std::this_thread::yield();
+	}
+	auto rasterized = std::chrono::steady_clock::now();
+	if (manager->GetRenderPendingCount() != 0) LOG_ERROR("Not all fields rendered in {} seconds", RASTER_TIMEOUT.count());
+
+	//controllers refresh with delete all and the same layout, fields should be reused
+	std::string refreshCommands = "%23";
+	for (const std::string& packet : packets) refreshCommands += packet.substr(5, packet.size() - 8);
+	std::string refreshPacket = MakePacket(refreshCommands);
+	auto refreshStart = std::chrono::steady_clock::now();
+	manager->ExecutePacket(refreshPacket);
+	while (manager->GetRenderPendingCount() != 0 && std::chrono::steady_clock::now() - refreshStart < RASTER_TIMEOUT)
+	{
+		manager->UpdateFields(backend, 0, false);
+		std::this_thread::yield();
+	}
+	result.refreshMs = Milliseconds(std::chrono::steady_clock::now() - refreshStart).count();
+
+	result.fieldsCreated = manager->GetFieldCount();
+	result.parseMs = Milliseconds(parsed - start).count();
+	result.rasterMs = Milliseconds(rasterized - parsed).count();
+	result.memoryBytes = GetProcessMemory() - memoryBefore;
+	result.bitmapBytes = manager->GetTextCacheStatistics().memoryUsed;
+
+	//frames as main cycle does them, every frame is drawn
+	for (unsigned int i = 0; i < m_iterations; i++)
+	{
+		auto frameStart = std::chrono::steady_clock::now();
+		timers.Advance(FRAME_MICRO);
+		manager->UpdateFields(backend, FRAME_MICRO, false);
+		auto updated = std::chrono::steady_clock::now();
+		backend.Clear(sf::Color::Black);
+		manager->DrawFields(backend);
+		backend.Display();
+		auto drawn = std::chrono::steady_clock::now();
+
+		result.updateMicro.Record(std::chrono::duration_cast<std::chrono::microseconds>(updated - frameStart).count());
+		result.drawMicro.Record(std::chrono::duration_cast<std::chrono::microseconds>(drawn - updated).count());
+	}
+
+	//program restart, until saved board is on screen again
+	manager.reset();
+	auto restartStart = std::chrono::steady_clock::now();
+	manager.reset(new FieldsManager("", 19200, m_pSettings, &timers));
+	while (manager->GetRenderPendingCount() != 0 && std::chrono::steady_clock::now() - restartStart < RASTER_TIMEOUT)
+	{
+		manager->UpdateFields(backend, 0, false);
+		std::this_thread::yield();
+	}
+	result.restartMs = Milliseconds(std::chrono::steady_clock::now() - restartStart).count();
+	result.fieldsRestored = manager->GetFieldCount();
+	manager.reset();
+	std::remove(sceneFile.c_str());
+
+	return result;
+}
+
+void Benchmark::RunCompositeScaling()
+{
+	const BoardDescription board = { 3840, 2160, 2160 / CELL_HEIGHT, 4 };
+
+	m_pSettings->SetUInt(S_CUSTOMWIDTH, board.width);
+	m_pSettings->SetUInt(S_CUSTOMHEIGHT, board.height);
+	m_pSettings->SetUInt(S_WALLCOORDINATEDIGITS, board.coordinateDigits);
+	m_pSettings->SetString(S_SCENEFILE, "");
+	BoardResult counts;
+	std::vector<std::string> packets = BuildBoardPackets(board, counts);
+	TimerWheel timers;
+	FieldsManager manager("", 19200, m_pSettings, &timers);
+	SoftwareRenderBackend reference(board.width, board.height, 0, 1);
+	for (const std::string& packet : packets) manager.ExecutePacket(packet);
+	auto parsed = std::chrono::steady_clock::now();
+	while (manager.GetRenderPendingCount() != 0 && std::chrono::steady_clock::now() - parsed < RASTER_TIMEOUT)
+	{
+		manager.UpdateFields(reference, 0, false);
+		std::this_thread::yield();
+	}
+	//one state of running texts for all measurements, so frames can be compared
+	timers.Advance(FRAME_MICRO);
+	manager.UpdateFields(reference, FRAME_MICRO, false);
+
+	std::vector<unsigned int> threadCounts;
+	const unsigned int cores = std::max(std::thread::hardware_concurrency(), 1u);
+	for (unsigned int threads = 1; threads < cores; threads *= 2) threadCounts.push_back(threads);
+	threadCounts.push_back(cores);
+
+	Report(fmt::format("Composite scaling, {0}x{1} board with {2} fields, {3} frames, bands of frame on 1 to {4} threads",
+		board.width, board.height, manager.GetFieldCount(), m_iterations, cores));
+	Report("threads  draw ms mean/p99  speedup  efficiency  exact");
+	double singleMs = 0;
+	for (unsigned int threads : threadCounts)
+	{
+		SoftwareRenderBackend backend(board.width, board.height, 0, threads);
+		Histogram drawMicro;
+		for (unsigned int i = 0; i <= m_iterations; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			backend.Clear(sf::Color::Black);
+			manager.DrawFields(backend);
+			backend.Display();
+			//first frame warms up caches and threads
+			if (i != 0) drawMicro.Record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+		}
+		if (threads == 1)
+		{
+			singleMs = drawMicro.GetMean() / 1000.0;
+			reference.Clear(sf::Color::Black);
+			manager.DrawFields(reference);
+			reference.Display();
+		}
+		double meanMs = drawMicro.GetMean() / 1000.0;
+		double speedup = (meanMs > 0) ? singleMs / meanMs : 0.0;
+		Report(fmt::format("{0:7}  {1:>8.2f}/{2:<8.2f}  {3:7.2f}  {4:9.0f}%  {5}",
+			threads, meanMs, drawMicro.GetPercentile(99) / 1000.0, speedup, speedup * 100.0 / threads,
+			(backend.GetFramebuffer() == reference.GetFramebuffer()) ? "yes" : "NO"));
+	}
+	m_pSettings->SetUInt(S_WALLCOORDINATEDIGITS, 3);
+}
+
+std::vector<std::string> Benchmark::BuildBoardPackets(const BoardDescription & board, BoardResult & result)
+{
+	enum CellType { Text, Running, Rectangle, Clock };
+	//timetable like row: number, destination, note, time, separator
+	const CellType ROW_PATTERN[] = { Text, Running, Text, Clock, Rectangle };
+	const size_t PATTERN_SIZE = sizeof(ROW_PATTERN) / sizeof(ROW_PATTERN[0]);
+
+	result.textFields = 0;
+	result.runningFields = 0;
+	result.rectangles = 0;
+	result.clockFields = 0;
+
+	const unsigned int maxCoordinate = (board.coordinateDigits == 4) ? MAX_COORDINATE_WALL : MAX_COORDINATE;
+	const unsigned int areaWidth = std::min(board.width, maxCoordinate + 1);
+	const unsigned int areaHeight = std::min(board.height, maxCoordinate + 1);
+	const unsigned int rows = std::min(board.usedRows, areaHeight / CELL_HEIGHT);
+
+	std::vector<std::string> packets;
+	for (unsigned int row = 0; row < rows; row++)
+	{
+		std::string commands;
+		unsigned int x = 0;
+		const unsigned int y1 = row * CELL_HEIGHT;
+		const unsigned int y2 = y1 + CELL_HEIGHT - 2;  //1 pixel between rows
+		for (size_t cell = 0; ; cell++)
+		{
+			CellType type = ROW_PATTERN[cell % PATTERN_SIZE];
+			unsigned int width = (type == Running) ? CELL_WIDTH * 2 : (type == Rectangle) ? CELL_WIDTH / 4 : CELL_WIDTH;
+			if (x + width > areaWidth) break;
+			const unsigned int x1 = x;
+			const unsigned int x2 = x + width - 2;
+			x += width;
+
+			std::string coordinates = fmt::format("{0:0{4}}{1:0{4}}{2:0{4}}{3:0{4}}", x1, x2, y1, y2, board.coordinateDigits);
+			uint32_t color = (m_random() & 0xFFFFFF) | 0x404040;
+			switch (type)
+			{
+			case Text:
+				commands += "%04" + coordinates + "4%10$1F$60$t2" + fmt::format("$f1{0:06X}$h1000040$TF$HF", color) +
+					((cell % 2 == 0) ? std::to_string(6000 + m_random() % 1000) : MakeCyrillicText(1));
+				result.textFields++;
+				break;
+			case Running:
+				commands += "%04" + coordinates + "4%10$1F$60$t3" + fmt::format("$f1{0:06X}$h1000000$TF$HF", color) + MakeCyrillicText(8);
+				result.runningFields++;
+				break;
+			case Rectangle:
+				//translucent, exercises blending
+				commands += "%45" + coordinates + fmt::format("1{0:06X}8", color);
+				result.rectangles++;
+				break;
+			case Clock:
+				commands += "%04" + coordinates + "u%1u$t2$1F$f1FF8000$h1000000$TF$HF$u30";
+				result.clockFields++;
+				break;
+			}
+		}
+		packets.push_back(MakePacket(commands));
+	}
+	return packets;
+}
+
+std::string Benchmark::MakePacket(const std::string & commands)
+{
+	//STX, address, length, commands, CRC, ETX
+	std::string packet;
+	packet += (char)2;
+	packet += fmt::format("{0:02X}{1:02X}", m_pSettings->GetUInt(S_TABLONUMBER) & 0xFF, commands.size() & 0xFF);
+	packet += commands;
+
+	unsigned char crc = 0;
+	for (size_t i = 1; i < packet.size(); i++) crc ^= packet[i];
+	crc ^= 0xFF;
+	packet += fmt::format("{0:02X}", crc);
+	packet += (char)3;
+	return packet;
+}
+
+std::string Benchmark::MakeCyrillicText(size_t words)
+{
+	//CP1251: 0xC0-0xDF capital letters, 0xE0-0xFF small letters
+	std::string text;
+	for (size_t i = 0; i < words; i++)
+	{
+		if (i != 0) text += ' ';
+		size_t length = 3 + m_random() % 8;
+		text += (char)(0xC0 + m_random() % 32);
+		for (size_t j = 1; j < length; j++) text += (char)(0xE0 + m_random() % 32);
+	}
+	return text;
+}
+
+int64_t Benchmark::GetProcessMemory()
+{
+	PROCESS_MEMORY_COUNTERS_EX counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters)) == FALSE) return 0;
+	return (int64_t)counters.PrivateUsage;
+}
+
+void Benchmark::Report(const std::string & line)
+{
+	//console is the main output, log keeps a copy
+	std::cout << line << std::endl;
+	LOG_INFO(line);
+}
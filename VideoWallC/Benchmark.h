@@ -0,0 +1,75 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <random>
+#include "INIFile.h"
+#include "BlendKernels.h"
+#include "Statistics.h"
+
+//performance measurements started from command line instead of normal work
+//VideoWallC.exe --Benchmark.Mode=kernels|render|all
+class Benchmark
+{
+public:
+	Benchmark(INIFile* settingsObject);
+
+	//false if mode is unknown
+	bool Run(const std::string& mode);
+
+private:
+	//average milliseconds per full canvas pass
+	struct KernelResult
+	{
+		double fillMs;
+		double blendMs;
+		double coverageMs;
+	};
+
+	void RunKernels();
+	KernelResult MeasureKernels(const BlendKernels& kernels, const std::vector<sf::Uint8>& source,
+		const std::vector<sf::Uint8>& coverage, std::vector<sf::Uint8>& canvas);
+
+	//synthetic board, fields are created with protocol commands like from serial port
+	struct BoardDescription
+	{
+		unsigned int width;
+		unsigned int height;
+		unsigned int usedRows;  //rows of field cells
+		unsigned int coordinateDigits;  //3 as in LDP, 4 to fill canvas bigger than 999
+	};
+
+	struct BoardResult
+	{
+		size_t textFields;
+		size_t runningFields;
+		size_t rectangles;
+		size_t clockFields;
+		size_t fieldsCreated;
+		double parseMs;
+		double rasterMs;
+		//%23 and the same layout again in one packet, until everything is rendered
+		double refreshMs;
+		//new manager restoring saved scene, until everything is rendered
+		double restartMs;
+		size_t fieldsRestored;
+		Histogram updateMicro;
+		Histogram drawMicro;
+		int64_t memoryBytes;
+		size_t bitmapBytes;
+	};
+
+	void RunRender();
+	BoardResult MeasureBoard(const BoardDescription& board);
+	//draw time of 4K board with 1 to all cores compositing bands
+	void RunCompositeScaling();
+	std::vector<std::string> BuildBoardPackets(const BoardDescription& board, BoardResult& result);
+	std::string MakePacket(const std::string& commands);
+	std::string MakeCyrillicText(size_t words);
+	static int64_t GetProcessMemory();
+
+	void Report(const std::string& line);
+
+	INIFile* m_pSettings;
+	unsigned int m_iterations;
+	std::mt19937 m_random;
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+//picture in CPU memory, render backend decides if it needs a texture
+struct Bitmap
+{
+	std::vector<sf::Uint8> pixels;  //RGBA, not premultiplied
+	unsigned int width;
+	unsigned int height;
+	bool repeated;
+	bool streamed;  //frames of a clip, pixels are kept and texture is updated in place
+	sf::Texture texture;  //created by window backend on render thread
+
+	Bitmap() : pixels(), width(0), height(0), repeated(false), streamed(false), texture() {}
+
+	size_t GetMemorySize() const
+	{
+		sf::Vector2u size = texture.getSize();
+		return pixels.capacity() + size_t(size.x) * size.y * 4;
+	}
+};
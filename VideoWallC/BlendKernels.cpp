@@ -0,0 +1,226 @@
+#include "BlendKernels.h"
+#include "Log.h"
+#include <cstring>
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+//defined in BlendKernelsAVX2.cpp, compiled with AVX2 enabled
+void FillRowAVX2(sf::Uint8* destination, const sf::Color& color, int count);
+void BlendRowAVX2(sf::Uint8* destination, const sf::Uint8* source, int count);
+void BlendCoverageRowAVX2(sf::Uint8* destination, const sf::Uint8* coverage, const sf::Color& color, int count);
+
+//x / 255 rounded to nearest, exact for 0..65535
+static inline uint32_t Div255(uint32_t x)
+{
+	return (x + 127) / 255;
+}
+
+static void FillRowScalar(sf::Uint8 * destination, const sf::Color & color, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		destination[i * 4 + 0] = color.r;
+		destination[i * 4 + 1] = color.g;
+		destination[i * 4 + 2] = color.b;
+		destination[i * 4 + 3] = color.a;
+	}
+}
+
+static void BlendRowScalar(sf::Uint8 * destination, const sf::Uint8 * source, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		const sf::Uint8* src = source + i * 4;
+		sf::Uint8* dst = destination + i * 4;
+		uint32_t srcA = src[3];
+		if (srcA == 0) continue;
+		if (srcA == 255)
+		{
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+			dst[3] = 255;
+			continue;
+		}
+		uint32_t invA = 255 - srcA;
+		dst[0] = sf::Uint8(Div255(src[0] * srcA + dst[0] * invA));
+		dst[1] = sf::Uint8(Div255(src[1] * srcA + dst[1] * invA));
+		dst[2] = sf::Uint8(Div255(src[2] * srcA + dst[2] * invA));
+		dst[3] = sf::Uint8(srcA + Div255(dst[3] * invA));
+	}
+}
+
+static void BlendCoverageRowScalar(sf::Uint8 * destination, const sf::Uint8 * coverage, const sf::Color & color, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (coverage[i] == 0) continue;
+		sf::Uint8* dst = destination + i * 4;
+		uint32_t srcA = Div255(uint32_t(color.a) * coverage[i]);
+		uint32_t invA = 255 - srcA;
+		dst[0] = sf::Uint8(Div255(color.r * srcA + dst[0] * invA));
+		dst[1] = sf::Uint8(Div255(color.g * srcA + dst[1] * invA));
+		dst[2] = sf::Uint8(Div255(color.b * srcA + dst[2] * invA));
+		dst[3] = sf::Uint8(srcA + Div255(dst[3] * invA));
+	}
+}
+
+//SSE2 is always present on x64 and is the default target of MSVC for x86
+//blending is done in 16 bit lanes, two pixels per register half
+//alpha lane of source is replaced by 255, so the same formula gives srcA + dstA * (1 - srcA)
+
+static inline __m128i Div255SSE2(__m128i x)
+{
+	//(t + (t >> 8)) >> 8 with t = x + 128, equal to Div255 for 0..65535
+	__m128i t = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static inline __m128i BlendHalfSSE2(__m128i src, __m128i dst, __m128i srcA)
+{
+	const __m128i ALPHA_LANE = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+	const __m128i COLOR_LANES = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+	src = _mm_or_si128(_mm_and_si128(src, COLOR_LANES), ALPHA_LANE);
+	__m128i invA = _mm_sub_epi16(_mm_set1_epi16(255), srcA);
+	return Div255SSE2(_mm_add_epi16(_mm_mullo_epi16(src, srcA), _mm_mullo_epi16(dst, invA)));
+}
+
+static inline __m128i BroadcastAlphaSSE2(__m128i pixels16)
+{
+	pixels16 = _mm_shufflelo_epi16(pixels16, _MM_SHUFFLE(3, 3, 3, 3));
+	return _mm_shufflehi_epi16(pixels16, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+static void FillRowSSE2(sf::Uint8 * destination, const sf::Color & color, int count)
+{
+	const __m128i value = _mm_set1_epi32((int)(color.r | (color.g << 8) | (color.b << 16) | (uint32_t(color.a) << 24)));
+	int i = 0;
+	for (; i + 4 <= count; i += 4) _mm_storeu_si128((__m128i*)(destination + i * 4), value);
+	FillRowScalar(destination + i * 4, color, count - i);
+}
+
+static void BlendRowSSE2(sf::Uint8 * destination, const sf::Uint8 * source, int count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i src = _mm_loadu_si128((const __m128i*)(source + i * 4));
+		__m128i alpha = _mm_and_si128(src, alphaMask);
+		//whole transparent or whole opaque blocks are common in field bitmaps
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xFFFF) continue;
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaMask)) == 0xFFFF)
+		{
+			_mm_storeu_si128((__m128i*)(destination + i * 4), src);
+			continue;
+		}
+
+		__m128i dst = _mm_loadu_si128((const __m128i*)(destination + i * 4));
+		__m128i srcLo = _mm_unpacklo_epi8(src, zero);
+		__m128i srcHi = _mm_unpackhi_epi8(src, zero);
+		__m128i lo = BlendHalfSSE2(srcLo, _mm_unpacklo_epi8(dst, zero), BroadcastAlphaSSE2(srcLo));
+		__m128i hi = BlendHalfSSE2(srcHi, _mm_unpackhi_epi8(dst, zero), BroadcastAlphaSSE2(srcHi));
+		_mm_storeu_si128((__m128i*)(destination + i * 4), _mm_packus_epi16(lo, hi));
+	}
+	BlendRowScalar(destination + i * 4, source + i * 4, count - i);
+}
+
+static void BlendCoverageRowSSE2(sf::Uint8 * destination, const sf::Uint8 * coverage, const sf::Color & color, int count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i color16 = _mm_set_epi16(color.a, color.b, color.g, color.r, color.a, color.b, color.g, color.r);
+	const __m128i colorA = _mm_set1_epi16(color.a);
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		uint32_t coverage4;
+		memcpy(&coverage4, coverage + i, sizeof(coverage4));
+		if (coverage4 == 0) continue;
+
+		//every coverage byte repeated for 4 channels
+		__m128i cov = _mm_cvtsi32_si128((int)coverage4);
+		cov = _mm_unpacklo_epi8(cov, cov);
+		cov = _mm_unpacklo_epi16(cov, cov);
+
+		__m128i dst = _mm_loadu_si128((const __m128i*)(destination + i * 4));
+		__m128i srcALo = Div255SSE2(_mm_mullo_epi16(_mm_unpacklo_epi8(cov, zero), colorA));
+		__m128i srcAHi = Div255SSE2(_mm_mullo_epi16(_mm_unpackhi_epi8(cov, zero), colorA));
+		__m128i lo = BlendHalfSSE2(color16, _mm_unpacklo_epi8(dst, zero), srcALo);
+		__m128i hi = BlendHalfSSE2(color16, _mm_unpackhi_epi8(dst, zero), srcAHi);
+		_mm_storeu_si128((__m128i*)(destination + i * 4), _mm_packus_epi16(lo, hi));
+	}
+	BlendCoverageRowScalar(destination + i * 4, coverage + i, color, count - i);
+}
+
+static const BlendKernels SCALAR_KERNELS = { BlendKernels::Level::Scalar, "Scalar", FillRowScalar, BlendRowScalar, BlendCoverageRowScalar };
+static const BlendKernels SSE2_KERNELS = { BlendKernels::Level::SSE2, "SSE2", FillRowSSE2, BlendRowSSE2, BlendCoverageRowSSE2 };
+static const BlendKernels AVX2_KERNELS = { BlendKernels::Level::AVX2, "AVX2", FillRowAVX2, BlendRowAVX2, BlendCoverageRowAVX2 };
+
+static void GetCpuid(int leaf, int subleaf, int registers[4])
+{
+#ifdef _MSC_VER
+	__cpuidex(registers, leaf, subleaf);
+#else
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+	__cpuid_count(leaf, subleaf, eax, ebx, ecx, edx);
+	registers[0] = (int)eax;
+	registers[1] = (int)ebx;
+	registers[2] = (int)ecx;
+	registers[3] = (int)edx;
+#endif
+}
+
+static bool CheckAVX2()
+{
+	int registers[4];
+	GetCpuid(0, 0, registers);
+	if (registers[0] < 7) return false;
+
+	//OS must save YMM registers, checked with OSXSAVE and XCR0
+	GetCpuid(1, 0, registers);
+	const int OSXSAVE = 1 << 27;
+	const int AVX = 1 << 28;
+	if ((registers[2] & OSXSAVE) == 0 || (registers[2] & AVX) == 0) return false;
+#ifdef _MSC_VER
+	unsigned long long xcr0 = _xgetbv(0);
+#else
+	unsigned int xcr0Lo = 0, xcr0Hi = 0;
+	__asm__("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+	unsigned long long xcr0 = xcr0Lo | ((unsigned long long)xcr0Hi << 32);
+#endif
+	if ((xcr0 & 0x6) != 0x6) return false;
+
+	GetCpuid(7, 0, registers);
+	const int AVX2 = 1 << 5;
+	return (registers[1] & AVX2) != 0;
+}
+
+const BlendKernels & BlendKernels::Get()
+{
+	static const BlendKernels& best = []() -> const BlendKernels&
+	{
+		const BlendKernels& kernels = CheckAVX2() ? AVX2_KERNELS : SSE2_KERNELS;
+		LOG_INFO("Blend kernels selected={}", kernels.name);
+		return kernels;
+	}();
+	return best;
+}
+
+const BlendKernels * BlendKernels::GetLevel(Level level)
+{
+	switch (level)
+	{
+	case Level::Scalar:
+		return &SCALAR_KERNELS;
+	case Level::SSE2:
+		return &SSE2_KERNELS;
+	case Level::AVX2:
+		return (Get().level == Level::AVX2) ? &AVX2_KERNELS : nullptr;
+	}
+	return nullptr;
+}
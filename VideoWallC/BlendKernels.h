@@ -0,0 +1,32 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+
+//pixel loops of software compositing, RGBA 8 bit, same equation as sf::BlendAlpha
+//every implementation gives exactly the same result as the scalar one
+struct BlendKernels
+{
+	enum class Level
+	{
+		Scalar = 0,
+		SSE2,
+		AVX2
+	};
+
+	//overwrites count pixels with color
+	typedef void(*FillRowFunction)(sf::Uint8* destination, const sf::Color& color, int count);
+	//blends count source pixels over destination
+	typedef void(*BlendRowFunction)(sf::Uint8* destination, const sf::Uint8* source, int count);
+	//blends color over destination, alpha multiplied by coverage of every pixel
+	typedef void(*BlendCoverageRowFunction)(sf::Uint8* destination, const sf::Uint8* coverage, const sf::Color& color, int count);
+
+	Level level;
+	const char* name;
+	FillRowFunction FillRow;
+	BlendRowFunction BlendRow;
+	BlendCoverageRowFunction BlendCoverageRow;
+
+	//best kernels supported by CPU, detected on first call
+	static const BlendKernels& Get();
+	//nullptr if level is not supported by CPU or build
+	static const BlendKernels* GetLevel(Level level);
+};
@@ -0,0 +1,121 @@
+//this file is compiled with AVX2 enabled, functions are called only after CPU check in BlendKernels.cpp
+//same algorithm as SSE2 kernels, 8 pixels per iteration
+#include "BlendKernels.h"
+#include <immintrin.h>
+#include <cstring>
+
+static inline uint32_t Div255(uint32_t x)
+{
+	return (x + 127) / 255;
+}
+
+static inline __m256i Div255AVX2(__m256i x)
+{
+	__m256i t = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+static inline __m256i BlendHalfAVX2(__m256i src, __m256i dst, __m256i srcA)
+{
+	const __m256i ALPHA_LANE = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0);
+	const __m256i COLOR_LANES = _mm256_set_epi16(0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1);
+	src = _mm256_or_si256(_mm256_and_si256(src, COLOR_LANES), ALPHA_LANE);
+	__m256i invA = _mm256_sub_epi16(_mm256_set1_epi16(255), srcA);
+	return Div255AVX2(_mm256_add_epi16(_mm256_mullo_epi16(src, srcA), _mm256_mullo_epi16(dst, invA)));
+}
+
+static inline __m256i BroadcastAlphaAVX2(__m256i pixels16)
+{
+	pixels16 = _mm256_shufflelo_epi16(pixels16, _MM_SHUFFLE(3, 3, 3, 3));
+	return _mm256_shufflehi_epi16(pixels16, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+void FillRowAVX2(sf::Uint8 * destination, const sf::Color & color, int count)
+{
+	const __m256i value = _mm256_set1_epi32((int)(color.r | (color.g << 8) | (color.b << 16) | (uint32_t(color.a) << 24)));
+	int i = 0;
+	for (; i + 8 <= count; i += 8) _mm256_storeu_si256((__m256i*)(destination + i * 4), value);
+	for (; i < count; i++)
+	{
+		destination[i * 4 + 0] = color.r;
+		destination[i * 4 + 1] = color.g;
+		destination[i * 4 + 2] = color.b;
+		destination[i * 4 + 3] = color.a;
+	}
+}
+
+void BlendRowAVX2(sf::Uint8 * destination, const sf::Uint8 * source, int count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alphaMask = _mm256_set1_epi32((int)0xFF000000);
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i src = _mm256_loadu_si256((const __m256i*)(source + i * 4));
+		__m256i alpha = _mm256_and_si256(src, alphaMask);
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, zero)) == -1) continue;
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, alphaMask)) == -1)
+		{
+			_mm256_storeu_si256((__m256i*)(destination + i * 4), src);
+			continue;
+		}
+
+		//unpack and pack work inside 128 bit lanes, so pixel order is kept
+		__m256i dst = _mm256_loadu_si256((const __m256i*)(destination + i * 4));
+		__m256i srcLo = _mm256_unpacklo_epi8(src, zero);
+		__m256i srcHi = _mm256_unpackhi_epi8(src, zero);
+		__m256i lo = BlendHalfAVX2(srcLo, _mm256_unpacklo_epi8(dst, zero), BroadcastAlphaAVX2(srcLo));
+		__m256i hi = BlendHalfAVX2(srcHi, _mm256_unpackhi_epi8(dst, zero), BroadcastAlphaAVX2(srcHi));
+		_mm256_storeu_si256((__m256i*)(destination + i * 4), _mm256_packus_epi16(lo, hi));
+	}
+
+	for (; i < count; i++)
+	{
+		const sf::Uint8* src = source + i * 4;
+		sf::Uint8* dst = destination + i * 4;
+		uint32_t srcA = src[3];
+		uint32_t invA = 255 - srcA;
+		dst[0] = sf::Uint8(Div255(src[0] * srcA + dst[0] * invA));
+		dst[1] = sf::Uint8(Div255(src[1] * srcA + dst[1] * invA));
+		dst[2] = sf::Uint8(Div255(src[2] * srcA + dst[2] * invA));
+		dst[3] = sf::Uint8(srcA + Div255(dst[3] * invA));
+	}
+}
+
+void BlendCoverageRowAVX2(sf::Uint8 * destination, const sf::Uint8 * coverage, const sf::Color & color, int count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i color16 = _mm256_set_epi16(color.a, color.b, color.g, color.r, color.a, color.b, color.g, color.r,
+		color.a, color.b, color.g, color.r, color.a, color.b, color.g, color.r);
+	const __m256i colorA = _mm256_set1_epi16(color.a);
+	const __m256i repeatByte = _mm256_set1_epi32(0x01010101);
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		uint64_t coverage8;
+		memcpy(&coverage8, coverage + i, sizeof(coverage8));
+		if (coverage8 == 0) continue;
+
+		//every coverage byte repeated for 4 channels
+		__m256i cov = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(coverage + i)));
+		cov = _mm256_mullo_epi32(cov, repeatByte);
+
+		__m256i dst = _mm256_loadu_si256((const __m256i*)(destination + i * 4));
+		__m256i srcALo = Div255AVX2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(cov, zero), colorA));
+		__m256i srcAHi = Div255AVX2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(cov, zero), colorA));
+		__m256i lo = BlendHalfAVX2(color16, _mm256_unpacklo_epi8(dst, zero), srcALo);
+		__m256i hi = BlendHalfAVX2(color16, _mm256_unpackhi_epi8(dst, zero), srcAHi);
+		_mm256_storeu_si256((__m256i*)(destination + i * 4), _mm256_packus_epi16(lo, hi));
+	}
+
+	for (; i < count; i++)
+	{
+		sf::Uint8* dst = destination + i * 4;
+		uint32_t srcA = Div255(uint32_t(color.a) * coverage[i]);
+		uint32_t invA = 255 - srcA;
+		dst[0] = sf::Uint8(Div255(color.r * srcA + dst[0] * invA));
+		dst[1] = sf::Uint8(Div255(color.g * srcA + dst[1] * invA));
+		dst[2] = sf::Uint8(Div255(color.b * srcA + dst[2] * invA));
+		dst[3] = sf::Uint8(srcA + Div255(dst[3] * invA));
+	}
+}
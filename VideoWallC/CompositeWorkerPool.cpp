@@ -0,0 +1,108 @@
+#include "CompositeWorkerPool.h"
+#include "Log.h"
+#include <algorithm>
+
+CompositeWorkerPool::CompositeWorkerPool(size_t threadCount) :
+	m_workers(),
+	m_ranges(),
+	m_threadCount(threadCount),
+	m_task(nullptr),
+	m_generation(0),
+	m_workersBusy(0),
+	m_stopping(false)
+{
+	if (m_threadCount == 0) m_threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	m_ranges.reset(new TaskRange[m_threadCount]);
+	for (size_t i = 0; i < m_threadCount; i++)
+	{
+		m_ranges[i].next.store(0);
+		m_ranges[i].end = 0;
+	}
+
+	//caller is thread 0
+	for (size_t i = 1; i < m_threadCount; i++)
+	{
+		m_workers.emplace_back(&CompositeWorkerPool::WorkerFunction, this, i);
+	}
+	LOG_DEBUG("Composite worker pool created with {} threads", m_threadCount);
+}
+
+CompositeWorkerPool::~CompositeWorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> mut(m_runMutex);
+		m_stopping = true;
+	}
+	m_startCondition.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+}
+
+void CompositeWorkerPool::Run(size_t taskCount, const std::function<void(size_t)>& task)
+{
+	if (m_workers.empty() || taskCount < 2)
+	{
+		for (size_t i = 0; i < taskCount; i++) task(i);
+		return;
+	}
+
+	for (size_t i = 0; i < m_threadCount; i++)
+	{
+		m_ranges[i].next.store(taskCount * i / m_threadCount);
+		m_ranges[i].end = taskCount * (i + 1) / m_threadCount;
+	}
+
+	{
+		std::lock_guard<std::mutex> mut(m_runMutex);
+		m_task = &task;
+		m_workersBusy = m_workers.size();
+		m_generation++;
+	}
+	m_startCondition.notify_all();
+
+	RunTasks(0);
+
+	std::unique_lock<std::mutex> lock(m_runMutex);
+	m_doneCondition.wait(lock, [this] { return m_workersBusy == 0; });
+	m_task = nullptr;
+}
+
+size_t CompositeWorkerPool::GetThreadCount() const
+{
+	return m_threadCount;
+}
+
+void CompositeWorkerPool::WorkerFunction(size_t index)
+{
+	uint64_t generation = 0;
+	std::unique_lock<std::mutex> lock(m_runMutex);
+	while (true)
+	{
+		m_startCondition.wait(lock, [&] { return m_stopping || m_generation != generation; });
+		if (m_stopping) break;
+		generation = m_generation;
+		lock.unlock();
+
+		RunTasks(index);
+
+		lock.lock();
+		if (--m_workersBusy == 0) m_doneCondition.notify_one();
+	}
+}
+
+void CompositeWorkerPool::RunTasks(size_t rangeIndex)
+{
+	//own range first, then the others starting from neighbour, so thieves spread out
+	for (size_t i = 0; i < m_threadCount; i++)
+	{
+		TaskRange& range = m_ranges[(rangeIndex + i) % m_threadCount];
+		while (true)
+		{
+			size_t taskIndex = range.next.fetch_add(1);
+			if (taskIndex >= range.end) break;
+			(*m_task)(taskIndex);
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//runs numbered tasks (frame bands) on several cores, calling thread works too.
+//Every thread gets a contiguous range of tasks, one that finishes early steals from the others
+class CompositeWorkerPool
+{
+public:
+	//threads including caller, 0 is number of cores
+	CompositeWorkerPool(size_t threadCount);
+	~CompositeWorkerPool();
+
+	//returns when all tasks are done
+	void Run(size_t taskCount, const std::function<void(size_t)>& task);
+	size_t GetThreadCount() const;
+
+private:
+	struct TaskRange
+	{
+		std::atomic<size_t> next;
+		size_t end;
+		char padding[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];  //ranges of threads are on different cache lines
+	};
+
+	void WorkerFunction(size_t index);
+	void RunTasks(size_t rangeIndex);
+
+	std::vector<std::thread> m_workers;
+	std::unique_ptr<TaskRange[]> m_ranges;
+	size_t m_threadCount;
+	const std::function<void(size_t)>* m_task;
+
+	std::mutex m_runMutex;
+	std::condition_variable m_startCondition;
+	std::condition_variable m_doneCondition;
+	uint64_t m_generation;
+	size_t m_workersBusy;
+	bool m_stopping;
+};
@@ -0,0 +1,63 @@
+#include "Cp1251.h"
+#include <array>
+#include <emmintrin.h>
+
+//0x80-0xBF, everything below is ASCII, 0xC0-0xFF are Cyrillic capital A to small ya in order
+static const sf::Uint16 HIGH_TABLE[64] =
+{
+	0x0402, 0x0403, 0x201A, 0x0453, 0x201E, 0x2026, 0x2020, 0x2021, 0x20AC, 0x2030, 0x0409, 0x2039, 0x040A, 0x040C, 0x040B, 0x040F,
+	0x0452, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x0098, 0x2122, 0x0459, 0x203A, 0x045A, 0x045C, 0x045B, 0x045F,
+	0x00A0, 0x040E, 0x045E, 0x0408, 0x00A4, 0x0490, 0x00A6, 0x00A7, 0x0401, 0x00A9, 0x0404, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x0407,
+	0x00B0, 0x00B1, 0x0406, 0x0456, 0x0491, 0x00B5, 0x00B6, 0x00B7, 0x0451, 0x2116, 0x0454, 0x00BB, 0x0458, 0x0405, 0x0455, 0x0457
+};
+
+static std::array<sf::Uint32, 256> BuildTable()
+{
+	std::array<sf::Uint32, 256> table;
+	for (unsigned c = 0; c < 0x80; c++) table[c] = c;
+	for (unsigned c = 0x80; c < 0xC0; c++) table[c] = HIGH_TABLE[c - 0x80];
+	for (unsigned c = 0xC0; c < 0x100; c++) table[c] = 0x0410 + (c - 0xC0);
+	return table;
+}
+
+static const std::array<sf::Uint32, 256> TABLE = BuildTable();
+
+sf::Uint32 Cp1251::ToUtf32(unsigned char c)
+{
+	return TABLE[c];
+}
+
+std::basic_string<sf::Uint32> Cp1251::Decode(const std::string & text)
+{
+	const size_t size = text.size();
+	std::basic_string<sf::Uint32> result(size, 0);
+	if (size == 0) return result;
+
+	const unsigned char* source = reinterpret_cast<const unsigned char*>(text.data());
+	sf::Uint32* target = &result[0];
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 16 <= size; i += 16)
+	{
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+		if (_mm_movemask_epi8(bytes) != 0)
+		{
+			//some byte has high bit set, not ASCII
+			for (size_t j = i; j < i + 16; j++) target[j] = TABLE[source[j]];
+			continue;
+		}
+		__m128i low = _mm_unpacklo_epi8(bytes, zero);
+		__m128i high = _mm_unpackhi_epi8(bytes, zero);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), _mm_unpacklo_epi16(low, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(target + i + 4), _mm_unpackhi_epi16(low, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(target + i + 8), _mm_unpacklo_epi16(high, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(target + i + 12), _mm_unpackhi_epi16(high, zero));
+	}
+	for (; i < size; i++) target[i] = TABLE[source[i]];
+	return result;
+}
+
+bool Cp1251::IsPrintable(unsigned char c)
+{
+	return (c >= 0x20 && c < 0x7F) || (c >= 0x80 && c != 0x98);
+}
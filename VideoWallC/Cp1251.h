@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+#include <SFML/System.hpp>
+
+//text from controller is in Windows-1251, decoded without locale so result is the same on every system
+class Cp1251
+{
+public:
+	static sf::Uint32 ToUtf32(unsigned char c);
+	//whole string, runs of ASCII are widened 16 bytes at a time
+	static std::basic_string<sf::Uint32> Decode(const std::string& text);
+	//letters, digits, punctuation and symbols, not control codes or the unused 0x98
+	static bool IsPrintable(unsigned char c);
+};
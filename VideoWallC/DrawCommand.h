@@ -0,0 +1,38 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include "Bitmap.h"
+
+//draw call kept until Flush of the frame, bitmap must live until then
+struct DrawCommand
+{
+	enum Type
+	{
+		ClearColor,
+		DrawSource,
+		DrawScaled
+	};
+
+	Type type;
+	const Bitmap* bitmap;
+	sf::IntRect source;
+	sf::FloatRect destination;  //for DrawSource it is position and size of source
+	sf::Color color;
+
+	static DrawCommand Clear(const sf::Color& color)
+	{
+		DrawCommand command = { ClearColor, nullptr, sf::IntRect(), sf::FloatRect(), color };
+		return command;
+	}
+
+	static DrawCommand Draw(const Bitmap& bitmap, const sf::IntRect& source, const sf::Vector2f& position)
+	{
+		DrawCommand command = { DrawSource, &bitmap, source, sf::FloatRect(position.x, position.y, (float)source.width, (float)source.height), sf::Color() };
+		return command;
+	}
+
+	static DrawCommand DrawScaledTo(const Bitmap& bitmap, const sf::FloatRect& destination)
+	{
+		DrawCommand command = { DrawScaled, &bitmap, sf::IntRect(), destination, sf::Color() };
+		return command;
+	}
+};
@@ -0,0 +1,176 @@
+#include "FallbackPlaylist.h"
+#include "ImageResampler.h"
+#include "Log.h"
+#include <chrono>
+#include <sstream>
+
+FallbackPlaylist::FallbackPlaylist(const std::vector<std::string>& files, unsigned int width, unsigned int height, unsigned int intervalSeconds) :
+	m_files(files),
+	m_width(width),
+	m_height(height),
+	m_intervalMicro(sf::Int64(intervalSeconds) * 1000000),
+	m_current(),
+	m_index(0),
+	m_shownMicro(0),
+	m_waiting(false),
+	m_requestedIndex(0),
+	m_requestId(0),
+	m_decodedId(0),
+	m_decoded(),
+	m_haveRequest(false),
+	m_stopping(false),
+	m_decodeThread()
+{
+	std::thread t(&FallbackPlaylist::DecodeThreadFunction, this);
+	m_decodeThread.swap(t);
+	//program starts with fallback, decoding it right away
+	Request(0);
+	LOG_INFO("Fallback playlist of {0} images, size={1}x{2}, interval={3} seconds", m_files.size(), width, height, intervalSeconds);
+}
+
+FallbackPlaylist::~FallbackPlaylist()
+{
+	{
+		std::lock_guard<std::mutex> mut(m_decodeMutex);
+		m_stopping = true;
+	}
+	m_decodeCondition.notify_all();
+	m_decodeThread.join();
+}
+
+bool FallbackPlaylist::Update(sf::Int64 elapsedMicro, bool shown)
+{
+	if (shown == false)
+	{
+		if (m_current != nullptr || m_waiting)
+		{
+			m_current.reset();
+			m_waiting = false;
+			std::lock_guard<std::mutex> mut(m_decodeMutex);
+			m_haveRequest = false;
+			m_decoded.reset();
+			LOG_DEBUG("Fallback hidden, image released");
+		}
+		m_shownMicro = 0;
+		return false;
+	}
+
+	if (m_current == nullptr && m_waiting == false) Request(m_index);
+
+	bool changed = false;
+	if (m_waiting)
+	{
+		std::lock_guard<std::mutex> mut(m_decodeMutex);
+		if (m_decoded != nullptr && m_decodedId == m_requestId)
+		{
+			//previous image is dropped only now, so there is no black frame between images
+			m_current = std::move(m_decoded);
+			m_waiting = false;
+			m_shownMicro = 0;
+			changed = true;
+		}
+	}
+
+	if (m_files.size() > 1 && m_intervalMicro != 0 && m_current != nullptr && m_waiting == false)
+	{
+		m_shownMicro += elapsedMicro;
+		if (m_shownMicro >= m_intervalMicro)
+		{
+			m_index = (m_index + 1) % m_files.size();
+			Request(m_index);
+		}
+	}
+	return changed;
+}
+
+void FallbackPlaylist::Draw(RenderBackend & backend)
+{
+	if (m_current == nullptr) return;
+	backend.PrepareBitmap(*m_current);
+	backend.DrawBitmap(*m_current, sf::IntRect(0, 0, m_current->width, m_current->height), sf::Vector2f(0, 0));
+}
+
+std::vector<std::string> FallbackPlaylist::ParseFileList(const std::string & list)
+{
+	std::vector<std::string> files;
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ';'))
+	{
+		size_t first = item.find_first_not_of(" \t");
+		if (first == std::string::npos) continue;
+		size_t last = item.find_last_not_of(" \t");
+		files.push_back(item.substr(first, last - first + 1));
+	}
+	return files;
+}
+
+void FallbackPlaylist::DecodeThreadFunction()
+{
+	LOG_DEBUG("Fallback decode thread enter");
+	std::unique_lock<std::mutex> lock(m_decodeMutex);
+	while (true)
+	{
+		m_decodeCondition.wait(lock, [this] { return m_stopping || m_haveRequest; });
+		if (m_stopping) break;
+		size_t index = m_requestedIndex;
+		uint64_t id = m_requestId;
+		m_haveRequest = false;
+		lock.unlock();
+
+		std::shared_ptr<Bitmap> bitmap = Decode(index);
+
+		lock.lock();
+		//newer request or hidden fallback make this one useless
+		if (id == m_requestId && m_haveRequest == false)
+		{
+			m_decoded = bitmap;
+			m_decodedId = id;
+		}
+	}
+	LOG_DEBUG("Fallback decode thread exit");
+}
+
+std::shared_ptr<Bitmap> FallbackPlaylist::Decode(size_t index) const
+{
+	auto start = std::chrono::steady_clock::now();
+	std::shared_ptr<Bitmap> bitmap = std::make_shared<Bitmap>();
+	bitmap->width = m_width;
+	bitmap->height = m_height;
+
+	sf::Image image;
+	if (index >= m_files.size() || image.loadFromFile(m_files[index]) == false || image.getSize().x == 0 || image.getSize().y == 0)
+	{
+		LOG_ERROR("Failed to load fallback image={}, replacing with blue background", (index < m_files.size()) ? m_files[index] : "");
+		bitmap->pixels.resize(size_t(m_width) * m_height * 4);
+		for (size_t i = 0; i < bitmap->pixels.size(); i += 4)
+		{
+			bitmap->pixels[i + 0] = sf::Color::Blue.r;
+			bitmap->pixels[i + 1] = sf::Color::Blue.g;
+			bitmap->pixels[i + 2] = sf::Color::Blue.b;
+			bitmap->pixels[i + 3] = sf::Color::Blue.a;
+		}
+		return bitmap;
+	}
+
+	bitmap->pixels.resize(size_t(m_width) * m_height * 4);
+	ImageResampler resampler(image.getSize().x, image.getSize().y, m_width, m_height);
+	resampler.Resample(image.getPixelsPtr(), bitmap->pixels.data());
+	auto spent = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	LOG_INFO("Fallback image={0} of {1}x{2} decoded and scaled to {3}x{4} in {5} ms",
+		m_files[index], image.getSize().x, image.getSize().y, m_width, m_height, spent);
+	return bitmap;
+}
+
+void FallbackPlaylist::Request(size_t index)
+{
+	{
+		std::lock_guard<std::mutex> mut(m_decodeMutex);
+		m_requestedIndex = index;
+		m_requestId++;
+		m_haveRequest = true;
+		m_decoded.reset();
+	}
+	m_waiting = true;
+	m_decodeCondition.notify_one();
+}
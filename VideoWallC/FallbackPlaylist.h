@@ -0,0 +1,51 @@
+#pragma once
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RenderBackend.h"
+
+//images shown while there is no data from controller, in turn if there are several.
+//Decoded and scaled to output size on own thread, only shown image is kept in memory
+class FallbackPlaylist
+{
+public:
+	FallbackPlaylist(const std::vector<std::string>& files, unsigned int width, unsigned int height, unsigned int intervalSeconds);
+	~FallbackPlaylist();
+
+	//render thread, every frame. Frees image when not shown, returns true when shown image changed
+	bool Update(sf::Int64 elapsedMicro, bool shown);
+	void Draw(RenderBackend& backend);
+
+	//"a.jpg; b.png" to file names
+	static std::vector<std::string> ParseFileList(const std::string& list);
+
+private:
+	void DecodeThreadFunction();
+	std::shared_ptr<Bitmap> Decode(size_t index) const;
+	void Request(size_t index);
+
+	const std::vector<std::string> m_files;
+	const unsigned int m_width;
+	const unsigned int m_height;
+	const sf::Int64 m_intervalMicro;
+
+	//render thread side
+	std::shared_ptr<Bitmap> m_current;
+	size_t m_index;
+	sf::Int64 m_shownMicro;
+	bool m_waiting;
+
+	//shared with decode thread
+	std::mutex m_decodeMutex;
+	std::condition_variable m_decodeCondition;
+	size_t m_requestedIndex;
+	uint64_t m_requestId;
+	uint64_t m_decodedId;
+	std::shared_ptr<Bitmap> m_decoded;
+	bool m_haveRequest;
+	bool m_stopping;
+	std::thread m_decodeThread;
+};
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+
+//reference to field in FieldStore, goes stale when field is destroyed even if slot is reused
+struct FieldHandle
+{
+	uint32_t slot;
+	uint32_t generation;
+
+	FieldHandle() : slot(UINT32_MAX), generation(0) {}
+	FieldHandle(uint32_t slotIndex, uint32_t slotGeneration) : slot(slotIndex), generation(slotGeneration) {}
+
+	bool IsValid() const { return slot != UINT32_MAX; }
+	bool operator==(const FieldHandle& other) const { return slot == other.slot && generation == other.generation; }
+	bool operator!=(const FieldHandle& other) const { return !(*this == other); }
+};
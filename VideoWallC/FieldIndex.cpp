@@ -0,0 +1,117 @@
+#include "FieldIndex.h"
+#include <algorithm>
+#include <cmath>
+
+static const unsigned CELL_SIZE = 64;  //typical field is one or a few cells
+
+FieldIndex::FieldIndex() :
+	m_columns(0),
+	m_rows(0),
+	m_cells(),
+	m_exact()
+{
+}
+
+void FieldIndex::Reset(unsigned width, unsigned height)
+{
+	//fields may touch the last pixel row/column inclusive, so one more pixel is covered
+	m_columns = std::max(1u, (width + CELL_SIZE) / CELL_SIZE);
+	m_rows = std::max(1u, (height + CELL_SIZE) / CELL_SIZE);
+	m_cells.assign(size_t(m_columns) * m_rows, std::vector<Entry>());
+	m_exact.clear();
+}
+
+void FieldIndex::Clear()
+{
+	for (std::vector<Entry>& cell : m_cells) cell.clear();
+	m_exact.clear();
+}
+
+void FieldIndex::Insert(const sf::FloatRect & rect, FieldHandle field)
+{
+	m_exact[GetRectKey(rect)] = field;
+
+	unsigned firstX, lastX, firstY, lastY;
+	if (GetCellRange(rect, firstX, lastX, firstY, lastY) == false) return;
+	for (unsigned y = firstY; y <= lastY; y++)
+	{
+		for (unsigned x = firstX; x <= lastX; x++) m_cells[size_t(y) * m_columns + x].push_back({ rect, field });
+	}
+}
+
+void FieldIndex::Remove(const sf::FloatRect & rect, FieldHandle field)
+{
+	auto exact = m_exact.find(GetRectKey(rect));
+	if (exact != m_exact.end() && exact->second == field) m_exact.erase(exact);
+
+	unsigned firstX, lastX, firstY, lastY;
+	if (GetCellRange(rect, firstX, lastX, firstY, lastY) == false) return;
+	for (unsigned y = firstY; y <= lastY; y++)
+	{
+		for (unsigned x = firstX; x <= lastX; x++)
+		{
+			std::vector<Entry>& cell = m_cells[size_t(y) * m_columns + x];
+			cell.erase(std::remove_if(cell.begin(), cell.end(), [field](const Entry& entry) { return entry.field == field; }), cell.end());
+		}
+	}
+}
+
+FieldHandle FieldIndex::FindExact(const sf::FloatRect & rect) const
+{
+	auto exact = m_exact.find(GetRectKey(rect));
+	return (exact == m_exact.end()) ? FieldHandle() : exact->second;
+}
+
+FieldHandle FieldIndex::FindIntersecting(const sf::FloatRect & rect) const
+{
+	unsigned firstX, lastX, firstY, lastY;
+	if (GetCellRange(rect, firstX, lastX, firstY, lastY) == false) return FieldHandle();
+	for (unsigned y = firstY; y <= lastY; y++)
+	{
+		for (unsigned x = firstX; x <= lastX; x++)
+		{
+			for (const Entry& entry : m_cells[size_t(y) * m_columns + x])
+			{
+				if (rect.intersects(entry.rect) == true) return entry.field;
+			}
+		}
+	}
+	return FieldHandle();
+}
+
+size_t FieldIndex::GetCount() const
+{
+	return m_exact.size();
+}
+
+uint64_t FieldIndex::GetRectKey(const sf::FloatRect & rect)
+{
+	//protocol coordinates are whole pixels below 65536
+	return (uint64_t(uint16_t(std::lround(rect.left))) << 48) |
+		(uint64_t(uint16_t(std::lround(rect.top))) << 32) |
+		(uint64_t(uint16_t(std::lround(rect.width))) << 16) |
+		uint64_t(uint16_t(std::lround(rect.height)));
+}
+
+bool FieldIndex::GetCellRange(const sf::FloatRect & rect, unsigned & firstX, unsigned & lastX, unsigned & firstY, unsigned & lastY) const
+{
+	if (m_cells.empty()) return false;
+
+	//same normalization as sf::Rect::intersects, rects with inverted coordinates are valid
+	float left = std::min(rect.left, rect.left + rect.width);
+	float right = std::max(rect.left, rect.left + rect.width);
+	float top = std::min(rect.top, rect.top + rect.height);
+	float bottom = std::max(rect.top, rect.top + rect.height);
+	if (left >= right || top >= bottom) return false;
+
+	auto toCell = [](float value, unsigned count)
+	{
+		if (value <= 0) return 0u;
+		return std::min((unsigned)value / CELL_SIZE, count - 1);
+	};
+	firstX = toCell(left, m_columns);
+	lastX = toCell(std::ceil(right) - 1, m_columns);
+	firstY = toCell(top, m_rows);
+	lastY = toCell(std::ceil(bottom) - 1, m_rows);
+	return true;
+}
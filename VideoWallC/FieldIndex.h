@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "FieldHandle.h"
+
+//spatial index of field bounds: uniform grid for intersection tests and
+//hash of exact rectangles for finding field that command updates
+class FieldIndex
+{
+public:
+	FieldIndex();
+
+	//area that fields can occupy, clears index
+	void Reset(unsigned width, unsigned height);
+	void Clear();
+
+	void Insert(const sf::FloatRect& rect, FieldHandle field);
+	void Remove(const sf::FloatRect& rect, FieldHandle field);
+
+	//field with exactly these bounds, invalid handle if none
+	FieldHandle FindExact(const sf::FloatRect& rect) const;
+	//any field that intersects rect, invalid handle if none
+	FieldHandle FindIntersecting(const sf::FloatRect& rect) const;
+
+	size_t GetCount() const;
+
+private:
+	struct Entry
+	{
+		sf::FloatRect rect;
+		FieldHandle field;
+	};
+
+	static uint64_t GetRectKey(const sf::FloatRect& rect);
+	//range of cells covered by rect, false if rect is empty
+	bool GetCellRange(const sf::FloatRect& rect, unsigned& firstX, unsigned& lastX, unsigned& firstY, unsigned& lastY) const;
+
+	unsigned m_columns;
+	unsigned m_rows;
+	std::vector<std::vector<Entry>> m_cells;
+	std::unordered_map<uint64_t, FieldHandle> m_exact;
+};
@@ -0,0 +1,179 @@
+#include "FieldStore.h"
+#include "LDPField.h"
+#include <cmath>
+#include <type_traits>
+
+struct FieldStore::Slab
+{
+	std::aligned_storage<sizeof(LDPField), alignof(LDPField)>::type fields[SLAB_SIZE];
+
+	LDPField* Get(size_t index) { return reinterpret_cast<LDPField*>(&fields[index]); }
+};
+
+void FieldHotData::Resize(size_t count)
+{
+	bounds.resize(count);
+	scrollPosition.resize(count, 0.0);
+	textWidth.resize(count, 0.0f);
+	speed.resize(count, 0.0f);
+	scrollIntervalMicro.resize(count, 0);
+	flags.resize(count, 0);
+	type.resize(count, 0);
+	scrollStatistics.resize(count);
+}
+
+FieldStore::FieldStore() :
+	m_slabs(),
+	m_generations(),
+	m_alive(),
+	m_freeSlots(),
+	m_liveSlots(),
+	m_hot()
+{
+}
+
+FieldStore::~FieldStore()
+{
+	Clear();
+}
+
+FieldHandle FieldStore::Create()
+{
+	if (m_freeSlots.empty()) AddSlab();
+
+	uint32_t slot = m_freeSlots.back();
+	m_freeSlots.pop_back();
+	new (m_slabs[slot / SLAB_SIZE]->Get(slot % SLAB_SIZE)) LDPField(m_hot, slot);
+	m_alive[slot] = 1;
+	m_liveSlots.push_back(slot);
+	return FieldHandle(slot, m_generations[slot]);
+}
+
+bool FieldStore::Destroy(FieldHandle handle)
+{
+	if (Get(handle) == nullptr) return false;
+
+	uint32_t slot = handle.slot;
+	GetBySlot(slot).~LDPField();
+	m_hot.flags[slot] = 0;
+	m_alive[slot] = 0;
+	m_generations[slot]++;
+	m_freeSlots.push_back(slot);
+	for (size_t i = 0; i < m_liveSlots.size(); i++)
+	{
+		if (m_liveSlots[i] == slot)
+		{
+			m_liveSlots.erase(m_liveSlots.begin() + i);
+			break;
+		}
+	}
+	return true;
+}
+
+void FieldStore::Clear()
+{
+	//freed in reverse so the next fields get the same slots in the same order
+	for (auto it = m_liveSlots.rbegin(); it != m_liveSlots.rend(); ++it)
+	{
+		uint32_t slot = *it;
+		GetBySlot(slot).~LDPField();
+		m_hot.flags[slot] = 0;
+		m_alive[slot] = 0;
+		m_generations[slot]++;
+		m_freeSlots.push_back(slot);
+	}
+	m_liveSlots.clear();
+}
+
+LDPField * FieldStore::Get(FieldHandle handle)
+{
+	if (handle.slot >= m_alive.size() || m_alive[handle.slot] == 0 || m_generations[handle.slot] != handle.generation) return nullptr;
+	return &GetBySlot(handle.slot);
+}
+
+FieldHandle FieldStore::GetHandle(uint32_t slot) const
+{
+	return FieldHandle(slot, m_generations[slot]);
+}
+
+LDPField & FieldStore::GetBySlot(uint32_t slot)
+{
+	return *m_slabs[slot / SLAB_SIZE]->Get(slot % SLAB_SIZE);
+}
+
+void FieldStore::SetPendingDelete(uint32_t slot, bool pending)
+{
+	if (pending) m_hot.flags[slot] |= FieldHotData::PendingDelete;
+	else m_hot.flags[slot] &= ~FieldHotData::PendingDelete;
+}
+
+bool FieldStore::IsPendingDelete(uint32_t slot) const
+{
+	return (m_hot.flags[slot] & FieldHotData::PendingDelete) != 0;
+}
+
+size_t FieldStore::GetCount() const
+{
+	return m_liveSlots.size();
+}
+
+size_t FieldStore::GetCapacity() const
+{
+	return m_alive.size();
+}
+
+const std::vector<uint32_t>& FieldStore::GetLiveSlots() const
+{
+	return m_liveSlots;
+}
+
+const FieldHotData & FieldStore::GetHotData() const
+{
+	return m_hot;
+}
+
+bool FieldStore::AdvanceRunning(sf::Int64 elapsedMicroseconds, bool step)
+{
+	//free slots have no flags, so all slots are walked without indirection
+	const size_t count = m_hot.flags.size();
+	uint8_t* flags = m_hot.flags.data();
+	sf::Int64* interval = m_hot.scrollIntervalMicro.data();
+	for (size_t i = 0; i < count; i++)
+	{
+		interval[i] += (flags[i] & FieldHotData::Running) ? elapsedMicroseconds : 0;
+	}
+	if (step == false) return false;
+
+	bool moved = false;
+	for (size_t i = 0; i < count; i++)
+	{
+		if ((flags[i] & FieldHotData::Running) == 0) continue;
+		//first interval starts at random time, not counted
+		if (flags[i] & FieldHotData::ScrollIntervalValid) m_hot.scrollStatistics[i].Record((double)interval[i]);
+		moved = true;
+	}
+
+	double* position = m_hot.scrollPosition.data();
+	const float* width = m_hot.textWidth.data();
+	for (size_t i = 0; i < count; i++)
+	{
+		bool running = (flags[i] & FieldHotData::Running) != 0;
+		double next = position[i] + 1;
+		if (std::abs(next) > width[i]) next -= width[i];
+		position[i] = running ? next : position[i];
+		interval[i] = running ? 0 : interval[i];
+		flags[i] |= running ? FieldHotData::ScrollIntervalValid : 0;
+	}
+	return moved;
+}
+
+void FieldStore::AddSlab()
+{
+	size_t first = m_alive.size();
+	m_slabs.emplace_back(new Slab());
+	m_generations.resize(first + SLAB_SIZE, 0);
+	m_alive.resize(first + SLAB_SIZE, 0);
+	m_hot.Resize(first + SLAB_SIZE);
+	//lowest slot is taken first
+	for (size_t i = first + SLAB_SIZE; i > first; i--) m_freeSlots.push_back((uint32_t)(i - 1));
+}
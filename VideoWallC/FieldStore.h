@@ -0,0 +1,79 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "FieldHandle.h"
+#include "Statistics.h"
+
+class LDPField;
+
+//state touched by every frame, kept in arrays indexed by slot so the update pass does not visit field objects
+struct FieldHotData
+{
+	enum Flags : uint8_t
+	{
+		Running				= 1 << 0,
+		ScrollIntervalValid	= 1 << 1,
+		MetricsDirty		= 1 << 2,
+		RasterPending		= 1 << 3,
+		DateTime			= 1 << 4,
+		//%23 was received, field is destroyed at the end of packet unless a command reuses it
+		PendingDelete		= 1 << 5,
+		//field needs LDPField::update this frame, date/time fields get it from clock timer
+		NeedsUpdate			= MetricsDirty | RasterPending
+	};
+
+	std::vector<sf::FloatRect> bounds;
+	std::vector<double> scrollPosition;
+	std::vector<float> textWidth;
+	std::vector<float> speed;
+	std::vector<sf::Int64> scrollIntervalMicro;
+	std::vector<uint8_t> flags;
+	std::vector<uint8_t> type;
+	//touched only on scroll steps of running fields
+	std::vector<RunningStatistics> scrollStatistics;
+
+	void Resize(size_t count);
+};
+
+//fields are kept in fixed slabs that are never freed, destroyed slots are reused by new fields
+class FieldStore
+{
+public:
+	FieldStore();
+	~FieldStore();
+
+	FieldHandle Create();
+	bool Destroy(FieldHandle handle);
+	void Clear();
+
+	//nullptr if handle is stale
+	LDPField* Get(FieldHandle handle);
+	FieldHandle GetHandle(uint32_t slot) const;
+	LDPField& GetBySlot(uint32_t slot);
+
+	void SetPendingDelete(uint32_t slot, bool pending);
+	bool IsPendingDelete(uint32_t slot) const;
+
+	size_t GetCount() const;
+	size_t GetCapacity() const;
+	//slots of live fields in creation order, which is drawing order
+	const std::vector<uint32_t>& GetLiveSlots() const;
+	const FieldHotData& GetHotData() const;
+
+	//moves every running text one step if step is true, returns true if any text moved
+	bool AdvanceRunning(sf::Int64 elapsedMicroseconds, bool step);
+
+private:
+	static const size_t SLAB_SIZE = 64;
+	struct Slab;
+
+	void AddSlab();
+
+	std::vector<std::unique_ptr<Slab>> m_slabs;
+	std::vector<uint32_t> m_generations;
+	std::vector<uint8_t> m_alive;
+	std::vector<uint32_t> m_freeSlots;
+	std::vector<uint32_t> m_liveSlots;
+	FieldHotData m_hot;
+};
@@ -1,60 +1,142 @@
 #include <memory>
+#include <sstream>
 #include "FieldsManager.h"
+#include "TextRasterizer.h"
+#include "GlyphCache.h"
+#include "Cp1251.h"
 #include "Log.h"
+#include "FlightRecorder.h"
+#include "Metrics.h"
 
-FieldsManager::FieldsManager(const std::string& devname, unsigned int baud_rate, INIFile* settingsObject) :
+static const std::chrono::minutes STATISTICS_LOG_INTERVAL(10);
+static const sf::Int64 CLOCK_TICK_MICRO = 500000;  //date/time fields blink twice a second
+static const uint32_t MAX_RUNNING_STEPS_DUE = 4;
+static const size_t MAX_RECORDED_COMMAND = 16;  //mode and coordinates
+static const size_t MAX_RECORDED_EXCEPTION = 64;
+
+static uint64_t MicrosecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+//field bounds in flight recorder event, 16 bits each
+static uint64_t PackBounds(const sf::FloatRect& bounds)
+{
+	return (uint64_t(uint16_t(bounds.left)) << 48) | (uint64_t(uint16_t(bounds.top)) << 32) |
+		(uint64_t(uint16_t(bounds.width)) << 16) | uint64_t(uint16_t(bounds.height));
+}
+
+//"1-4,8,12-16" to sizes, wrong items are skipped
+static std::vector<uint32_t> ParseSizeList(const std::string& list)
+{
+	std::vector<uint32_t> sizes;
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ','))
+	{
+		unsigned first = 0, last = 0;
+		char dash = 0;
+		std::stringstream itemStream(item);
+		if (!(itemStream >> first)) continue;
+		if (itemStream >> dash)
+		{
+			if (dash != '-' || !(itemStream >> last)) continue;
+		}
+		else last = first;
+		for (unsigned size = first; size <= last && size > 0; size++) sizes.push_back(size);
+	}
+	return sizes;
+}
+
+FieldsManager::FieldsManager(const std::string& devname, unsigned int baud_rate, INIFile* settingsObject, TimerWheel* timers) :
 	m_running(true),
 	m_readBufferSize(0),
-	m_fieldsArray(),
+	m_fieldStore(),
+	m_fieldIndex(),
+	m_haveFieldsPendingDelete(false),
+	m_reusedFieldCount(0),
+	m_sceneSnapshot(),
+	m_fieldCommandHashes(),
+	m_slotCommands(),
+	m_command(),
+	m_commandHash(0),
+	m_commandHashesSettingsVersion(0),
+	m_textCache(size_t(settingsObject->GetUInt(S_TEXTCACHEMEMORY)) * 1024 * 1024),
+	m_rasterPool(settingsObject->GetUInt(S_RASTERTHREADS)),
+	m_textRunningSpeed(30),
+	m_textRunningUpdateEveryMicro((int)round(1000000 / m_textRunningSpeed)),
+	m_textRunningStepsDue(0),
+	m_pTimers(timers),
+	m_textRunningTimer(0),
+	m_clockTimer(0),
 	m_displayFallback(true),
-	m_fallbackTexture(),
-	m_fallbackSprite(),
+	m_fallbackPlaylist(FallbackPlaylist::ParseFileList(settingsObject->GetString(S_FALLBACK)), settingsObject->GetUInt(S_CUSTOMWIDTH),
+		settingsObject->GetUInt(S_CUSTOMHEIGHT), settingsObject->GetUInt(S_FALLBACKINTERVAL)),
+	m_mediaFields(),
 	m_internalClock(),
-	m_textRunningLastUpdateMicro(0),
-	m_textRunningCurrentMicro(0),
-	m_textRunningSpeed(30),
-	m_textRunningUpdateEveryMicro((int)round(1000000 / m_textRunningSpeed))	
+	m_wallWidth(settingsObject->GetUInt(S_CUSTOMWIDTH)),
+	m_wallHeight(settingsObject->GetUInt(S_CUSTOMHEIGHT)),
+	m_coordinateDigits((settingsObject->GetUInt(S_WALLCOORDINATEDIGITS) == 4) ? 4 : 3),
+	m_palette(BuildPalette(settingsObject->GetString(S_PALETTE))),
+	m_defaultColor(sf::Color::White),
+	m_defaultBGColor(sf::Color::Transparent)
 {
 	LOG_TRACE("Field manager constructor enter");
 	m_pSettings = settingsObject;
-	std::string nameTemp = "\\\\.\\" + devname;
-	LOG_DEBUG("Fields manager device name = {}", nameTemp);
-	m_serial.open(nameTemp, baud_rate,
-		boost::asio::serial_port_base::parity(boost::asio::serial_port_base::parity::even),
-		boost::asio::serial_port_base::character_size(8),
-		boost::asio::serial_port_base::flow_control(boost::asio::serial_port_base::flow_control::none),
-		boost::asio::serial_port_base::stop_bits(boost::asio::serial_port_base::stop_bits::one));
-
-	//using namespace std::placeholders;
-	//m_serial.setCallback(std::bind(&FieldsManager::recvCallback, this, _1, _2));
-	//https://stackoverflow.com/questions/34094496/using-c-class-method-as-a-function-callback
-
-	LOG_INFO("Field manager serial opened");
+	GlyphCache::Get().SetMemoryLimit(size_t(m_pSettings->GetUInt(S_GLYPHCACHEMEMORY)) * 1024 * 1024);
+	m_fieldIndex.Reset(m_wallWidth, m_wallHeight);
+	if (m_coordinateDigits != m_pSettings->GetUInt(S_WALLCOORDINATEDIGITS)) LOG_ERROR("Coordinate digits can be 3 or 4, using 3");
 
 	LOG_TRACE("Initializing clocks");
 	m_lastUpdated = m_internalClock.now() - std::chrono::seconds(m_pSettings->GetUInt(S_FALLBACKTIMEOUT)) * 2;
+	m_lastStatisticsLog = m_internalClock.now();
+
+	RestoreScene();
+
+	//late frames are caught up, but not after a long stall
+	m_textRunningTimer = m_pTimers->SchedulePeriodic(m_textRunningUpdateEveryMicro, [this] { if (m_textRunningStepsDue < MAX_RUNNING_STEPS_DUE) m_textRunningStepsDue++; });
+	m_clockTimer = m_pTimers->SchedulePeriodic(CLOCK_TICK_MICRO, [this] { TickClocks(); });
+
+	for (const MediaClip& clip : MediaField::ParseClipList(m_pSettings->GetString(S_MEDIACLIPS)))
+	{
+		m_mediaFields.emplace_back(new MediaField(clip, m_pSettings->GetUInt(S_MEDIARINGFRAMES)));
+	}
+
+	if (devname.empty())
+	{
+		//benchmarks and tests, packets come only from ExecutePacket
+		LOG_INFO("Field manager created without serial device");
+	}
+	else
+	{
+		std::string nameTemp = "\\\\.\\" + devname;
+		LOG_DEBUG("Fields manager device name = {}", nameTemp);
+		m_serial.open(nameTemp, baud_rate,
+			boost::asio::serial_port_base::parity(boost::asio::serial_port_base::parity::even),
+			boost::asio::serial_port_base::character_size(8),
+			boost::asio::serial_port_base::flow_control(boost::asio::serial_port_base::flow_control::none),
+			boost::asio::serial_port_base::stop_bits(boost::asio::serial_port_base::stop_bits::one));
+
+		//using namespace std::placeholders;
+		//m_serial.setCallback(std::bind(&FieldsManager::recvCallback, this, _1, _2));
+		//https://stackoverflow.com/questions/34094496/using-c-class-method-as-a-function-callback
+
+		LOG_INFO("Field manager serial opened");
+	}
 
-	LOG_TRACE("Creating sprite and texture for fallback");
-	size_t wndX = m_pSettings->GetUInt(S_CUSTOMWIDTH);
-	size_t wndY = m_pSettings->GetUInt(S_CUSTOMHEIGHT);
-	if (m_fallbackTexture.loadFromFile(m_pSettings->GetString(S_FALLBACK)) == false)
-	{
-		LOG_ERROR("Failed to load fallback image, replacing with blue background");		
-
-		sf::Image tempImage;
-		tempImage.create(wndX, wndY, sf::Color::Blue);
-		m_fallbackTexture.create(wndX, wndY);
-		m_fallbackTexture.update(tempImage);
-	}	
-	m_fallbackSprite.setTexture(m_fallbackTexture);
-	m_fallbackSprite.setPosition(0, 0);
-	m_fallbackSprite.setScale(wndX / m_fallbackSprite.getLocalBounds().width, wndY / m_fallbackSprite.getLocalBounds().height);
 	//spr.setScale(window.getSize().x / spr.getLocalBounds().width, window.getSize().y / spr.getLocalBounds().height);
 
 	//std::thread t(boost::bind(&boost::asio::io_service::run, &io));
 	std::thread t(&FieldsManager::workThreadFunction, this);
 	workThread.swap(t);
 	LOG_INFO("Launched manager thread");
+
+	std::vector<uint32_t> prewarmSizes = ParseSizeList(m_pSettings->GetString(S_PREWARMSIZES));
+	if (prewarmSizes.empty() == false)
+	{
+		std::thread p(&FieldsManager::prewarmThreadFunction, this, m_pSettings->GetString(S_DEFAULTFONT), prewarmSizes);
+		prewarmThread.swap(p);
+	}
 	LOG_TRACE("Field manager constructor exit");
 }
 
@@ -62,66 +144,137 @@ FieldsManager::~FieldsManager()
 {
 	LOG_TRACE("Manager destructor enter");
 	//m_serial.clearCallback();
-	m_serial.close();
+	if (m_serial.isOpen()) m_serial.close();
 	m_running.store(false);
 	workThread.join();
+	if (prewarmThread.joinable()) prewarmThread.join();
+	m_pTimers->Cancel(m_textRunningTimer);
+	m_pTimers->Cancel(m_clockTimer);
 
 	std::lock_guard<std::recursive_mutex> mut(m_fieldArrayMutex);
-	std::for_each(m_fieldsArray.begin(), m_fieldsArray.end(), std::default_delete<LDPField>());
-	m_fieldsArray.clear();
+	m_fieldStore.Clear();
 	LOG_TRACE("Manager destructor exit");
 }
 
-void FieldsManager::DrawFields(sf::RenderWindow & wnd)
+void FieldsManager::DrawFields(RenderBackend & backend)
 {
 	if (m_displayFallback == true)
 	{
-		wnd.draw(m_fallbackSprite);
+		m_fallbackPlaylist.Draw(backend);
 	}
 	else
 	{
 		std::lock_guard<std::recursive_mutex> mut(m_fieldArrayMutex);
-		for (size_t i = 0; i < m_fieldsArray.size(); i++)
+		for (uint32_t slot : m_fieldStore.GetLiveSlots())
 		{
-			m_fieldsArray[i]->draw(wnd);
+			m_fieldStore.GetBySlot(slot).draw(backend);
 		}
+		for (auto& media : m_mediaFields) media->Draw(backend);
 	}
 }
 
+std::unique_lock<std::recursive_mutex> FieldsManager::LockFields()
+{
+	return std::unique_lock<std::recursive_mutex>(m_fieldArrayMutex);
+}
+
 //bool FieldsManager::UpdateFields(sf::Time elapsed)
-bool FieldsManager::UpdateFields(sf::Int64 elapsed, bool forceLog)
+bool FieldsManager::UpdateFields(RenderBackend& backend, sf::Int64 elapsed, bool forceLog)
 {
-	if (forceLog) LOG_TRACE("UpdateFields enter, elapsed Parameter={0}, m_textRunningCurrentMicro={1}, m_textRunningUpdateEveryMicro={2}, m_textRunningLastUpdateMicro={3}", elapsed, m_textRunningCurrentMicro, m_textRunningUpdateEveryMicro, m_textRunningLastUpdateMicro);
+	if (forceLog) LOG_HOT_TRACE("UpdateFields enter, elapsed Parameter={0}, m_textRunningStepsDue={1}", elapsed, m_textRunningStepsDue);
 	std::lock_guard<std::recursive_mutex> mut(m_fieldArrayMutex);
 	bool returnValue = false;
-	m_textRunningCurrentMicro += elapsed;
-	if (forceLog) LOG_TRACE("New m_textRunningCurrentMicro={0}", m_textRunningCurrentMicro);
-	bool needUpdate = (m_textRunningCurrentMicro >= m_textRunningLastUpdateMicro + m_textRunningUpdateEveryMicro);
-	if (forceLog) LOG_TRACE("needUpdate={0}, FieldArraySize={1}, returnValue={2}", needUpdate, m_fieldsArray.size(), returnValue);
-	for (size_t i = 0; i < m_fieldsArray.size(); i++)
-	{		
-		if (m_fieldsArray[i]->update(elapsed, needUpdate) == true)
-		{
-			if (forceLog) LOG_TRACE("Field #{0} updated=true", i);
+	bool needUpdate = (m_textRunningStepsDue != 0);
+	if (needUpdate) m_textRunningStepsDue--;
+	if (forceLog) LOG_HOT_TRACE("needUpdate={0}, FieldArraySize={1}, returnValue={2}", needUpdate, m_fieldStore.GetCount(), returnValue);
+	if (m_fieldStore.AdvanceRunning(elapsed, needUpdate) == true) returnValue = true;
+	if (m_fallbackPlaylist.Update(elapsed, m_displayFallback) == true) returnValue = true;
+	if (m_displayFallback == false)
+	{
+		for (auto& media : m_mediaFields)
+		{
+			if (media->Update(backend, elapsed) == true) returnValue = true;
+		}
+	}
+
+	//only fields with new text, pending raster or clock need their object touched
+	const std::vector<uint8_t>& flags = m_fieldStore.GetHotData().flags;
+	for (uint32_t slot : m_fieldStore.GetLiveSlots())
+	{
+		if ((flags[slot] & FieldHotData::NeedsUpdate) == 0) continue;
+		if (m_fieldStore.GetBySlot(slot).update(backend) == true)
+		{
+			if (forceLog) LOG_HOT_TRACE("Field #{0} updated=true", slot);
 			returnValue = true;
 		}
 		else
 		{
-			if (forceLog) LOG_TRACE("Field #{0} updated=false", i);
+			if (forceLog) LOG_HOT_TRACE("Field #{0} updated=false", slot);
 		}
 	}
 
-	if (needUpdate) m_textRunningLastUpdateMicro += m_textRunningUpdateEveryMicro;
-	//if (returnValue == true) m_textRunningLastUpdateMicro = m_textRunningCurrentMicro;
-	if (forceLog) LOG_TRACE("Before exit, elapsed Parameter={0}, m_textRunningCurrentMicro={1}, m_textRunningUpdateEveryMicro={2}, m_textRunningLastUpdateMicro={3}, returnValue={4}", elapsed, m_textRunningCurrentMicro, m_textRunningUpdateEveryMicro, m_textRunningLastUpdateMicro, returnValue);
+	if (forceLog) LOG_HOT_TRACE("Before exit, elapsed Parameter={0}, m_textRunningStepsDue={1}, returnValue={2}", elapsed, m_textRunningStepsDue, returnValue);
 	return returnValue;
 }
 
-void FieldsManager::ResetTimers()
+void FieldsManager::LogScrollStatistics()
+{
+	std::lock_guard<std::recursive_mutex> mut(m_fieldArrayMutex);
+	LOG_INFO("Running text statistics, step every {} microseconds:", m_textRunningUpdateEveryMicro);
+	size_t runningCount = 0;
+	for (uint32_t slot : m_fieldStore.GetLiveSlots())
+	{
+		LDPField& field = m_fieldStore.GetBySlot(slot);
+		const RunningStatistics& stats = field.getScrollStatistics();
+		if (stats.GetCount() == 0) continue;
+		runningCount++;
+
+		sf::FloatRect bounds = field.getBounds();
+		double jitter = (stats.GetMean() == 0) ? 0.0 : 100.0 * stats.GetStandardDeviation() / stats.GetMean();
+		LOG_INFO("  Field #{0} at ({1},{2},{3},{4}): steps={5}, mean={6:.1f}, stddev={7:.1f}, variance={8:.1f}, min={9:.0f}, max={10:.0f}, jitter={11:.1f}%",
+			slot, bounds.left, bounds.top, bounds.width, bounds.height, stats.GetCount(), stats.GetMean(),
+			stats.GetStandardDeviation(), stats.GetVariance(), stats.GetMin(), stats.GetMax(), jitter);
+		field.resetScrollStatistics();
+	}
+	if (runningCount == 0) LOG_INFO("  No running text fields");
+}
+
+int FieldsManager::ExecutePacket(const std::string & packet)
 {
-	LOG_TRACE("ResetTimers enter");
-	m_textRunningCurrentMicro = 0;
-	m_textRunningLastUpdateMicro = 0;
+	std::lock_guard<std::recursive_mutex> mut(m_fieldArrayMutex);
+	SplitPacketToCommands(packet);
+	if (m_commandBuffer.size() == 0) return 2;
+	int result = ExecuteCommands();
+	CheckAndUpdateFallback();
+	return result;
+}
+
+size_t FieldsManager::GetFieldCount()
+{
+	std::lock_guard<std::recursive_mutex> mut(m_fieldArrayMutex);
+	return m_fieldStore.GetCount();
+}
+
+bool FieldsManager::IsFallbackShown()
+{
+	std::lock_guard<std::recursive_mutex> mut(m_fieldArrayMutex);
+	return m_displayFallback;
+}
+
+size_t FieldsManager::GetRenderPendingCount()
+{
+	std::lock_guard<std::recursive_mutex> mut(m_fieldArrayMutex);
+	size_t pending = 0;
+	for (uint32_t slot : m_fieldStore.GetLiveSlots())
+	{
+		if (m_fieldStore.GetBySlot(slot).isRenderPending()) pending++;
+	}
+	return pending;
+}
+
+TextCache::Statistics FieldsManager::GetTextCacheStatistics()
+{
+	return m_textCache.GetStatistics();
 }
 
 void FieldsManager::ExecuteExternalCommand(std::string command)
@@ -133,7 +286,7 @@ void FieldsManager::ExecuteExternalCommand(std::string command)
 
 bool FieldsManager::CheckBufferForPackets(size_t & start, size_t & finish)
 {
-	LOG_TRACE("Entered CheckBufferForPackets with buffer={}", m_readQueueBuffer);
+	LOG_HOT_TRACE("Entered CheckBufferForPackets with buffer={}", m_readQueueBuffer);
 	const unsigned char startCode = 2;
 	const unsigned char endCode = 3;
 
@@ -147,7 +300,7 @@ bool FieldsManager::CheckBufferForPackets(size_t & start, size_t & finish)
 		{
 			m_readQueueBuffer.erase(0, first);
 			first = m_readQueueBuffer.find_first_of(startCode, 0);
-			LOG_DEBUG("Deleted trash in front of buffer, resulting buffer={}", m_readQueueBuffer);
+			LOG_HOT_DEBUG("Deleted trash in front of buffer, resulting buffer={}", m_readQueueBuffer);
 			continue;
 		}
 		//here we found start at 0, looking for end
@@ -160,22 +313,23 @@ bool FieldsManager::CheckBufferForPackets(size_t & start, size_t & finish)
 		int len = end - first + 1;
 		if (len < 8)
 		{
-			LOG_DEBUG("Packet is too small, deleting");
+			LOG_HOT_DEBUG("Packet is too small, deleting");
 			m_readQueueBuffer.erase(0, end + 1);
 			first = m_readQueueBuffer.find_first_of(startCode, 0);
-			LOG_DEBUG("resulting buffer={}", m_readQueueBuffer);
+			LOG_HOT_DEBUG("resulting buffer={}", m_readQueueBuffer);
 			continue;
 		}
 		//checking adress
 		std::string t = m_readQueueBuffer.substr(1, 2);
 		int addr;
 		std::istringstream(t) >> std::hex >> addr;
-		if (addr != m_pSettings->GetUInt(S_TABLONUMBER))
+		if (addr != m_pSettings->GetSnapshot().tabloNumber)
 		{
-			LOG_DEBUG("Packet is not for us, deleting");
+			Metrics::Add(Metrics::PacketsRejectedAddress);
+			LOG_HOT_DEBUG("Packet is not for us, deleting");
 			m_readQueueBuffer.erase(0, end + 1);
 			first = m_readQueueBuffer.find_first_of(startCode, 0);
-			LOG_DEBUG("resulting buffer={}", m_readQueueBuffer);
+			LOG_HOT_DEBUG("resulting buffer={}", m_readQueueBuffer);
 			continue;
 		}
 		//check checksum
@@ -193,7 +347,7 @@ bool FieldsManager::CheckBufferForPackets(size_t & start, size_t & finish)
 
 bool FieldsManager::CheckPacketCRC(std::string packet)
 {
-	LOG_TRACE("CheckPacketCRC enter");
+	LOG_HOT_TRACE("CheckPacketCRC enter");
 	unsigned char CRC = 0;
 
 	for (size_t i = 1; i < packet.size() - 3; i++)
@@ -208,36 +362,140 @@ bool FieldsManager::CheckPacketCRC(std::string packet)
 	if (CRC == packetCRC) return true;
 
 	LOG_ERROR("Pakcet CRC does not match, packetCRC={0}, calculated CRC={1}", packetCRC, CRC);
+	Metrics::Add(Metrics::PacketsRejectedCRC);
+	FlightRecorder::Get().Record(FlightEvent::PacketRejected, (uint16_t)packet.size(), (uint64_t(packetCRC) << 8) | CRC);
 	return false;
 }
 
-size_t FieldsManager::CheckFieldIntersects(sf::FloatRect& rect)
+//FNV-1a, 64 bit on every platform
+static uint64_t HashCommand(const std::string& command)
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (char c : command)
+	{
+		hash ^= (unsigned char)c;
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+bool FieldsManager::IsUnchangedFieldCommand(const std::string & command)
+{
+	m_command.clear();
+	if (command.size() < 3 || command[0] != '%' || (command[1] != '0' && command[1] != '4')) return false;
+
+	//reloaded settings can show the same command differently
+	uint64_t settingsVersion = m_pSettings->GetSnapshot().version;
+	if (settingsVersion != m_commandHashesSettingsVersion)
+	{
+		ClearFieldCommands();
+		m_commandHashesSettingsVersion = settingsVersion;
+	}
+
+	m_command = command;
+	m_commandHash = HashCommand(command);
+	auto found = m_fieldCommandHashes.find(m_commandHash);
+	if (found == m_fieldCommandHashes.end()) return false;
+	FieldHandle handle = found->second;
+	//hash only finds the field, different command with the same hash is applied
+	if (m_fieldStore.Get(handle) == nullptr || m_slotCommands[handle.slot] != command) return false;
+
+	//the same as reuse of field after %23
+	if (m_fieldStore.IsPendingDelete(handle.slot))
+	{
+		m_fieldStore.SetPendingDelete(handle.slot, false);
+		m_reusedFieldCount++;
+	}
+	return true;
+}
+
+void FieldsManager::RememberFieldCommand(uint32_t slot)
+{
+	ForgetFieldCommand(slot);
+	if (m_command.empty()) return;
+	if (slot >= m_slotCommands.size()) m_slotCommands.resize(slot + 1);
+	m_slotCommands[slot] = m_command;
+	m_fieldCommandHashes[m_commandHash] = m_fieldStore.GetHandle(slot);
+}
+
+void FieldsManager::ForgetFieldCommand(uint32_t slot)
 {
-	LOG_TRACE("CheckFieldIntersects enter with rect={0},{1},{2},{3}", rect.left, rect.left + rect.width, rect.top, rect.top + rect.height);
+	if (slot >= m_slotCommands.size() || m_slotCommands[slot].empty()) return;
+	//colliding command of other field could have taken the hash
+	auto found = m_fieldCommandHashes.find(HashCommand(m_slotCommands[slot]));
+	if (found != m_fieldCommandHashes.end() && found->second.slot == slot) m_fieldCommandHashes.erase(found);
+	m_slotCommands[slot].clear();
+}
+
+void FieldsManager::ClearFieldCommands()
+{
+	m_fieldCommandHashes.clear();
+	for (std::string& command : m_slotCommands) command.clear();
+}
+
+size_t FieldsManager::CheckFieldIntersects(const sf::FloatRect& rect, bool* reused)
+{
+	if (reused != nullptr) *reused = false;
+	LOG_HOT_TRACE("CheckFieldIntersects enter with rect={0},{1},{2},{3}", rect.left, rect.left + rect.width, rect.top, rect.top + rect.height);
 
-	if (rect.left + rect.width - 1 > m_pSettings->GetUInt(S_CUSTOMWIDTH) ||
-		rect.top + rect.height - 1 > m_pSettings->GetUInt(S_CUSTOMHEIGHT)) return UINT_MAX - 2;
+	if (rect.left + rect.width - 1 > m_wallWidth ||
+		rect.top + rect.height - 1 > m_wallHeight) return UINT_MAX - 2;
 
-	for (size_t i = 0; i < m_fieldsArray.size(); i++)
+	//fields never overlap, so field with the same bounds is the only one rect can intersect
+	FieldHandle exact = m_fieldIndex.FindExact(rect);
+	if (m_fieldStore.Get(exact) != nullptr)
 	{
-		if (rect.intersects(m_fieldsArray[i]->getBounds()) == true)
+		LOG_HOT_DEBUG("Field fully intersects with another field");
+		if (m_fieldStore.IsPendingDelete(exact.slot))
 		{
-			if (m_fieldsArray[i]->getBounds() == rect)
-			{
-				LOG_DEBUG("Field fully intersects with another field");
-				return i;
-			}
-			LOG_DEBUG("Field intersects with another field");
-			return UINT_MAX;
+			LOG_HOT_DEBUG("Reusing field marked for delete");
+			m_fieldStore.SetPendingDelete(exact.slot, false);
+			m_reusedFieldCount++;
+			if (reused != nullptr) *reused = true;
 		}
+		return exact.slot;
+	}
+	FieldHandle other = m_fieldIndex.FindIntersecting(rect);
+	while (other.IsValid() && m_fieldStore.IsPendingDelete(other.slot))
+	{
+		//new layout differs here, old field is not needed anymore
+		DeleteField(other);
+		other = m_fieldIndex.FindIntersecting(rect);
+	}
+	if (other.IsValid())
+	{
+		LOG_HOT_DEBUG("Field intersects with another field");
+		return UINT_MAX;
 	}
-	LOG_DEBUG("Field doesn't intersects, good to create");
+	LOG_HOT_DEBUG("Field doesn't intersects, good to create");
 	return UINT_MAX - 1;
 }
 
+LDPField* FieldsManager::CreateField(const sf::FloatRect& bounds)
+{
+	FieldHandle handle = m_fieldStore.Create();
+	LDPField* field = m_fieldStore.Get(handle);
+	field->setBounds(bounds);
+	m_fieldIndex.Insert(bounds, handle);
+	FlightRecorder::Get().Record(FlightEvent::FieldCreated, (uint16_t)handle.slot, PackBounds(bounds));
+	return field;
+}
+
+void FieldsManager::DeleteField(FieldHandle handle)
+{
+	LDPField* field = m_fieldStore.Get(handle);
+	if (field == nullptr) return;
+	m_fieldIndex.Remove(field->getBounds(), handle);
+	FlightRecorder::Get().Record(FlightEvent::FieldDestroyed, (uint16_t)handle.slot, PackBounds(field->getBounds()));
+	m_fieldStore.Destroy(handle);
+	m_sceneSnapshot.ClearField(handle.slot);
+	ForgetFieldCommand(handle.slot);
+}
+
 void FieldsManager::SplitPacketToCommands(std::string packet)
 {
-	LOG_TRACE("SplitPacketToCommands enter");
+	LOG_HOT_TRACE("SplitPacketToCommands enter");
+	auto start = std::chrono::steady_clock::now();
 	//checking size just in case
 	size_t pSize = packet.size();
 	if (pSize < 8) return;
@@ -248,11 +506,12 @@ void FieldsManager::SplitPacketToCommands(std::string packet)
 		LOG_CRITICAL("Packet CRC does not match, ignoring packet");
 		return;
 	}
+	Metrics::Add(Metrics::PacketsReceived);
 
 	//stripping packet from start and end
 	packet.erase(pSize - 3);  //deleting 3 characters at end (CRC and endChar)
 	packet.erase(0, 5);  //deleting 5 character ar start (startChar, address, packet length)
-	LOG_DEBUG("Packet after stripping ends={}", packet);
+	LOG_HOT_DEBUG("Packet after stripping ends={}", packet);
 
 	//checking size again
 	if (packet.size() == 0) return;
@@ -274,6 +533,7 @@ void FieldsManager::SplitPacketToCommands(std::string packet)
 		}
 		pos = packet.find_first_of(commandStart);
 	}
+	Metrics::RecordLatency(Metrics::PacketParse, MicrosecondsSince(start));
 }
 
 //return values:
@@ -282,7 +542,7 @@ void FieldsManager::SplitPacketToCommands(std::string packet)
 //2 - unknown command
 int FieldsManager::ExecuteCommands()
 {
-	LOG_TRACE("ExecuteCommands enter");
+	LOG_HOT_TRACE("ExecuteCommands enter");
 
 	int retValue = 0;
 	//concat text fields together
@@ -298,10 +558,10 @@ int FieldsManager::ExecuteCommands()
 		commandIndex++;
 	}
 
-	LOG_DEBUG("Command buffer log after concat:");
+	LOG_HOT_DEBUG("Command buffer log after concat:");
 	for (size_t i = 0; i < m_commandBuffer.size(); i++)
 	{
-		LOG_DEBUG("Element #{0}={1}", i, m_commandBuffer[i]);
+		LOG_HOT_DEBUG("Element #{0}={1}", i, m_commandBuffer[i]);
 	}
 
 	//execute commands
@@ -311,19 +571,37 @@ int FieldsManager::ExecuteCommands()
 	while (commandIndex < m_commandBuffer.size())
 	{
 		std::string command = m_commandBuffer[commandIndex];
-		LOG_DEBUG("Executing command #{0}={1}", commandIndex, command);
-		int ret = ParseAndExecuteCommand(command);
+		LOG_HOT_DEBUG("Executing command #{0}={1}", commandIndex, command);
+		int ret = 0;
+		if (IsUnchangedFieldCommand(command))
+		{
+			//controllers resend the whole board, field shows this command already
+			Metrics::Add(Metrics::CommandsUnchanged);
+			LOG_HOT_DEBUG("Field command is unchanged, skipping");
+		}
+		else
+		{
+			auto start = std::chrono::steady_clock::now();
+			ret = ParseAndExecuteCommand(command);
+			Metrics::RecordLatency(Metrics::CommandApply, MicrosecondsSince(start));
+			if (command.size() >= 3) Metrics::CountCommand(command[1], command[2]);
+			if (ret != 0) Metrics::Add(Metrics::CommandsFailed);
+			FlightRecorder::Get().RecordText(FlightEvent::CommandApplied, (uint16_t)ret, command, MAX_RECORDED_COMMAND);
+		}
+		m_command.clear();
 		//if ( == true)
 		{
-			LOG_DEBUG("Erasing command #{0}", commandIndex);
+			LOG_HOT_DEBUG("Erasing command #{0}", commandIndex);
 			m_commandBuffer.erase(m_commandBuffer.begin() + commandIndex);
-			LOG_DEBUG("Updating last update timer");
+			LOG_HOT_DEBUG("Updating last update timer");
 			if (command != "%35")  m_lastUpdated = m_internalClock.now();
 			if (ret > retValue) retValue = ret;
 			continue;
 		}
 		//commandIndex++;
 	}
+	DeletePendingFields();
+	m_sceneSnapshot.Commit(std::time(nullptr));
 
 	return retValue;
 }
@@ -334,10 +612,10 @@ int FieldsManager::ExecuteCommands()
 //2 - unknown command
 int FieldsManager::ParseAndExecuteCommand(std::string command)
 {
-	LOG_TRACE("ParseAndExecuteCommand enter with command={}", command);
+	LOG_HOT_TRACE("ParseAndExecuteCommand enter with command={}", command);
 
 	if (command[0] != '%') return 2;   //if % is not at the start - skip
-	LOG_DEBUG("Command length={}", command.length());
+	LOG_HOT_DEBUG("Command length={}", command.length());
 	if (command.length() < 3) return 2;  //if command is too short - skip
 
 	unsigned char majorMode = command[1];
@@ -350,7 +628,7 @@ int FieldsManager::ParseAndExecuteCommand(std::string command)
 	case '2': 
 		switch (minorMode)
 		{
-		case '3': DeleteAllFields(); return 0;  //%23 deleting all fields
+		case '3': MarkFieldsForDelete(); return 0;  //%23 deleting all fields
 		default: return 2; break;
 		}
 	case '3':
@@ -376,8 +654,8 @@ int FieldsManager::ParseAndExecuteCommand(std::string command)
 		switch (minorMode)
 		{
 		case 'c': break; //%7c datetime sync
-		case 'h': break; //%7h define standard BG color
-		case 'v': break; //%7v define standard foreground color (text, rects)
+		case 'h': return ParseAndExecuteDefaultColor(command, m_defaultBGColor); //%7h define standard BG color
+		case 'v': return ParseAndExecuteDefaultColor(command, m_defaultColor); //%7v define standard foreground color (text, rects)
 		default:return 2; break;
 		}
 	default: return 2; break;
@@ -388,13 +666,69 @@ int FieldsManager::ParseAndExecuteCommand(std::string command)
 
 void FieldsManager::InsertCommand(std::string command)
 {
-	LOG_DEBUG("InsertCommand enter, inserting command={}", command);
+	LOG_HOT_DEBUG("InsertCommand enter, inserting command={}", command);
 	m_commandBuffer.push_back(command);
 }
 
 sf::Color FieldsManager::GetColorByIndex(uint32_t index)
 {
-	return sf::Color::White;
+	return (index < PALETTE_SIZE) ? m_palette[index] : sf::Color::White;
+}
+
+FieldsManager::Palette FieldsManager::BuildPalette(const std::string & colors)
+{
+	static const sf::Uint8 BASIC[16][3] = {
+		{ 0, 0, 0 }, { 128, 0, 0 }, { 0, 128, 0 }, { 128, 128, 0 }, { 0, 0, 128 }, { 128, 0, 128 }, { 0, 128, 128 }, { 192, 192, 192 },
+		{ 128, 128, 128 }, { 255, 0, 0 }, { 0, 255, 0 }, { 255, 255, 0 }, { 0, 0, 255 }, { 255, 0, 255 }, { 0, 255, 255 }, { 255, 255, 255 } };
+	static const sf::Uint8 CUBE_LEVELS[6] = { 0, 95, 135, 175, 215, 255 };
+
+	Palette palette;
+	for (size_t i = 0; i < 16; i++) palette[i] = sf::Color(BASIC[i][0], BASIC[i][1], BASIC[i][2]);
+	for (size_t i = 0; i < 216; i++) palette[16 + i] = sf::Color(CUBE_LEVELS[i / 36], CUBE_LEVELS[i / 6 % 6], CUBE_LEVELS[i % 6]);
+	for (size_t i = 0; i < 24; i++) palette[232 + i] = sf::Color(sf::Uint8(8 + i * 10), sf::Uint8(8 + i * 10), sf::Uint8(8 + i * 10));
+
+	std::istringstream listStream(colors);
+	std::string item;
+	size_t index = 0;
+	while (std::getline(listStream, item, ';') && index < PALETTE_SIZE)
+	{
+		if (item.size() != 6 || item.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+		{
+			LOG_ERROR("Palette color #{0}={1} is not RRGGBB, standard color is kept", index, item);
+			index++;
+			continue;
+		}
+		uint32_t value = std::stoul(item, nullptr, 16);
+		palette[index++] = sf::Color(sf::Uint8(value >> 16), sf::Uint8(value >> 8), sf::Uint8(value));
+	}
+	if (index > 0) LOG_INFO("Palette has {} colors from settings", index);
+	return palette;
+}
+
+//return values:
+//0 - sucsess
+//2 - unknown command
+int FieldsManager::ParseAndExecuteDefaultColor(const std::string & command, sf::Color & color)
+{
+	if (command.size() == 6 && command[3] == '0')
+	{
+		color = GetColorByIndex(HexToInt(command.substr(4, 2)));
+	}
+	else if (command.size() == 10 && command[3] == '1')
+	{
+		color = sf::Color(HexToInt(command.substr(4, 2)), HexToInt(command.substr(6, 2)), HexToInt(command.substr(8, 2)));
+	}
+	else return 2;
+	//fields without own colors would look different when sent again
+	ClearFieldCommands();
+	LOG_HOT_DEBUG("Default color {0}={1}.{2}.{3}", command.substr(1, 2), color.r, color.g, color.b);
+	return 0;
+}
+
+//color attribute of text command the same as the given one
+static std::string FormatColorAttribute(char attribute, const sf::Color& color)
+{
+	return fmt::format("${0}1{1:02X}{2:02X}{3:02X}", attribute, color.r, color.g, color.b);
 }
 
 uint32_t FieldsManager::GetTransparencyByIndex(uint32_t index)
@@ -412,6 +746,11 @@ uint32_t FieldsManager::HexToInt(const std::string & str)
 	return value;
 }
 
+float FieldsManager::ParseCoordinate(const std::string & command, size_t index)
+{
+	return std::stof(command.substr(3 + index * m_coordinateDigits, m_coordinateDigits));
+}
+
 std::string FieldsManager::GetFormatstringByAttribute(const std::string & attribute)
 {
 	std::string returnValue = "";
@@ -431,7 +770,7 @@ std::string FieldsManager::GetFormatstringByAttribute(const std::string & attrib
 //2 - unknown command
 int FieldsManager::ParseAndExecuteTextField(std::string command)
 {
-	LOG_TRACE("ParseAndExecuteTextField enter with command={}", command);
+	LOG_HOT_TRACE("ParseAndExecuteTextField enter with command={}", command);
 
 	unsigned char majorMode = command[1];
 	unsigned char minorMode = command[2];
@@ -443,21 +782,21 @@ int FieldsManager::ParseAndExecuteTextField(std::string command)
 
 	if (minorMode == '0')
 	{
-		LOG_DEBUG("Determined minor mode 0");
+		LOG_HOT_DEBUG("Determined minor mode 0");
 	}
 	else if (minorMode == '4')
 	{
-		LOG_DEBUG("Determined minor mode 4");
+		LOG_HOT_DEBUG("Determined minor mode 4");
 		//4 koordinates
 		//checking length of field definition
-		if (textCommandStart != 16) return 2;
+		if (textCommandStart != 4 + 4 * m_coordinateDigits) return 2;
 
 		//extracting coordinates to rect
 		sf::FloatRect fieldRect;
-		fieldRect.left = std::stof(command.substr(3, 3));
-		fieldRect.top = std::stof(command.substr(9, 3));
-		fieldRect.width = std::stof(command.substr(6, 3)) - fieldRect.left + 1;
-		fieldRect.height = std::stof(command.substr(12, 3)) - fieldRect.top + 1;
+		fieldRect.left = ParseCoordinate(command, 0);
+		fieldRect.top = ParseCoordinate(command, 2);
+		fieldRect.width = ParseCoordinate(command, 1) - fieldRect.left + 1;
+		fieldRect.height = ParseCoordinate(command, 3) - fieldRect.top + 1;
 
 		size_t intersectResult = CheckFieldIntersects(fieldRect);
 		bool needFieldUpdate = false;
@@ -468,7 +807,7 @@ int FieldsManager::ParseAndExecuteTextField(std::string command)
 		}
 		else if (intersectResult == (UINT_MAX - 1))
 		{
-			LOG_DEBUG("Field doesn't intersect, need to create");
+			LOG_HOT_DEBUG("Field doesn't intersect, need to create");
 		}
 		else if (intersectResult == (UINT_MAX - 2))
 		{
@@ -477,7 +816,7 @@ int FieldsManager::ParseAndExecuteTextField(std::string command)
 		}
 		else
 		{
-			LOG_DEBUG("Field fully intersects");
+			LOG_HOT_DEBUG("Field fully intersects");
 			needFieldUpdate = true;
 		}
 
@@ -486,8 +825,10 @@ int FieldsManager::ParseAndExecuteTextField(std::string command)
 		uint32_t fontIndex = 2;  //$1
 		uint32_t textBlinking = 0;  //$6
 		uint32_t textAlligment = 3;  //$t
-		sf::Color textColor = sf::Color::White;  //$f
-		sf::Color textBGColor = sf::Color::Transparent;  //$h
+		sf::Color textColor = m_defaultColor;  //$f
+		sf::Color textBGColor = m_defaultBGColor;  //$h
+		bool colorGiven = false;
+		bool bgColorGiven = false;
 		uint32_t textAlpha = textColor.a;  //$T
 		uint32_t textBGAlpha = 255;  //$H
 		std::string datetimeCommand = "";   //$u
@@ -496,7 +837,7 @@ int FieldsManager::ParseAndExecuteTextField(std::string command)
 		uint32_t par1;
 		while (searchIndex != std::string::npos)
 		{
-			LOG_DEBUG("Text command={}", textCommand);
+			LOG_HOT_DEBUG("Text command={}", textCommand);
 			if (searchIndex >= textCommand.size()) break;
 			unsigned char atribute = textCommand[searchIndex + 1];
 
@@ -528,7 +869,8 @@ int FieldsManager::ParseAndExecuteTextField(std::string command)
 					textColor.b = HexToInt(textCommand.substr(searchIndex + 7, 2));
 					textCommand.erase(searchIndex, 9);
 				}
-				LOG_DEBUG("Found $f, searchIndex={0}, color={1}.{2}.{3}", searchIndex, textColor.r, textColor.g, textColor.b);
+				colorGiven = true;
+				LOG_HOT_DEBUG("Found $f, searchIndex={0}, color={1}.{2}.{3}", searchIndex, textColor.r, textColor.g, textColor.b);
 				break;
 			case 'h':  //$h...				
 				par1 = std::stoi(textCommand.substr(searchIndex + 2, 1));
@@ -544,7 +886,8 @@ int FieldsManager::ParseAndExecuteTextField(std::string command)
 					textBGColor.b = HexToInt(textCommand.substr(searchIndex + 7, 2));
 					textCommand.erase(searchIndex, 9);
 				}
-				LOG_DEBUG("Found $h, searchIndex={0}, color={1}.{2}.{3}", searchIndex, textBGColor.r, textBGColor.g, textBGColor.b);
+				bgColorGiven = true;
+				LOG_HOT_DEBUG("Found $h, searchIndex={0}, color={1}.{2}.{3}", searchIndex, textBGColor.r, textBGColor.g, textBGColor.b);
 				break;
 			case 'T':  //$T...
 				textAlpha = GetTransparencyByIndex(HexToInt(textCommand.substr(searchIndex + 2, 1)));
@@ -568,26 +911,35 @@ int FieldsManager::ParseAndExecuteTextField(std::string command)
 		textColor.a = textAlpha;
 		if (textBGColor.r != 0 || textBGColor.g != 0 || textBGColor.b != 0) textBGColor.a = textBGAlpha;
 
+		//defaults are not restored after restart, saved command gets colors it was shown with
+		std::string sceneCommand = command;
+		std::string defaultAttributes;
+		if (colorGiven == false && m_defaultColor != sf::Color::White) defaultAttributes += FormatColorAttribute('f', m_defaultColor);
+		if (bgColorGiven == false && m_defaultBGColor != sf::Color::Transparent) defaultAttributes += FormatColorAttribute('h', m_defaultBGColor);
+		sceneCommand.insert(textCommandStart + 3, defaultAttributes);
+
 		if (needFieldUpdate == false)
 		{
 			//no field intersection, creating field
-			LOG_DEBUG("Creating new field with text={}", textCommand);				
-			LDPField* field = new LDPField();
+			LOG_HOT_DEBUG("Creating new field with text={}", textCommand);				
+			LDPField* field = CreateField(fieldRect);
 			/*if (m_fieldsArray.size() > 0)
 			{
 				field->setCurrentMicro(m_fieldsArray[0]->getCurrentMicro());
 				field->setLastUpdateMicro(m_fieldsArray[0]->getLastUpdateMicro());
 			}*/
-			field->setFont(m_pSettings->GetString(S_DEFAULTFONT));
-			LOG_DEBUG("Field font={}", m_pSettings->GetString(S_DEFAULTFONT));
+			field->setTextCache(&m_textCache);
+			field->setRasterPool(&m_rasterPool);
+			field->setFont(m_pSettings->GetSnapshot().defaultFont);
+			LOG_HOT_DEBUG("Field font={}", m_pSettings->GetSnapshot().defaultFont);
 			field->setBGColor(textBGColor);
-			LOG_DEBUG("Field BGColor={0}.{1}.{2} a={3}", textBGColor.r, textBGColor.g, textBGColor.b, textBGColor.a);
+			LOG_HOT_DEBUG("Field BGColor={0}.{1}.{2} a={3}", textBGColor.r, textBGColor.g, textBGColor.b, textBGColor.a);
 			field->setBounds(fieldRect);
 			field->setTextSize(fontIndex + 1);
-			LOG_DEBUG("Field fontsize={}", field->getTextSize());
+			LOG_HOT_DEBUG("Field fontsize={}", field->getTextSize());
 			field->setTextStyle(sf::Text::Style::Regular);
 			field->setTextColor(textColor);
-			LOG_DEBUG("Field TextColor={0}.{1}.{2} a={3}", textColor.r, textColor.g, textColor.b, textColor.a);
+			LOG_HOT_DEBUG("Field TextColor={0}.{1}.{2} a={3}", textColor.r, textColor.g, textColor.b, textColor.a);
 			//std::string strTemp = command.substr(textCommandStart + 3);
 			field->setTextString(textCommand);
 			LDPField::DisplayType ali = LDPField::DisplayType::OptionalLeft;
@@ -598,50 +950,54 @@ int FieldsManager::ParseAndExecuteTextField(std::string command)
 				std::string formatTemp = GetFormatstringByAttribute(datetimeCommand);
 				field->setFormatString(formatTemp);
 				ali = LDPField::DisplayType::DateTime;
-				LOG_DEBUG("Field format string={}", formatTemp);
+				LOG_HOT_DEBUG("Field format string={}", formatTemp);
 			}
 			field->setDisplayType(ali);
 			field->setTextSpeed(m_textRunningSpeed);
-			m_fieldsArray.push_back(field);
-			LOG_DEBUG("Added new field to field pool");			
+			m_sceneSnapshot.SetField(field->getSlot(), sceneCommand);
+			RememberFieldCommand(field->getSlot());
+			LOG_HOT_DEBUG("Added new field to field pool");			
 		}
 		else
 		{
 			//field fully intersect, need update
-			LOG_DEBUG("Changing field with text={}", textCommand);
-			//LOG_DEBUG("Field metrics need update before={}", m_fieldsArray[intersectResult]->getMetricsNeedUpdate());
-			m_fieldsArray[intersectResult]->setFont(m_pSettings->GetString(S_DEFAULTFONT));
-			//LOG_TRACE("Metrics update={}",m_fieldsArray[intersectResult]->getMetricsNeedUpdate());
-			LOG_DEBUG("Field font={}", m_pSettings->GetString(S_DEFAULTFONT));
-			m_fieldsArray[intersectResult]->setBGColor(textBGColor);
-			//LOG_TRACE("Metrics update={}", m_fieldsArray[intersectResult]->getMetricsNeedUpdate());
-			LOG_DEBUG("Field BGColor={0}.{1}.{2} a={3}", textBGColor.r, textBGColor.g, textBGColor.b, textBGColor.a);
-			m_fieldsArray[intersectResult]->setBounds(fieldRect);
-			m_fieldsArray[intersectResult]->setTextSize(fontIndex + 1);
-			//LOG_TRACE("Metrics update={}", m_fieldsArray[intersectResult]->getMetricsNeedUpdate());
-			LOG_DEBUG("Field fontsize={}", m_fieldsArray[intersectResult]->getTextSize());
-			m_fieldsArray[intersectResult]->setTextStyle(sf::Text::Style::Regular);
-			m_fieldsArray[intersectResult]->setTextColor(textColor);
-			//LOG_TRACE("Metrics update={}", m_fieldsArray[intersectResult]->getMetricsNeedUpdate());
-			LOG_DEBUG("Field TextColor={0}.{1}.{2} a={3}", textColor.r, textColor.g, textColor.b, textColor.a);
-			m_fieldsArray[intersectResult]->setTextString(textCommand);
-			//LOG_TRACE("Metrics update={}", m_fieldsArray[intersectResult]->getMetricsNeedUpdate());
+			LOG_HOT_DEBUG("Changing field with text={}", textCommand);
+			LDPField* existingField = &m_fieldStore.GetBySlot((uint32_t)intersectResult);
+			//LOG_DEBUG("Field metrics need update before={}", existingField->getMetricsNeedUpdate());
+			existingField->setFont(m_pSettings->GetSnapshot().defaultFont);
+			//LOG_TRACE("Metrics update={}",existingField->getMetricsNeedUpdate());
+			LOG_HOT_DEBUG("Field font={}", m_pSettings->GetSnapshot().defaultFont);
+			existingField->setBGColor(textBGColor);
+			//LOG_TRACE("Metrics update={}", existingField->getMetricsNeedUpdate());
+			LOG_HOT_DEBUG("Field BGColor={0}.{1}.{2} a={3}", textBGColor.r, textBGColor.g, textBGColor.b, textBGColor.a);
+			existingField->setBounds(fieldRect);
+			existingField->setTextSize(fontIndex + 1);
+			//LOG_TRACE("Metrics update={}", existingField->getMetricsNeedUpdate());
+			LOG_HOT_DEBUG("Field fontsize={}", existingField->getTextSize());
+			existingField->setTextStyle(sf::Text::Style::Regular);
+			existingField->setTextColor(textColor);
+			//LOG_TRACE("Metrics update={}", existingField->getMetricsNeedUpdate());
+			LOG_HOT_DEBUG("Field TextColor={0}.{1}.{2} a={3}", textColor.r, textColor.g, textColor.b, textColor.a);
+			existingField->setTextString(textCommand);
+			//LOG_TRACE("Metrics update={}", existingField->getMetricsNeedUpdate());
 			LDPField::DisplayType ali = LDPField::DisplayType::OptionalLeft;
 			if (textAlligment == 1) ali = LDPField::DisplayType::RightAlign;
 			else if (textAlligment == 2) ali = LDPField::DisplayType::CenterAlign;
 			if (datetimeCommand != "")
 			{
 				std::string formatTemp = GetFormatstringByAttribute(datetimeCommand);
-				m_fieldsArray[intersectResult]->setFormatString(formatTemp);
+				existingField->setFormatString(formatTemp);
 				ali = LDPField::DisplayType::DateTime;
-				//LOG_TRACE("Metrics update={}", m_fieldsArray[intersectResult]->getMetricsNeedUpdate());
-				LOG_DEBUG("Field format string={}", formatTemp);
+				//LOG_TRACE("Metrics update={}", existingField->getMetricsNeedUpdate());
+				LOG_HOT_DEBUG("Field format string={}", formatTemp);
 			}
-			m_fieldsArray[intersectResult]->setDisplayType(ali);
-			m_fieldsArray[intersectResult]->setTextSpeed(m_textRunningSpeed);
-			//LOG_TRACE("Metrics update={}", m_fieldsArray[intersectResult]->getMetricsNeedUpdate());
-			LOG_DEBUG("Updated field");
-			//LOG_DEBUG("Field metrics need update after={}", m_fieldsArray[intersectResult]->getMetricsNeedUpdate());
+			existingField->setDisplayType(ali);
+			existingField->setTextSpeed(m_textRunningSpeed);
+			//LOG_TRACE("Metrics update={}", existingField->getMetricsNeedUpdate());
+			m_sceneSnapshot.SetField(existingField->getSlot(), sceneCommand);
+			RememberFieldCommand(existingField->getSlot());
+			LOG_HOT_DEBUG("Updated field");
+			//LOG_DEBUG("Field metrics need update after={}", existingField->getMetricsNeedUpdate());
 		}
 	}
 
@@ -654,132 +1010,136 @@ int FieldsManager::ParseAndExecuteTextField(std::string command)
 //2 - unknown command
 int FieldsManager::ParseAndExecuteRectangle(std::string command)
 {
-	LOG_TRACE("ParseAndExecuteRectangle enter");
+	LOG_HOT_TRACE("ParseAndExecuteRectangle enter");
 
 	std::string commandType = command.substr(1, 2);
 
 	sf::FloatRect fieldRect;
-	sf::Color bgColor = sf::Color::White;
+	sf::Color bgColor = m_defaultColor;
 	size_t commandSize = command.size();
 	uint32_t par1;
+	//attributes after 3 or 4 coordinates move when coordinates are longer than 3 digits
+	const size_t shift3 = 3 * (m_coordinateDigits - 3);
+	const size_t shift4 = 4 * (m_coordinateDigits - 3);
 
 	if (commandType == "40")        //white horizontal line
 	{
-		if (commandSize != 13) return 2;
+		if (commandSize != 13 + shift3) return 2;
 
-		float x1 = std::stof(command.substr(3, 3));
-		float x2 = std::stof(command.substr(6, 3));
+		float x1 = ParseCoordinate(command, 0);
+		float x2 = ParseCoordinate(command, 1);
 
 		fieldRect.left = std::min(x1, x2);
 		fieldRect.width = std::max(x1, x2) - fieldRect.left;
-		float thickness = std::stof(command.substr(12, 1));
+		float thickness = std::stof(command.substr(12 + shift3, 1));
 		if (thickness < 1) thickness = 1;
 		fieldRect.height = thickness;
-		fieldRect.top = std::stof(command.substr(9, 3)) - thickness + 1;
+		fieldRect.top = ParseCoordinate(command, 2) - thickness + 1;
 	}
 	else if (commandType == "41")   //white vertical line
 	{
-		if (commandSize != 13) return 2;
+		if (commandSize != 13 + shift3) return 2;
 
-		float y1 = std::stof(command.substr(6, 3));
-		float y2 = std::stof(command.substr(9, 3));
+		float y1 = ParseCoordinate(command, 1);
+		float y2 = ParseCoordinate(command, 2);
 
 		fieldRect.top = std::min(y1, y2);
 		fieldRect.height = std::max(y1, y2) - fieldRect.top + 1;
-		fieldRect.left = std::stof(command.substr(3, 3));
-		float thickness = std::stof(command.substr(12, 1));
+		fieldRect.left = ParseCoordinate(command, 0);
+		float thickness = std::stof(command.substr(12 + shift3, 1));
 		if (thickness < 1) thickness = 1;
 		fieldRect.width = thickness;
 	}
 	else if (commandType == "42")   //white rectangle
 	{
-		if (commandSize != 15) return 2;
+		if (commandSize != 15 + shift4) return 2;
 
-		fieldRect.top = std::stof(command.substr(9, 3));
-		fieldRect.height = std::stof(command.substr(12, 3)) - fieldRect.top + 1;
-		fieldRect.left = std::stof(command.substr(3, 3));
-		fieldRect.width = std::stof(command.substr(6, 3)) - fieldRect.left + 1;
+		fieldRect.top = ParseCoordinate(command, 2);
+		fieldRect.height = ParseCoordinate(command, 3) - fieldRect.top + 1;
+		fieldRect.left = ParseCoordinate(command, 0);
+		fieldRect.width = ParseCoordinate(command, 1) - fieldRect.left + 1;
 	}
 	else if (commandType == "43")   //colored horizontal line
 	{
-		if ((commandSize != 21)&&(commandSize != 17)) return 2;
+		if ((commandSize != 21 + shift3)&&(commandSize != 17 + shift3)) return 2;
 
-		float x1 = std::stof(command.substr(3, 3));
-		float x2 = std::stof(command.substr(6, 3));
+		float x1 = ParseCoordinate(command, 0);
+		float x2 = ParseCoordinate(command, 1);
 
 		fieldRect.left = std::min(x1, x2);
 		fieldRect.width = std::max(x1, x2) - fieldRect.left;
-		float thickness = std::stof(command.substr(12, 1));
+		float thickness = std::stof(command.substr(12 + shift3, 1));
 		if (thickness < 1) thickness = 1;
 		fieldRect.height = thickness;
-		fieldRect.top = std::stof(command.substr(9, 3)) - thickness + 1;
+		fieldRect.top = ParseCoordinate(command, 2) - thickness + 1;
 
-		par1 = std::stoi(command.substr(13, 1));
+		par1 = std::stoi(command.substr(13 + shift3, 1));
 		if (par1 == 0)
 		{
-			bgColor = GetColorByIndex(HexToInt(command.substr(14, 2)));			
+			bgColor = GetColorByIndex(HexToInt(command.substr(14 + shift3, 2)));			
 		}
 		else if (par1 == 1)
 		{
-			bgColor.r = HexToInt(command.substr(14, 2));
-			bgColor.g = HexToInt(command.substr(16, 2));
-			bgColor.b = HexToInt(command.substr(18, 2));
-			bgColor.a = GetTransparencyByIndex(HexToInt(command.substr(20, 1)));
+			bgColor.r = HexToInt(command.substr(14 + shift3, 2));
+			bgColor.g = HexToInt(command.substr(16 + shift3, 2));
+			bgColor.b = HexToInt(command.substr(18 + shift3, 2));
+			bgColor.a = GetTransparencyByIndex(HexToInt(command.substr(20 + shift3, 1)));
 		}
 	}
 	else if (commandType == "44")   //colored vertical line
 	{
-		if ((commandSize != 21) && (commandSize != 17)) return 2;
+		if ((commandSize != 21 + shift3) && (commandSize != 17 + shift3)) return 2;
 
-		float y1 = std::stof(command.substr(6, 3));
-		float y2 = std::stof(command.substr(9, 3));
+		float y1 = ParseCoordinate(command, 1);
+		float y2 = ParseCoordinate(command, 2);
 
 		fieldRect.top = std::min(y1, y2);
 		fieldRect.height = std::max(y1, y2) - fieldRect.top + 1;
-		fieldRect.left = std::stof(command.substr(3, 3));
-		float thickness = std::stof(command.substr(12, 1));
+		fieldRect.left = ParseCoordinate(command, 0);
+		float thickness = std::stof(command.substr(12 + shift3, 1));
 		if (thickness < 1) thickness = 1;
 		fieldRect.width = thickness;
 
-		par1 = std::stoi(command.substr(13, 1));
+		par1 = std::stoi(command.substr(13 + shift3, 1));
 		if (par1 == 0)
 		{
-			bgColor = GetColorByIndex(HexToInt(command.substr(14, 2)));
+			bgColor = GetColorByIndex(HexToInt(command.substr(14 + shift3, 2)));
 		}
 		else if (par1 == 1)
 		{
-			bgColor.r = HexToInt(command.substr(14, 2));
-			bgColor.g = HexToInt(command.substr(16, 2));
-			bgColor.b = HexToInt(command.substr(18, 2));
-			bgColor.a = GetTransparencyByIndex(HexToInt(command.substr(20, 1)));
+			bgColor.r = HexToInt(command.substr(14 + shift3, 2));
+			bgColor.g = HexToInt(command.substr(16 + shift3, 2));
+			bgColor.b = HexToInt(command.substr(18 + shift3, 2));
+			bgColor.a = GetTransparencyByIndex(HexToInt(command.substr(20 + shift3, 1)));
 		}
 	}
 	else if (commandType == "45")   //colored rectangle
 	{
-		if ((commandSize != 19) && (commandSize != 23)) return 2;
+		if ((commandSize != 19 + shift4) && (commandSize != 23 + shift4)) return 2;
 
-		fieldRect.top = std::stof(command.substr(9, 3));
-		fieldRect.height = std::stof(command.substr(12, 3)) - fieldRect.top + 1;
-		fieldRect.left = std::stof(command.substr(3, 3));
-		fieldRect.width = std::stof(command.substr(6, 3)) - fieldRect.left + 1;
+		fieldRect.top = ParseCoordinate(command, 2);
+		fieldRect.height = ParseCoordinate(command, 3) - fieldRect.top + 1;
+		fieldRect.left = ParseCoordinate(command, 0);
+		fieldRect.width = ParseCoordinate(command, 1) - fieldRect.left + 1;
 
-		par1 = std::stoi(command.substr(15, 1));
+		par1 = std::stoi(command.substr(15 + shift4, 1));
 		if (par1 == 0)
 		{
-			bgColor = GetColorByIndex(HexToInt(command.substr(16, 2)));
+			bgColor = GetColorByIndex(HexToInt(command.substr(16 + shift4, 2)));
 		}
 		else if (par1 == 1)
 		{
-			bgColor.r = HexToInt(command.substr(16, 2));
-			bgColor.g = HexToInt(command.substr(18, 2));
-			bgColor.b = HexToInt(command.substr(20, 2));
-			bgColor.a = GetTransparencyByIndex(HexToInt(command.substr(22, 1)));
+			bgColor.r = HexToInt(command.substr(16 + shift4, 2));
+			bgColor.g = HexToInt(command.substr(18 + shift4, 2));
+			bgColor.b = HexToInt(command.substr(20 + shift4, 2));
+			bgColor.a = GetTransparencyByIndex(HexToInt(command.substr(22 + shift4, 1)));
 		}
 	}
 	else return 2;
 
 	//looking for field intersection
-	size_t intersectResult = CheckFieldIntersects(fieldRect);
+	bool reused = false;
+	size_t intersectResult = CheckFieldIntersects(fieldRect, &reused);
 	if (intersectResult == UINT_MAX)
 	{
 		LOG_ERROR("Field intersects another field, ignoring");
@@ -787,30 +1147,42 @@ int FieldsManager::ParseAndExecuteRectangle(std::string command)
 	}
 	else if (intersectResult == (UINT_MAX - 1))
 	{
-		LOG_DEBUG("Field doesn't intersect, need to create");
+		LOG_HOT_DEBUG("Field doesn't intersect, need to create");
 	}
 	else if (intersectResult == (UINT_MAX - 2))
 	{
 		LOG_ERROR("Field is out of bounds, ignoring");
 		return 1;
 	}
-	else
+	else if (reused == false)
 	{
-		LOG_DEBUG("Field fully intersects, ignoring");
+		LOG_HOT_DEBUG("Field fully intersects, ignoring");
 		return 0;
 	}
 
-	//no field intersection, creating field
-	LOG_DEBUG("Creating new field with bounds=X{0},{1} Y{2},{3}", fieldRect.left, fieldRect.left + fieldRect.width, fieldRect.top, fieldRect.top + fieldRect.height);
-	LDPField* field = new LDPField();
-	/*if (m_fieldsArray.size() > 0)
+	LDPField* field;
+	if (reused == false)
+	{
+		//no field intersection, creating field
+		LOG_HOT_DEBUG("Creating new field with bounds=X{0},{1} Y{2},{3}", fieldRect.left, fieldRect.left + fieldRect.width, fieldRect.top, fieldRect.top + fieldRect.height);
+		field = CreateField(fieldRect);
+		/*if (m_fieldsArray.size() > 0)
+		{
+			field->setCurrentMicro(m_fieldsArray[0]->getCurrentMicro());
+			field->setLastUpdateMicro(m_fieldsArray[0]->getLastUpdateMicro());
+		}*/
+		field->setTextCache(&m_textCache);
+		field->setRasterPool(&m_rasterPool);
+	}
+	else
 	{
-		field->setCurrentMicro(m_fieldsArray[0]->getCurrentMicro());
-		field->setLastUpdateMicro(m_fieldsArray[0]->getLastUpdateMicro());
-	}*/
-	field->setFont(m_pSettings->GetString(S_DEFAULTFONT));
+		//field left by %23 at the same place, setters below keep unchanged text rendered
+		LOG_HOT_DEBUG("Reusing field with bounds=X{0},{1} Y{2},{3}", fieldRect.left, fieldRect.left + fieldRect.width, fieldRect.top, fieldRect.top + fieldRect.height);
+		field = &m_fieldStore.GetBySlot((uint32_t)intersectResult);
+	}
+	field->setFont(m_pSettings->GetSnapshot().defaultFont);
 	field->setBGColor(bgColor);
-	LOG_DEBUG("Field Color={0}.{1}.{2} a={3}", bgColor.r, bgColor.g, bgColor.b, bgColor.a);
+	LOG_HOT_DEBUG("Field Color={0}.{1}.{2} a={3}", bgColor.r, bgColor.g, bgColor.b, bgColor.a);
 	field->setBounds(fieldRect);
 	field->setTextSize(5);
 	field->setTextStyle(sf::Text::Style::Regular);
@@ -818,20 +1190,59 @@ int FieldsManager::ParseAndExecuteRectangle(std::string command)
 	field->setTextString("");
 	field->setDisplayType(LDPField::DisplayType::LeftAlign);
 	field->setTextSpeed(m_textRunningSpeed);
-	m_fieldsArray.push_back(field);
-	LOG_DEBUG("Added new field to field pool");
+
+	//white lines drawn in default color are saved as colored ones, defaults are not restored after restart
+	std::string sceneCommand = command;
+	if (m_defaultColor != sf::Color::White && (commandType == "40" || commandType == "41" || commandType == "42"))
+	{
+		sceneCommand[2] += 3;
+		sceneCommand += fmt::format("1{0:02X}{1:02X}{2:02X}F", m_defaultColor.r, m_defaultColor.g, m_defaultColor.b);
+	}
+	m_sceneSnapshot.SetField(field->getSlot(), sceneCommand);
+	RememberFieldCommand(field->getSlot());
+	LOG_HOT_DEBUG("Added new field to field pool");
 
 	return 0;
 }
 
 void FieldsManager::DeleteAllFields()
 {
-	LOG_TRACE("DeleteAllFields enter");
+	LOG_HOT_TRACE("DeleteAllFields enter");
 
 	std::lock_guard<std::recursive_mutex> mut(m_fieldArrayMutex);	
-	LOG_TRACE("Fields to delete={}", m_fieldsArray.size());
-	std::for_each(m_fieldsArray.begin(), m_fieldsArray.end(), std::default_delete<LDPField>());
-	m_fieldsArray.clear();
+	LOG_HOT_TRACE("Fields to delete={}", m_fieldStore.GetCount());
+	FlightRecorder::Get().Record(FlightEvent::FieldsCleared, 0, m_fieldStore.GetCount());
+	m_fieldStore.Clear();
+	m_fieldIndex.Clear();
+	m_haveFieldsPendingDelete = false;
+	m_sceneSnapshot.ClearAll();
+	ClearFieldCommands();
+}
+
+void FieldsManager::MarkFieldsForDelete()
+{
+	LOG_HOT_TRACE("MarkFieldsForDelete enter");
+
+	std::lock_guard<std::recursive_mutex> mut(m_fieldArrayMutex);
+	LOG_HOT_TRACE("Fields marked for delete={}", m_fieldStore.GetCount());
+	for (uint32_t slot : m_fieldStore.GetLiveSlots()) m_fieldStore.SetPendingDelete(slot, true);
+	m_haveFieldsPendingDelete = true;
+	m_reusedFieldCount = 0;
+}
+
+void FieldsManager::DeletePendingFields()
+{
+	if (m_haveFieldsPendingDelete == false) return;
+
+	std::lock_guard<std::recursive_mutex> mut(m_fieldArrayMutex);
+	std::vector<FieldHandle> unused;
+	for (uint32_t slot : m_fieldStore.GetLiveSlots())
+	{
+		if (m_fieldStore.IsPendingDelete(slot)) unused.push_back(m_fieldStore.GetHandle(slot));
+	}
+	for (FieldHandle handle : unused) DeleteField(handle);
+	LOG_HOT_DEBUG("Delete all finished, reused fields={0}, deleted fields={1}", m_reusedFieldCount, unused.size());
+	m_haveFieldsPendingDelete = false;
 }
 
 void FieldsManager::DeleteAndFallback()
@@ -840,6 +1251,7 @@ void FieldsManager::DeleteAndFallback()
 	DeleteAllFields();
 	m_lastUpdated = m_internalClock.now() - std::chrono::hours(24);
 	m_displayFallback = true;
+	FlightRecorder::Get().Record(FlightEvent::FallbackShown, 1);
 }
 
 void FieldsManager::ExecuteTimeChange(std::string command)
@@ -870,6 +1282,17 @@ void FieldsManager::ExecuteTimeChange(std::string command)
 	time.wSecond = WORD(ss);
 
 	if (SetLocalTime(&time) == false) LOG_ERROR("Time change failed");
+	else FlightRecorder::Get().Record(FlightEvent::TimeChanged, 0, time.wHour * 10000 + time.wMinute * 100 + time.wSecond);
+}
+
+void FieldsManager::TickClocks()
+{
+	std::lock_guard<std::recursive_mutex> mut(m_fieldArrayMutex);
+	const std::vector<uint8_t>& flags = m_fieldStore.GetHotData().flags;
+	for (uint32_t slot : m_fieldStore.GetLiveSlots())
+	{
+		if (flags[slot] & FieldHotData::DateTime) m_fieldStore.GetBySlot(slot).tickClock();
+	}
 }
 
 void FieldsManager::CheckAndUpdateFallback()
@@ -877,7 +1300,7 @@ void FieldsManager::CheckAndUpdateFallback()
 	auto time = m_internalClock.now();
 	auto elapsed = time - m_lastUpdated;
 
-	size_t timeout = m_pSettings->GetUInt(S_FALLBACKTIMEOUT);
+	size_t timeout = m_pSettings->GetSnapshot().fallbackTimeout;
 	if (timeout == 0)
 	{
 		//check only to transition from fallback to display
@@ -885,6 +1308,7 @@ void FieldsManager::CheckAndUpdateFallback()
 		{
 			LOG_DEBUG("Was update on internal timer, hiding fallback");
 			m_displayFallback = false;
+			FlightRecorder::Get().Record(FlightEvent::FallbackShown, 0);
 		}
 	}
 	else
@@ -896,6 +1320,7 @@ void FieldsManager::CheckAndUpdateFallback()
 			{
 				LOG_DEBUG("Was update on internal timer, hiding fallback");
 				m_displayFallback = false;
+				FlightRecorder::Get().Record(FlightEvent::FallbackShown, 0);
 			}
 		}
 		else  //check to transition from display to fallback
@@ -910,15 +1335,56 @@ void FieldsManager::CheckAndUpdateFallback()
 	}
 }
 
+void FieldsManager::RestoreScene()
+{
+	std::string fileName = m_pSettings->GetString(S_SCENEFILE);
+	if (fileName.empty()) return;
+	if (m_sceneSnapshot.Open(fileName, m_pSettings->GetUInt(S_SCENEMAXFIELDS)) == false) return;
+
+	auto start = std::chrono::steady_clock::now();
+	std::time_t updated;
+	std::vector<std::string> commands = m_sceneSnapshot.TakeCommands(updated);
+	if (commands.empty())
+	{
+		LOG_INFO("No saved scene to restore");
+		return;
+	}
+
+	std::time_t age = std::max(std::time(nullptr) - updated, (std::time_t)0);
+	size_t timeout = m_pSettings->GetUInt(S_FALLBACKTIMEOUT);
+	if (timeout != 0 && age >= (std::time_t)timeout)
+	{
+		LOG_INFO("Saved scene is {0} seconds old, fallback timeout is {1} seconds, not restoring", age, timeout);
+		return;
+	}
+
+	std::lock_guard<std::recursive_mutex> mut(m_fieldArrayMutex);
+	size_t restored = 0;
+	for (const std::string& command : commands)
+	{
+		if (ParseAndExecuteCommand(command) == 0) restored++;
+	}
+	//scene keeps its age, fallback is shown when the controller stays silent for the rest of timeout
+	m_sceneSnapshot.Commit(updated);
+	if (timeout != 0) m_lastUpdated = m_internalClock.now() - std::chrono::seconds(age);
+	else m_lastUpdated = m_internalClock.now();
+	m_displayFallback = false;
+	FlightRecorder::Get().Record(FlightEvent::FallbackShown, 0);
+
+	double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	LOG_INFO("Restored {0} of {1} fields saved {2} seconds ago in {3:.1f} ms", restored, commands.size(), age, elapsedMs);
+}
+
 void FieldsManager::MoveDataFromSerial()
 {
-	LOG_TRACE("Buffer copy from serial enter");
+	LOG_HOT_TRACE("Buffer copy from serial enter");
 	size_t needToRead = m_serial.GetBytesToRead();
 	std::string t = m_serial.readString();
 
 	m_readQueueBuffer.append(t);
 	m_readBufferSize = m_readQueueBuffer.size();
 	size_t copied = t.size();
+	Metrics::Add(Metrics::BytesReceived, copied);
 	LOG_INFO("Copyed {} bytes to internal buffer", copied);
 	if (copied != needToRead)
 	{
@@ -926,6 +1392,34 @@ void FieldsManager::MoveDataFromSerial()
 	}
 }
 
+void FieldsManager::prewarmThreadFunction(std::string fontName, std::vector<uint32_t> sizes)
+{
+	if (TextRasterizer::CheckFont(fontName) == false)
+	{
+		LOG_ERROR("Glyph pre-warm skipped, can't load font={}", fontName);
+		return;
+	}
+
+	std::vector<sf::Uint32> codePoints;
+	for (unsigned c = 0; c < 256; c++)
+	{
+		if (Cp1251::IsPrintable((unsigned char)c)) codePoints.push_back(Cp1251::ToUtf32((unsigned char)c));
+	}
+
+	//own rasterizer, glyphs go to shared GlyphCache and reach workers from there
+	TextRasterizer rasterizer;
+	auto start = std::chrono::steady_clock::now();
+	size_t rendered = 0;
+	for (uint32_t size : sizes)
+	{
+		if (m_running.load() == false) return;
+		rendered += rasterizer.Prewarm(fontName, size, codePoints);
+	}
+	auto spent = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	LOG_INFO("Glyph pre-warm of font={0} done in {1} ms, sizes={2}, glyphs rendered={3}, cache glyphs={4}, cache memory={5} KB, evicted={6}",
+		fontName, spent, sizes.size(), rendered, GlyphCache::Get().GetCount(), GlyphCache::Get().GetMemoryUsed() / 1024, GlyphCache::Get().GetEvictions());
+}
+
 void FieldsManager::workThreadFunction()
 {
 	LOG_DEBUG("Work thread enter");
@@ -950,11 +1444,11 @@ void FieldsManager::workThreadFunction()
 	{
 		try
 		{
-			if (m_serial.GetBytesToRead() > 0)
+			if (m_serial.isOpen() && m_serial.GetBytesToRead() > 0)
 			{
-				LOG_DEBUG("Ready to read some data from serial object");
+				LOG_HOT_DEBUG("Ready to read some data from serial object");
 				MoveDataFromSerial();
-				LOG_DEBUG("Resulting internal buffer={}", m_readQueueBuffer);
+				LOG_HOT_DEBUG("Resulting internal buffer={}", m_readQueueBuffer);
 			}
 
 			if (m_readQueueBuffer.size() != 0)
@@ -964,7 +1458,8 @@ void FieldsManager::workThreadFunction()
 				{
 					std::string packet = m_readQueueBuffer.substr(start, finish - start + 1);
 					m_readQueueBuffer.erase(start, finish - start + 1);
-					LOG_DEBUG("Buffer after erasing current packet={}", m_readQueueBuffer);
+					FlightRecorder::Get().Record(FlightEvent::PacketReceived, (uint16_t)packet.size(), m_readQueueBuffer.size());
+					LOG_HOT_DEBUG("Buffer after erasing current packet={}", m_readQueueBuffer);
 
 					SplitPacketToCommands(packet);
 				}
@@ -973,10 +1468,10 @@ void FieldsManager::workThreadFunction()
 			//work with commands
 			if (m_commandBuffer.size() != 0)
 			{
-				LOG_DEBUG("Command buffer is not empty, logging:");
+				LOG_HOT_DEBUG("Command buffer is not empty, logging:");
 				for (size_t i = 0; i < m_commandBuffer.size(); i++)
 				{
-					LOG_DEBUG("Element #{0}={1}", i, m_commandBuffer[i]);
+					LOG_HOT_DEBUG("Element #{0}={1}", i, m_commandBuffer[i]);
 				}
 
 				int tmp = ExecuteCommands();
@@ -984,24 +1479,33 @@ void FieldsManager::workThreadFunction()
 				if (tmp == 0) answer = m_goodAnswer;
 				else if (tmp == 1) answer = m_fieldPositionAnswer;
 				else answer = m_unknownModeAnswer;
-				LOG_DEBUG("Returning answer, string={0}", answer);
-				m_serial.writeString(answer);
+				LOG_HOT_DEBUG("Returning answer, string={0}", answer);
+				if (m_serial.isOpen()) m_serial.writeString(answer);
 			}
 
 			//check fallback
 			CheckAndUpdateFallback();
 
+			//log statistics
+			if (m_internalClock.now() - m_lastStatisticsLog > STATISTICS_LOG_INTERVAL)
+			{
+				m_lastStatisticsLog = m_internalClock.now();
+				m_textCache.LogStatistics();
+			}
+
 			std::this_thread::yield();
 			std::this_thread::sleep_for(std::chrono::milliseconds(100));
 		}
 		catch (std::exception& e)
 		{
 			LOG_CRITICAL("Exception in work thread with message: {0}", e.what());
+			FlightRecorder::Get().RecordText(FlightEvent::Exception, 0, e.what(), MAX_RECORDED_EXCEPTION);
 			break;
 		}
 		catch (...)
 		{
 			LOG_CRITICAL("Exception of unknown type in work thread, exiting");
+			FlightRecorder::Get().RecordText(FlightEvent::Exception, 0, "unknown type", MAX_RECORDED_EXCEPTION);
 			break;
 		}
 	}
@@ -1,28 +1,55 @@
 #pragma once
+#include <array>
 #include <thread>
 #include <mutex>
+#include <unordered_map>
 
 //#include "AsyncSerial.h"
 #include "BufferedAsyncSerial.h"
 #include "LDPField.h"
+#include "FieldIndex.h"
+#include "FieldStore.h"
+#include "SceneSnapshot.h"
 #include "INIFile.h"
+#include "TextCache.h"
+#include "RasterWorkerPool.h"
+#include "RenderBackend.h"
+#include "FallbackPlaylist.h"
+#include "MediaField.h"
+#include "TimerWheel.h"
 
 class FieldsManager
 {
 public:
-	FieldsManager(const std::string& devname, unsigned int baud_rate, INIFile* settingsObject);
+	//running text steps and date/time clocks are timers of render thread wheel
+	FieldsManager(const std::string& devname, unsigned int baud_rate, INIFile* settingsObject, TimerWheel* timers);
 	~FieldsManager();
 
-	void DrawFields(sf::RenderWindow& wnd);
+	void DrawFields(RenderBackend& backend);
+	//fields and their bitmaps stay unchanged while lock is held, for backends drawing after DrawFields returns
+	std::unique_lock<std::recursive_mutex> LockFields();
 	//bool UpdateFields(sf::Time elapsed);
-	bool UpdateFields(sf::Int64 elapsed, bool forceLog);
-	void ResetTimers();
+	bool UpdateFields(RenderBackend& backend, sf::Int64 elapsed, bool forceLog);
+	//logs smoothness of every running text and starts new measurement period
+	void LogScrollStatistics();
 
 	void ExecuteExternalCommand(std::string command);
+	//handles packet the same way as one from serial, returns 0 - sucsess, 1 - fields intersection, 2 - unknown command
+	int ExecutePacket(const std::string& packet);
+
+	size_t GetFieldCount();
+	bool IsFallbackShown();
+	size_t GetRenderPendingCount();
+	TextCache::Statistics GetTextCacheStatistics();
 
 	std::thread workThread;
+	//renders glyphs of the default font at startup so first texts don't wait for FreeType
+	std::thread prewarmThread;
 	std::atomic_bool m_running;
 private:
+	static const size_t PALETTE_SIZE = 256;
+	typedef std::array<sf::Color, PALETTE_SIZE> Palette;
+
 	void MoveDataFromSerial();
 	bool CheckBufferForPackets(size_t& start, size_t& finish);	
 
@@ -32,42 +59,95 @@ private:
 	void InsertCommand(std::string command);
 
 	bool CheckPacketCRC(std::string packet);
-	size_t CheckFieldIntersects(sf::FloatRect& rect);
+	//field command with the same bytes as the last one applied to its field, which is left as it is
+	bool IsUnchangedFieldCommand(const std::string& command);
+	//command being executed is the last one of the field in slot
+	void RememberFieldCommand(uint32_t slot);
+	void ForgetFieldCommand(uint32_t slot);
+	void ClearFieldCommands();
+	//slot of field with the same bounds or UINT_MAX - intersects, UINT_MAX - 1 - free, UINT_MAX - 2 - out of bounds
+	//fields left by %23 are taken back (reused is set) or deleted when rect overlaps them
+	size_t CheckFieldIntersects(const sf::FloatRect& rect, bool* reused = nullptr);
+	LDPField* CreateField(const sf::FloatRect& bounds);
+	void DeleteField(FieldHandle handle);
 	sf::Color GetColorByIndex(uint32_t index);
+	//standard 256 colors with entries from start replaced by RRGGBB list separated by ;
+	static Palette BuildPalette(const std::string& colors);
 	uint32_t GetTransparencyByIndex(uint32_t index);
 	uint32_t HexToInt(const std::string& str);
+	//coordinate number index of field command, they start right after command type
+	float ParseCoordinate(const std::string& command, size_t index);
 	std::string GetFormatstringByAttribute(const std::string& attribute);
 
 	int ParseAndExecuteTextField(std::string command);
 	int ParseAndExecuteRectangle(std::string command);
+	//%7v and %7h, 0 and palette index or 1 and RRGGBB
+	int ParseAndExecuteDefaultColor(const std::string& command, sf::Color& color);
 	void DeleteAllFields();
+	//%23, fields stay until the end of packet so the layout sent after it can reuse them
+	void MarkFieldsForDelete();
+	void DeletePendingFields();
 	void DeleteAndFallback();
 	void ExecuteTimeChange(std::string command);
 
 	void CheckAndUpdateFallback();
+	//clock timer, new time and blinking for date/time fields
+	void TickClocks();
+	//shows fields saved before restart, called before serial is opened
+	void RestoreScene();
 
 	void workThreadFunction();
+	void prewarmThreadFunction(std::string fontName, std::vector<uint32_t> sizes);
 		
 	BufferedAsyncSerial m_serial;
 	std::string m_readQueueBuffer;
 	size_t m_readBufferSize;
 
 	std::vector<std::string> m_commandBuffer;
-	std::vector<LDPField*> m_fieldsArray;
+	FieldStore m_fieldStore;
+	FieldIndex m_fieldIndex;
+	bool m_haveFieldsPendingDelete;
+	size_t m_reusedFieldCount;
+	SceneSnapshot m_sceneSnapshot;
+	//last command of every field, found by hash of incoming command and compared whole
+	std::unordered_map<uint64_t, FieldHandle> m_fieldCommandHashes;
+	std::vector<std::string> m_slotCommands;  //empty - unknown
+	std::string m_command;  //being executed, empty if it is not a field command
+	uint64_t m_commandHash;
+	uint64_t m_commandHashesSettingsVersion;
 	std::recursive_mutex m_fieldArrayMutex;	
+	TextCache m_textCache;
+	RasterWorkerPool m_rasterPool;
 
-	sf::Int64 m_textRunningLastUpdateMicro;
-	sf::Int64 m_textRunningCurrentMicro;
 	const float m_textRunningSpeed;
 	const sf::Int64 m_textRunningUpdateEveryMicro;
+	//steps of running text timer not yet made, one is made per frame
+	uint32_t m_textRunningStepsDue;
+	TimerWheel* m_pTimers;
+	TimerWheel::TimerId m_textRunningTimer;
+	TimerWheel::TimerId m_clockTimer;
 
 	//fallback members
 	bool m_displayFallback;
-	sf::Texture m_fallbackTexture;
-	sf::Sprite m_fallbackSprite;
+	FallbackPlaylist m_fallbackPlaylist;
+	//clips from settings, shown with fields and paused during fallback
+	std::vector<std::unique_ptr<MediaField>> m_mediaFields;
 	std::chrono::steady_clock m_internalClock;
 	std::chrono::steady_clock::time_point m_lastUpdated;
+	std::chrono::steady_clock::time_point m_lastStatisticsLog;
 
 	INIFile* m_pSettings;
+	//window size does not change while running, kept out of settings map for command parsing
+	const unsigned m_wallWidth;
+	const unsigned m_wallHeight;
+	//3 in LDP, 4 for walls bigger than 999 pixels, everything after coordinates is shifted
+	const size_t m_coordinateDigits;
+
+	//indexed colors of commands, ready to use
+	const Palette m_palette;
+	//used when command has no color, set by %7v (text and lines) and %7h (text background).
+	//Saved scene gets them written into commands, restart begins with white and transparent
+	sf::Color m_defaultColor;
+	sf::Color m_defaultBGColor;
 };
 
@@ -0,0 +1,404 @@
+#include "FlightRecorder.h"
+#include "Log.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <vector>
+#include <intrin.h>
+#include <Windows.h>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace bip = boost::interprocess;
+
+static const char FLIGHT_MAGIC[8] = { 'V', 'W', 'F', 'L', 'I', 'G', 'H', 'T' };
+static const uint32_t FLIGHT_VERSION = 1;
+static const size_t TEXT_PER_EVENT = 8;
+
+struct FlightRecorder::Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t eventSize;
+	uint64_t capacity;
+	uint32_t processId;
+	uint32_t reserved;
+	//time of Open and the last Calibrate, CPU counter is converted to time between them
+	int64_t startTime;  //system clock, microseconds since 1970
+	uint64_t startTicks;
+	int64_t startSteady;  //steady clock, microseconds
+	uint64_t calibrationTicks;
+	int64_t calibrationSteady;
+	char padding[64];
+	//number of events ever started, on own cache line
+	std::atomic<uint64_t> next;
+	char nextPadding[64 - sizeof(std::atomic<uint64_t>)];
+};
+
+struct FlightRecorder::Event
+{
+	//number of event + 1, written last. 0 while event is being written
+	std::atomic<uint64_t> sequence;
+	uint64_t ticks;
+	uint32_t threadId;
+	uint16_t type;
+	uint16_t arg16;
+	uint64_t arg;
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "events are read from file as plain memory");
+
+static int64_t SteadyMicro()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t SystemMicro()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+//8 characters of text starting at offset, unused bytes are 0
+static uint64_t PackText(const std::string& text, size_t offset, size_t length)
+{
+	uint64_t packed = 0;
+	if (offset < length) memcpy(&packed, text.data() + offset, std::min(TEXT_PER_EVENT, length - offset));
+	return packed;
+}
+
+FlightRecorder & FlightRecorder::Get()
+{
+	static FlightRecorder recorder;
+	return recorder;
+}
+
+FlightRecorder::FlightRecorder() :
+	m_mapping(),
+	m_region(),
+	m_header(nullptr),
+	m_events(nullptr),
+	m_mask(0)
+{
+}
+
+FlightRecorder::~FlightRecorder()
+{
+	Close();
+}
+
+bool FlightRecorder::Open(const std::string & fileName, size_t capacity)
+{
+	Close();
+	uint64_t count = 1;
+	while (count < capacity) count <<= 1;
+	size_t fileSize = sizeof(Header) + count * sizeof(Event);
+
+	//record of previous run may be the only trace of its crash
+	std::string previousName = fileName + ".prev";
+	std::remove(previousName.c_str());
+	std::rename(fileName.c_str(), previousName.c_str());
+
+	{
+		std::ofstream file(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (file.is_open())
+		{
+			file.seekp(fileSize - 1);
+			file.put(0);
+		}
+		if (file.good() == false)
+		{
+			LOG_ERROR("Failed to create flight recorder file {}", fileName);
+			return false;
+		}
+	}
+
+	try
+	{
+		m_mapping.reset(new bip::file_mapping(fileName.c_str(), bip::read_write));
+		m_region.reset(new bip::mapped_region(*m_mapping, bip::read_write, 0, fileSize));
+	}
+	catch (bip::interprocess_exception& e)
+	{
+		LOG_ERROR("Failed to map flight recorder file {0}: {1}", fileName, e.what());
+		m_region.reset();
+		m_mapping.reset();
+		return false;
+	}
+
+	//new file is filled with zeros, so all events are empty
+	Header* header = reinterpret_cast<Header*>(m_region->get_address());
+	memcpy(header->magic, FLIGHT_MAGIC, sizeof(FLIGHT_MAGIC));
+	header->version = FLIGHT_VERSION;
+	header->eventSize = sizeof(Event);
+	header->capacity = count;
+	header->processId = GetCurrentProcessId();
+	header->startTime = SystemMicro();
+	header->startTicks = __rdtsc();
+	header->startSteady = SteadyMicro();
+	header->calibrationTicks = header->startTicks;
+	header->calibrationSteady = header->startSteady;
+	header->next.store(0);
+
+	m_header = header;
+	m_mask = count - 1;
+	m_events = reinterpret_cast<Event*>(m_header + 1);
+	Record(FlightEvent::ProcessStart, 0, header->processId);
+	LOG_INFO("Flight recorder file {0} opened, {1} events, {2} KB", fileName, count, fileSize / 1024);
+	return true;
+}
+
+void FlightRecorder::Close()
+{
+	if (m_events == nullptr) return;
+	Record(FlightEvent::ProcessExit);
+	Calibrate();
+	m_events = nullptr;
+	m_header = nullptr;
+	m_region->flush();
+	m_region.reset();
+	m_mapping.reset();
+}
+
+void FlightRecorder::Record(FlightEvent type, uint16_t arg16, uint64_t arg)
+{
+	if (m_events == nullptr) return;
+	uint64_t number = m_header->next.fetch_add(1, std::memory_order_relaxed);
+	Event& event = m_events[number & m_mask];
+	//decoder skips event cut by crash while it is written
+	event.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	event.ticks = __rdtsc();
+	event.threadId = GetCurrentThreadId();
+	event.type = (uint16_t)type;
+	event.arg16 = arg16;
+	event.arg = arg;
+	event.sequence.store(number + 1, std::memory_order_release);
+}
+
+void FlightRecorder::RecordText(FlightEvent type, uint16_t arg16, const std::string & text, size_t maxLength)
+{
+	if (m_events == nullptr) return;
+	size_t length = std::min(text.size(), maxLength);
+	Record(type, arg16, PackText(text, 0, length));
+	for (size_t offset = TEXT_PER_EVENT; offset < length; offset += TEXT_PER_EVENT)
+	{
+		Record(FlightEvent::Text, (uint16_t)offset, PackText(text, offset, length));
+	}
+}
+
+void FlightRecorder::Calibrate()
+{
+	if (m_header == nullptr) return;
+	m_header->calibrationTicks = __rdtsc();
+	m_header->calibrationSteady = SteadyMicro();
+}
+
+static const char* GetEventName(uint16_t type)
+{
+	switch ((FlightEvent)type)
+	{
+	case FlightEvent::ProcessStart: return "ProcessStart";
+	case FlightEvent::ProcessExit: return "ProcessExit";
+	case FlightEvent::Text: return "Text";
+	case FlightEvent::PacketReceived: return "PacketReceived";
+	case FlightEvent::PacketRejected: return "PacketRejected";
+	case FlightEvent::CommandApplied: return "CommandApplied";
+	case FlightEvent::FieldCreated: return "FieldCreated";
+	case FlightEvent::FieldDestroyed: return "FieldDestroyed";
+	case FlightEvent::FieldsCleared: return "FieldsCleared";
+	case FlightEvent::FallbackShown: return "FallbackShown";
+	case FlightEvent::FrameShown: return "FrameShown";
+	case FlightEvent::ClockBackwards: return "ClockBackwards";
+	case FlightEvent::TimeChanged: return "TimeChanged";
+	case FlightEvent::Exception: return "Exception";
+	default: return "Unknown";
+	}
+}
+
+static std::string FormatTime(int64_t micro)
+{
+	std::time_t seconds = (std::time_t)(micro / 1000000);
+	std::tm local;
+	if (localtime_s(&local, &seconds) != 0) return "time unknown";
+	char buffer[32];
+	strftime(buffer, sizeof(buffer), "%d.%m.%Y %H:%M:%S", &local);
+	std::ostringstream stream;
+	stream << buffer << '.' << std::setw(6) << std::setfill('0') << (micro % 1000000);
+	return stream.str();
+}
+
+//characters of packed text, control characters as \xNN
+static void AppendText(std::string& text, uint64_t packed)
+{
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&packed);
+	for (size_t i = 0; i < TEXT_PER_EVENT && bytes[i] != 0; i++)
+	{
+		if (bytes[i] >= 0x20 && bytes[i] != 0x7F && bytes[i] != '"') text += (char)bytes[i];
+		else
+		{
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\x%02X", bytes[i]);
+			text += escaped;
+		}
+	}
+}
+
+static std::string FormatBounds(uint64_t packed)
+{
+	std::ostringstream stream;
+	stream << "bounds=" << (packed >> 48) << ',' << ((packed >> 32) & 0xFFFF) << ' ' << ((packed >> 16) & 0xFFFF) << 'x' << (packed & 0xFFFF);
+	return stream.str();
+}
+
+bool FlightRecorder::Decode(const std::string & fileName, std::ostream & output)
+{
+	std::ifstream file(fileName, std::ios::in | std::ios::binary);
+	if (file.is_open() == false)
+	{
+		output << "Can't open file " << fileName << std::endl;
+		return false;
+	}
+	std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	const Header* header = reinterpret_cast<const Header*>(data.data());
+	if (data.size() < sizeof(Header) || memcmp(header->magic, FLIGHT_MAGIC, sizeof(FLIGHT_MAGIC)) != 0 ||
+		header->version != FLIGHT_VERSION || header->eventSize != sizeof(Event) ||
+		data.size() < sizeof(Header) + header->capacity * sizeof(Event))
+	{
+		output << "File " << fileName << " is not a flight record of this version" << std::endl;
+		return false;
+	}
+
+	const uint64_t capacity = header->capacity;
+	const Event* events = reinterpret_cast<const Event*>(header + 1);
+	std::vector<const Event*> ordered;
+	for (uint64_t i = 0; i < capacity; i++)
+	{
+		uint64_t sequence = events[i].sequence.load(std::memory_order_relaxed);
+		if (sequence != 0 && ((sequence - 1) & (capacity - 1)) == i) ordered.push_back(&events[i]);
+	}
+	std::sort(ordered.begin(), ordered.end(), [](const Event* a, const Event* b)
+	{
+		return a->sequence.load(std::memory_order_relaxed) < b->sequence.load(std::memory_order_relaxed);
+	});
+
+	//counter ticks per microsecond measured over the whole run, without calibration only counters are shown
+	double ticksPerMicro = 0;
+	if (header->calibrationSteady - header->startSteady > 100000)
+	{
+		ticksPerMicro = double(header->calibrationTicks - header->startTicks) / double(header->calibrationSteady - header->startSteady);
+	}
+	const uint64_t written = header->next.load(std::memory_order_relaxed);
+	output << "Flight record " << fileName << " of process " << header->processId << " started " << FormatTime(header->startTime) << std::endl;
+	output << "Events written=" << written << ", kept=" << ordered.size() << ", capacity=" << capacity << std::endl;
+	if (ticksPerMicro == 0) output << "Not calibrated, times are CPU counter values" << std::endl;
+
+	struct Line
+	{
+		std::string prefix;
+		std::string text;
+		bool hasText;
+	};
+	std::vector<Line> lines;
+	std::vector<std::pair<uint32_t, size_t>> lastLineOfThread;
+	uint64_t previousSequence = 0;
+	for (const Event* event : ordered)
+	{
+		uint64_t sequence = event->sequence.load(std::memory_order_relaxed);
+		if (previousSequence != 0 && sequence != previousSequence + 1)
+		{
+			Line gap = { "... " + std::to_string(sequence - previousSequence - 1) + " events were not finished", "", false };
+			lines.push_back(gap);
+		}
+		previousSequence = sequence;
+
+		auto last = std::find_if(lastLineOfThread.begin(), lastLineOfThread.end(),
+			[event](const std::pair<uint32_t, size_t>& item) { return item.first == event->threadId; });
+		if ((FlightEvent)event->type == FlightEvent::Text && last != lastLineOfThread.end() && lines[last->second].hasText)
+		{
+			AppendText(lines[last->second].text, event->arg);
+			continue;
+		}
+
+		std::ostringstream stream;
+		if (ticksPerMicro != 0) stream << FormatTime(header->startTime + int64_t(double(int64_t(event->ticks - header->startTicks)) / ticksPerMicro));
+		else stream << event->ticks;
+		stream << "  #" << sequence << "  thread=" << event->threadId << "  " << GetEventName(event->type) << "  ";
+
+		Line line = { "", "", false };
+		switch ((FlightEvent)event->type)
+		{
+		case FlightEvent::ProcessStart:
+			stream << "process=" << event->arg;
+			break;
+		case FlightEvent::PacketReceived:
+			stream << "length=" << event->arg16 << ", buffered=" << event->arg;
+			break;
+		case FlightEvent::PacketRejected:
+			stream << "length=" << event->arg16 << ", packet CRC=" << ((event->arg >> 8) & 0xFF) << ", calculated CRC=" << (event->arg & 0xFF);
+			break;
+		case FlightEvent::CommandApplied:
+			stream << "result=" << event->arg16 << ", command=";
+			line.hasText = true;
+			break;
+		case FlightEvent::FieldCreated:
+		case FlightEvent::FieldDestroyed:
+			stream << "slot=" << event->arg16 << ", " << FormatBounds(event->arg);
+			break;
+		case FlightEvent::FieldsCleared:
+			stream << "fields=" << event->arg;
+			break;
+		case FlightEvent::FallbackShown:
+			stream << ((event->arg16 != 0) ? "shown" : "hidden");
+			break;
+		case FlightEvent::FrameShown:
+			stream << "interval=" << event->arg << " us";
+			break;
+		case FlightEvent::ClockBackwards:
+			stream << "ticks=" << event->arg;
+			break;
+		case FlightEvent::TimeChanged:
+			stream << "time=" << std::setfill('0') << std::setw(6) << event->arg;
+			break;
+		case FlightEvent::Exception:
+			stream << ((event->arg16 == 0) ? "in work thread" : "in main") << ", message=";
+			line.hasText = true;
+			break;
+		case FlightEvent::Text:
+			stream << "text=";
+			line.hasText = true;
+			break;
+		case FlightEvent::ProcessExit:
+			break;
+		default:
+			stream << "type=" << event->type << ", arg16=" << event->arg16 << ", arg=" << event->arg;
+			break;
+		}
+		line.prefix = stream.str();
+		if (line.hasText) AppendText(line.text, event->arg);
+		lines.push_back(line);
+
+		if (last != lastLineOfThread.end()) last->second = lines.size() - 1;
+		else lastLineOfThread.push_back(std::make_pair(event->threadId, lines.size() - 1));
+	}
+	if (written > previousSequence)
+	{
+		Line unfinished = { "... " + std::to_string(written - previousSequence) + " events were being written when program stopped", "", false };
+		lines.push_back(unfinished);
+	}
+
+	for (const Line& line : lines)
+	{
+		output << line.prefix;
+		if (line.hasText) output << '"' << line.text << '"';
+		output << '\n';
+	}
+	output.flush();
+	return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace boost { namespace interprocess { class file_mapping; class mapped_region; } }
+
+enum class FlightEvent : uint16_t
+{
+	None = 0,
+	ProcessStart,		//arg = process id
+	ProcessExit,
+	Text,				//continuation of text of previous event of the same thread, 8 characters
+	PacketReceived,		//arg16 = packet length, arg = bytes left in read buffer
+	PacketRejected,		//arg16 = packet length, arg = CRC in packet << 8 | calculated CRC
+	CommandApplied,		//arg16 = result, text = beginning of command
+	FieldCreated,		//arg16 = slot, arg = left, top, width, height by 16 bits
+	FieldDestroyed,		//arg16 = slot, arg = left, top, width, height by 16 bits
+	FieldsCleared,		//arg = number of fields
+	FallbackShown,		//arg16 = 1 shown, 0 hidden
+	FrameShown,			//arg = microseconds since previous shown frame
+	ClockBackwards,		//performance counter went back, arg = how many ticks
+	TimeChanged,		//arg = new local time as hhmmss
+	Exception,			//arg16 = 0 work thread, 1 main, text = message
+	EventCount
+};
+
+//compact binary events in memory mapped ring file, kept by the system when the program crashes or hangs.
+//Recording is a few nanoseconds, so it stays on in production unlike debug log. Decode turns file into text
+class FlightRecorder
+{
+public:
+	static FlightRecorder& Get();
+	~FlightRecorder();
+
+	//file of previous run is kept with .prev added. capacity is rounded up to power of 2
+	bool Open(const std::string& fileName, size_t capacity);
+	void Close();
+
+	//from any thread, does nothing when not open
+	void Record(FlightEvent type, uint16_t arg16 = 0, uint64_t arg = 0);
+	//event with first 8 characters of text in arg and the rest in Text events, up to maxLength characters
+	void RecordText(FlightEvent type, uint16_t arg16, const std::string& text, size_t maxLength);
+	//stores pair of CPU and system time so decoder converts counters to time, call about once a second
+	void Calibrate();
+
+	//readable text of events in order, false if file is not a flight record
+	static bool Decode(const std::string& fileName, std::ostream& output);
+
+private:
+	struct Header;
+	struct Event;
+
+	FlightRecorder();
+
+	std::unique_ptr<boost::interprocess::file_mapping> m_mapping;
+	std::unique_ptr<boost::interprocess::mapped_region> m_region;
+	Header* m_header;
+	Event* m_events;
+	uint64_t m_mask;
+};
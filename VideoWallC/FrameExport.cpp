@@ -0,0 +1,186 @@
+#include "FrameExport.h"
+#include "Log.h"
+#include <chrono>
+#include <cstring>
+#include <boost/interprocess/windows_shared_memory.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace bip = boost::interprocess;
+
+static const char EXPORT_MAGIC[8] = { 'V', 'W', 'F', 'R', 'A', 'M', 'E', 'S' };
+static const uint32_t EXPORT_VERSION = 1;
+static const uint64_t EXPORT_ALIGNMENT = 4096;
+
+static uint64_t AlignUp(uint64_t value)
+{
+	return (value + EXPORT_ALIGNMENT - 1) / EXPORT_ALIGNMENT * EXPORT_ALIGNMENT;
+}
+
+FrameExport::FrameExport(const std::string & name, unsigned int width, unsigned int height, unsigned int slotCount, unsigned int everyFrame) :
+	m_memory(),
+	m_region(),
+	m_localMemory(),
+	m_frameHandler(),
+	m_header(nullptr),
+	m_slots(nullptr),
+	m_pixels(nullptr),
+	m_width(width),
+	m_height(height),
+	m_everyFrame((everyFrame == 0) ? 1 : everyFrame),
+	m_frameCount(0),
+	m_busy(false),
+	m_published(0),
+	m_skipped(0),
+	m_jobPixels(nullptr),
+	m_jobBottomUp(false),
+	m_jobPending(false),
+	m_stopping(false)
+{
+	//two slots let reader finish frame while the next one is written, handler alone needs one
+	if (name.empty()) slotCount = 1;
+	else if (slotCount < 2) slotCount = 2;
+	const uint64_t slotOffset = AlignUp(sizeof(Header) + slotCount * sizeof(SlotHeader));
+	const uint64_t slotSize = AlignUp(uint64_t(width) * height * 4);
+	const uint64_t memorySize = slotOffset + slotCount * slotSize;
+
+	char* base = nullptr;
+	if (name.empty())
+	{
+		m_localMemory.resize(size_t(memorySize / sizeof(uint64_t)));
+		base = reinterpret_cast<char*>(m_localMemory.data());
+	}
+	else
+	{
+		m_memory.reset(new bip::windows_shared_memory(bip::open_or_create, name.c_str(), bip::read_write, (size_t)memorySize));
+		m_region.reset(new bip::mapped_region(*m_memory, bip::read_write));
+		if (m_region->get_size() < memorySize)
+		{
+			//memory of previous run with other size is still open by a reader
+			throw bip::interprocess_exception("shared memory exists with smaller size");
+		}
+		base = static_cast<char*>(m_region->get_address());
+	}
+	m_header = reinterpret_cast<Header*>(base);
+	m_slots = reinterpret_cast<SlotHeader*>(base + sizeof(Header));
+	m_pixels = reinterpret_cast<sf::Uint8*>(base + slotOffset);
+
+	//readers see no frame until layout is written
+	m_header->latest.store(0);
+	memcpy(m_header->magic, EXPORT_MAGIC, sizeof(EXPORT_MAGIC));
+	m_header->version = EXPORT_VERSION;
+	m_header->width = width;
+	m_header->height = height;
+	m_header->slotCount = slotCount;
+	m_header->slotOffset = slotOffset;
+	m_header->slotSize = slotSize;
+	for (unsigned int i = 0; i < slotCount; i++)
+	{
+		m_slots[i].sequence.store(0);
+		m_slots[i].time = 0;
+	}
+
+	std::thread t(&FrameExport::ExportThreadFunction, this);
+	m_thread.swap(t);
+	if (name.empty()) LOG_INFO("Frame export in process memory created, {0}x{1}, every {2} frame", width, height, m_everyFrame);
+	else LOG_INFO("Frame export to shared memory {0} created, {1}x{2}, slots={3}, every {4} frame, {5} KB",
+		name, width, height, slotCount, m_everyFrame, memorySize / 1024);
+}
+
+FrameExport::~FrameExport()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_stopping = true;
+	}
+	m_jobCondition.notify_one();
+	if (m_thread.joinable()) m_thread.join();
+	LOG_INFO("Frame export finished, published={0}, skipped={1}", m_published.load(), m_skipped.load());
+}
+
+void FrameExport::SetFrameHandler(FrameHandler handler)
+{
+	m_frameHandler = handler;
+}
+
+bool FrameExport::IsFrameDue()
+{
+	m_frameCount++;
+	return m_frameCount % m_everyFrame == 0;
+}
+
+void FrameExport::SkipFrame()
+{
+	m_skipped++;
+}
+
+void FrameExport::Publish(const sf::Uint8 * pixels, bool bottomUp)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_jobPixels = pixels;
+		m_jobBottomUp = bottomUp;
+		m_jobPending = true;
+		m_busy.store(true);
+	}
+	m_jobCondition.notify_one();
+}
+
+bool FrameExport::IsBusy() const
+{
+	return m_busy.load();
+}
+
+void FrameExport::WaitIdle()
+{
+	while (m_busy.load()) std::this_thread::yield();
+}
+
+uint64_t FrameExport::GetPublishedCount() const
+{
+	return m_published.load();
+}
+
+uint64_t FrameExport::GetSkippedCount() const
+{
+	return m_skipped.load();
+}
+
+void FrameExport::ExportThreadFunction()
+{
+	LOG_DEBUG("Frame export thread enter");
+	const size_t rowSize = size_t(m_width) * 4;
+	uint64_t sequence = 0;
+	std::unique_lock<std::mutex> lock(m_jobMutex);
+	while (true)
+	{
+		m_jobCondition.wait(lock, [this] { return m_stopping || m_jobPending; });
+		if (m_stopping) break;
+		const sf::Uint8* pixels = m_jobPixels;
+		bool bottomUp = m_jobBottomUp;
+		m_jobPending = false;
+		lock.unlock();
+
+		sequence++;
+		size_t slot = size_t((sequence - 1) % m_header->slotCount);
+		SlotHeader& slotHeader = m_slots[slot];
+		sf::Uint8* target = m_pixels + slot * m_header->slotSize;
+		slotHeader.sequence.store(0, std::memory_order_release);
+		std::atomic_thread_fence(std::memory_order_release);
+		if (bottomUp)
+		{
+			//OpenGL reads rows from the bottom
+			for (unsigned int y = 0; y < m_height; y++) memcpy(target + y * rowSize, pixels + (m_height - 1 - y) * rowSize, rowSize);
+		}
+		else memcpy(target, pixels, rowSize * m_height);
+		slotHeader.time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		slotHeader.sequence.store(sequence, std::memory_order_release);
+		m_header->latest.store(sequence, std::memory_order_release);
+		m_published++;
+		if (m_frameHandler) m_frameHandler(target, sequence);
+
+		lock.lock();
+		m_busy.store(false);
+	}
+	lock.unlock();
+	LOG_DEBUG("Frame export thread exit");
+}
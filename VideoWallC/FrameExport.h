@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+namespace boost { namespace interprocess { class windows_shared_memory; class mapped_region; } }
+
+//publishes shown frames into named shared memory ring for local recorders and streamers.
+//Layout: Header, then slotCount SlotHeaders, then slots of width * height * 4 bytes RGBA, top row first,
+//every slot starting on 4 KB boundary. Reader takes latest, reads SlotHeader of slot (latest - 1) % slotCount,
+//uses pixels in place while its sequence equals latest and checks sequence again after, changed means overwritten.
+//Without name frames are only copied to one slot in process memory for frame handler
+class FrameExport
+{
+public:
+	//export thread, after frame is copied. Pixels are RGBA, top row first, valid until it returns
+	typedef std::function<void(const sf::Uint8* pixels, uint64_t sequence)> FrameHandler;
+
+	struct Header
+	{
+		char magic[8];  //VWFRAMES
+		uint32_t version;
+		uint32_t width;
+		uint32_t height;
+		uint32_t slotCount;
+		uint64_t slotOffset;  //of first slot from start of memory
+		uint64_t slotSize;
+		std::atomic<uint64_t> latest;  //sequence of the last complete frame, 0 before the first
+	};
+
+	struct SlotHeader
+	{
+		std::atomic<uint64_t> sequence;  //0 while slot is written
+		int64_t time;  //system clock when frame was shown, microseconds since 1970
+	};
+
+	//throws boost::interprocess::interprocess_exception if shared memory can't be created
+	FrameExport(const std::string& name, unsigned int width, unsigned int height, unsigned int slotCount, unsigned int everyFrame);
+	~FrameExport();
+
+	//before export is given to backend
+	void SetFrameHandler(FrameHandler handler);
+
+	//render thread, once for every shown frame. true for every Nth frame
+	bool IsFrameDue();
+	//due frame is not exported because pixels of previous ones are still in use
+	void SkipFrame();
+	//pixels are copied by export thread and must stay unchanged until IsBusy returns false
+	void Publish(const sf::Uint8* pixels, bool bottomUp);
+	bool IsBusy() const;
+	//blocks until pixels given to Publish are not used, before they are freed
+	void WaitIdle();
+
+	uint64_t GetPublishedCount() const;
+	uint64_t GetSkippedCount() const;
+
+private:
+	void ExportThreadFunction();
+
+	std::unique_ptr<boost::interprocess::windows_shared_memory> m_memory;
+	std::unique_ptr<boost::interprocess::mapped_region> m_region;
+	std::vector<uint64_t> m_localMemory;
+	FrameHandler m_frameHandler;
+	Header* m_header;
+	SlotHeader* m_slots;
+	sf::Uint8* m_pixels;
+	const unsigned int m_width;
+	const unsigned int m_height;
+	const unsigned int m_everyFrame;
+	uint64_t m_frameCount;
+
+	std::atomic<bool> m_busy;
+	std::atomic<uint64_t> m_published;
+	std::atomic<uint64_t> m_skipped;
+	const sf::Uint8* m_jobPixels;
+	bool m_jobBottomUp;
+	bool m_jobPending;
+	bool m_stopping;
+	std::mutex m_jobMutex;
+	std::condition_variable m_jobCondition;
+	std::thread m_thread;
+};
@@ -0,0 +1,96 @@
+#include "FrameProfiler.h"
+#include "Log.h"
+#include "FlightRecorder.h"
+#include "Metrics.h"
+
+static uint64_t ToMicroseconds(std::chrono::steady_clock::duration duration)
+{
+	auto micro = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+	return (micro < 0) ? 0 : (uint64_t)micro;
+}
+
+FrameProfiler::FrameProfiler() :
+	m_passTimes(),
+	m_passMarked(),
+	m_lastMark(std::chrono::steady_clock::now()),
+	m_lastFrame(m_lastMark),
+	m_haveLastFrame(false),
+	m_periodStart(m_lastMark)
+{
+}
+
+void FrameProfiler::Restart()
+{
+	m_lastMark = std::chrono::steady_clock::now();
+}
+
+void FrameProfiler::Mark(Section section)
+{
+	auto now = std::chrono::steady_clock::now();
+	m_passTimes[section] = ToMicroseconds(now - m_lastMark);
+	m_passMarked[section] = true;
+	m_lastMark = now;
+}
+
+void FrameProfiler::FrameShown()
+{
+	for (int i = 0; i < FrameInterval; i++)
+	{
+		if (m_passMarked[i]) m_histograms[i].Record(m_passTimes[i]);
+		m_passMarked[i] = false;
+	}
+
+	if (m_haveLastFrame)
+	{
+		uint64_t interval = ToMicroseconds(m_lastMark - m_lastFrame);
+		m_histograms[FrameInterval].Record(interval);
+		FlightRecorder::Get().Record(FlightEvent::FrameShown, 0, interval);
+		Metrics::RecordLatency(Metrics::FrameInterval, interval);
+	}
+	m_lastFrame = m_lastMark;
+	m_haveLastFrame = true;
+}
+
+void FrameProfiler::LogSummary(const std::string & reason)
+{
+	double periodSeconds = ToMicroseconds(std::chrono::steady_clock::now() - m_periodStart) / 1000000.0;
+	LOG_INFO("Frame statistics ({0}) for last {1:.1f} seconds, values in microseconds:", reason, periodSeconds);
+	for (int i = 0; i < SectionCount; i++)
+	{
+		const Histogram& histogram = m_histograms[i];
+		LOG_INFO("  {0:<13} count={1}, mean={2:.1f}, min={3}, p50={4}, p90={5}, p99={6}, p99.9={7}, max={8}",
+			GetSectionName((Section)i), histogram.GetCount(), histogram.GetMean(), histogram.GetMin(),
+			histogram.GetPercentile(50), histogram.GetPercentile(90), histogram.GetPercentile(99),
+			histogram.GetPercentile(99.9), histogram.GetMax());
+	}
+}
+
+void FrameProfiler::Reset()
+{
+	for (Histogram& histogram : m_histograms) histogram.Reset();
+	m_periodStart = std::chrono::steady_clock::now();
+}
+
+const Histogram & FrameProfiler::GetHistogram(Section section) const
+{
+	return m_histograms[section];
+}
+
+const char * FrameProfiler::GetSectionName(Section section)
+{
+	switch (section)
+	{
+	case EventPoll:
+		return "EventPoll";
+	case Update:
+		return "UpdateFields";
+	case Draw:
+		return "DrawFields";
+	case Display:
+		return "Display";
+	case FrameInterval:
+		return "FrameInterval";
+	default:
+		return "Unknown";
+	}
+}
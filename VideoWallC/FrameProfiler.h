@@ -0,0 +1,44 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include "Statistics.h"
+
+//time of main cycle parts in microseconds, collected into histograms
+class FrameProfiler
+{
+public:
+	enum Section
+	{
+		EventPoll = 0,
+		Update,
+		Draw,
+		Display,
+		FrameInterval,	//between ends of two displayed frames, what viewer sees
+		SectionCount
+	};
+
+	FrameProfiler();
+
+	//starts measuring next section, time since previous mark is not counted
+	void Restart();
+	//keeps time since previous mark for section, cycle passes that show nothing are overwritten by next one
+	void Mark(Section section);
+	//call after Display mark, records marked sections of the pass and interval between shown frames
+	void FrameShown();
+
+	void LogSummary(const std::string& reason);
+	void Reset();
+
+	const Histogram& GetHistogram(Section section) const;
+
+private:
+	static const char* GetSectionName(Section section);
+
+	Histogram m_histograms[SectionCount];
+	uint64_t m_passTimes[SectionCount];
+	bool m_passMarked[SectionCount];
+	std::chrono::steady_clock::time_point m_lastMark;
+	std::chrono::steady_clock::time_point m_lastFrame;
+	bool m_haveLastFrame;
+	std::chrono::steady_clock::time_point m_periodStart;
+};
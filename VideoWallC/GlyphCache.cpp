@@ -0,0 +1,99 @@
+#include "GlyphCache.h"
+#include <boost/functional/hash.hpp>
+
+bool GlyphKey::operator==(const GlyphKey & other) const
+{
+	return codePoint == other.codePoint &&
+		size == other.size &&
+		bold == other.bold &&
+		fontName == other.fontName;
+}
+
+size_t GlyphKeyHash::operator()(const GlyphKey & key) const
+{
+	size_t seed = std::hash<std::string>()(key.fontName);
+	boost::hash_combine(seed, key.size);
+	boost::hash_combine(seed, key.codePoint);
+	boost::hash_combine(seed, key.bold);
+	return seed;
+}
+
+GlyphCache & GlyphCache::Get()
+{
+	static GlyphCache cache;
+	return cache;
+}
+
+//until SetMemoryLimit with setting
+static const size_t DEFAULT_MEMORY_LIMIT = 16 * 1024 * 1024;
+
+GlyphCache::GlyphCache() :
+	m_lruList(),
+	m_glyphs(),
+	m_memoryLimit(DEFAULT_MEMORY_LIMIT),
+	m_memoryUsed(0),
+	m_evictions(0)
+{
+}
+
+std::shared_ptr<const GlyphBitmap> GlyphCache::Find(const GlyphKey & key)
+{
+	std::lock_guard<std::mutex> lock(m_glyphsMutex);
+	auto found = m_glyphs.find(key);
+	if (found == m_glyphs.end()) return nullptr;
+	m_lruList.splice(m_lruList.begin(), m_lruList, found->second);
+	return found->second->second;
+}
+
+void GlyphCache::Insert(const GlyphKey & key, std::shared_ptr<const GlyphBitmap> glyph)
+{
+	std::lock_guard<std::mutex> lock(m_glyphsMutex);
+	//two threads may render the same glyph, first one stays
+	if (m_glyphs.find(key) != m_glyphs.end()) return;
+	m_lruList.emplace_front(key, glyph);
+	m_glyphs[key] = m_lruList.begin();
+	m_memoryUsed += GetMemorySize(*glyph);
+	EvictToLimit();
+}
+
+void GlyphCache::SetMemoryLimit(size_t memoryLimit)
+{
+	std::lock_guard<std::mutex> lock(m_glyphsMutex);
+	m_memoryLimit = memoryLimit;
+	EvictToLimit();
+}
+
+size_t GlyphCache::GetCount()
+{
+	std::lock_guard<std::mutex> lock(m_glyphsMutex);
+	return m_glyphs.size();
+}
+
+size_t GlyphCache::GetMemoryUsed()
+{
+	std::lock_guard<std::mutex> lock(m_glyphsMutex);
+	return m_memoryUsed;
+}
+
+uint64_t GlyphCache::GetEvictions()
+{
+	std::lock_guard<std::mutex> lock(m_glyphsMutex);
+	return m_evictions;
+}
+
+void GlyphCache::EvictToLimit()
+{
+	while (m_memoryUsed > m_memoryLimit && m_lruList.empty() == false)
+	{
+		CacheEntry& last = m_lruList.back();
+		m_memoryUsed -= GetMemorySize(*last.second);
+		m_glyphs.erase(last.first);
+		m_lruList.pop_back();
+		m_evictions++;
+	}
+}
+
+size_t GlyphCache::GetMemorySize(const GlyphBitmap & glyph)
+{
+	return sizeof(GlyphBitmap) + glyph.coverage.size();
+}
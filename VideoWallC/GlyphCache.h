@@ -0,0 +1,65 @@
+#pragma once
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+//coverage of one rendered glyph, offsets are from pen position on baseline
+struct GlyphBitmap
+{
+	int left;
+	int top;
+	int width;
+	int height;
+	float advance;
+	std::vector<sf::Uint8> coverage;
+};
+
+struct GlyphKey
+{
+	std::string fontName;
+	uint32_t size;
+	sf::Uint32 codePoint;
+	bool bold;
+
+	bool operator==(const GlyphKey& other) const;
+};
+
+struct GlyphKeyHash
+{
+	size_t operator()(const GlyphKey& key) const;
+};
+
+//glyphs shared by text rasterizers of all threads, filled at startup by pre-warm and on demand.
+//Least recently used glyphs are dropped over memory limit, rasterizers keep ones they use
+class GlyphCache
+{
+public:
+	static GlyphCache& Get();
+
+	std::shared_ptr<const GlyphBitmap> Find(const GlyphKey& key);
+	void Insert(const GlyphKey& key, std::shared_ptr<const GlyphBitmap> glyph);
+	void SetMemoryLimit(size_t memoryLimit);
+
+	size_t GetCount();
+	size_t GetMemoryUsed();
+	uint64_t GetEvictions();
+
+private:
+	typedef std::pair<GlyphKey, std::shared_ptr<const GlyphBitmap>> CacheEntry;
+	typedef std::list<CacheEntry> CacheList;
+
+	GlyphCache();
+	void EvictToLimit();
+	static size_t GetMemorySize(const GlyphBitmap& glyph);
+
+	CacheList m_lruList;
+	std::unordered_map<GlyphKey, CacheList::iterator, GlyphKeyHash> m_glyphs;
+	std::mutex m_glyphsMutex;
+	size_t m_memoryLimit;
+	size_t m_memoryUsed;
+	uint64_t m_evictions;
+};
@@ -2,14 +2,42 @@
 #include "Log.h"
 #include <iostream>
 #include <fstream>
+#include <Windows.h>
+
+//editors save file in several writes, it is read when changes stop for this long
+static const DWORD RELOAD_DELAY_MS = 300;
+
+static bool GetLastWriteTime(const std::string& fileName, FILETIME& time)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (GetFileAttributesExA(fileName.c_str(), GetFileExInfoStandard, &data) == FALSE) return false;
+	time = data.ftLastWriteTime;
+	return true;
+}
 
 INIFile::INIFile(std::string fileName, int argc, char* argv[]):
-	m_loadSucsessful(false)
+	m_loadSucsessful(false),
+	m_fileName(fileName),
+	m_arguments(),
+	m_snapshots(),
+	m_snapshot(nullptr),
+	m_stopEvent(nullptr),
+	m_watchThread()
 {
 	Init(argc, argv);
 	LoadConfigFile(fileName);
 }
 
+INIFile::~INIFile()
+{
+	if (m_watchThread.joinable())
+	{
+		SetEvent(m_stopEvent);
+		m_watchThread.join();
+	}
+	if (m_stopEvent != nullptr) CloseHandle(m_stopEvent);
+}
+
 void INIFile::LoadConfigFile(std::string fileName)
 {
 	const bool ALLOW_UNREGISTERED = true;
@@ -26,6 +54,7 @@ void INIFile::LoadConfigFile(std::string fileName)
 		m_loadSucsessful = true;		
 	}
 	else LOG_CRITICAL("Config file does not exists, using defaults");
+	Publish(m_vm);
 }
 
 void INIFile::LogConfigOptions(std::stringstream & stream)
@@ -62,12 +91,118 @@ bool INIFile::GetBool(std::string name)
 		return 0;
 }
 
+void INIFile::SetUInt(std::string name, unsigned int value)
+{
+	if (m_vm.count(name))
+		m_vm.at(name).value() = value;
+	else
+		LOG_ERROR("Can't set unknown setting={}", name);
+	Publish(m_vm);
+}
+
+void INIFile::SetString(std::string name, std::string value)
+{
+	if (m_vm.count(name))
+		m_vm.at(name).value() = value;
+	else
+		LOG_ERROR("Can't set unknown setting={}", name);
+	Publish(m_vm);
+}
+
+void INIFile::StartWatching()
+{
+	if (m_watchThread.joinable()) return;
+	m_stopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	std::thread t(&INIFile::WatchThreadFunction, this);
+	m_watchThread.swap(t);
+}
+
+bool INIFile::Reload()
+{
+	po::variables_map vm;
+	try
+	{
+		Parse(vm, m_fileName);
+	}
+	catch (std::exception& e)
+	{
+		LOG_ERROR("Settings file is not reloaded, previous settings stay: {}", e.what());
+		return false;
+	}
+	Publish(vm);
+
+	const SettingsSnapshot& snapshot = GetSnapshot();
+	LOG_INFO("Settings reloaded, version={0} LogLevel={1} DisplayFPS={2} TabloNumber={3} DefaultFont={4} FallbackTimeout={5}, other settings apply after restart",
+		snapshot.version, snapshot.logLevel, snapshot.displayFPS, snapshot.tabloNumber, snapshot.defaultFont, snapshot.fallbackTimeout);
+	return true;
+}
+
+void INIFile::Parse(po::variables_map & vm, const std::string & fileName)
+{
+	const bool ALLOW_UNREGISTERED = true;
+
+	//command line is stored first and wins over file, like at start
+	po::store(po::command_line_parser(m_arguments).options(m_configOptions).run(), vm);
+	std::ifstream file(fileName.c_str());
+	if (!file) throw std::runtime_error("can't open " + fileName);
+	po::store(po::parse_config_file(file, m_configOptions, ALLOW_UNREGISTERED), vm);
+	po::notify(vm);
+}
+
+void INIFile::Publish(const po::variables_map & vm)
+{
+	std::unique_ptr<SettingsSnapshot> snapshot(new SettingsSnapshot());
+	snapshot->logLevel = vm[S_LOGLEVEL].as<unsigned int>();
+	snapshot->displayFPS = vm[S_DISPLAYFPS].as<bool>();
+	snapshot->tabloNumber = vm[S_TABLONUMBER].as<unsigned int>();
+	snapshot->defaultFont = vm[S_DEFAULTFONT].as<std::string>();
+	snapshot->fallbackTimeout = vm[S_FALLBACKTIMEOUT].as<unsigned int>();
+
+	std::lock_guard<std::mutex> lock(m_publishMutex);
+	snapshot->version = m_snapshots.size() + 1;
+	m_snapshot.store(snapshot.get(), std::memory_order_release);
+	m_snapshots.push_back(std::move(snapshot));
+}
+
+void INIFile::WatchThreadFunction()
+{
+	LOG_DEBUG("Settings watch thread enter");
+	size_t slash = m_fileName.find_last_of("\\/");
+	std::string directory = (slash == std::string::npos) ? "." : m_fileName.substr(0, slash);
+	HANDLE change = FindFirstChangeNotificationA(directory.c_str(), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+	if (change == INVALID_HANDLE_VALUE)
+	{
+		LOG_ERROR("Settings file is not watched, change notification of {0} failed, error={1}", directory, GetLastError());
+		return;
+	}
+	LOG_INFO("Watching settings file {} for changes", m_fileName);
+
+	FILETIME lastWrite = {};
+	GetLastWriteTime(m_fileName, lastWrite);
+	HANDLE handles[2] = { m_stopEvent, change };
+	while (WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1)
+	{
+		if (WaitForSingleObject(m_stopEvent, RELOAD_DELAY_MS) == WAIT_OBJECT_0) break;
+		//changes before this are read below, later ones signal again
+		if (FindNextChangeNotification(change) == FALSE) break;
+
+		//other files of directory change too
+		FILETIME write = {};
+		if (GetLastWriteTime(m_fileName, write) == false || CompareFileTime(&write, &lastWrite) == 0) continue;
+		lastWrite = write;
+		Reload();
+	}
+	FindCloseChangeNotification(change);
+	LOG_DEBUG("Settings watch thread exit");
+}
 
 void INIFile::Init(int argc, char* argv[])
 {
+	if (argc > 1) m_arguments.assign(argv + 1, argv + argc);
 	m_configOptions.add_options()
 		(S_LOGLEVEL, po::value<unsigned int>()->default_value(0), "Logging level (0-6). 6 is off")
 		(S_DISPLAYCONSOLE, po::value<bool>()->default_value(false), "Enabling displaying the program console")
+		(S_WATCHSETTINGS, po::value<bool>()->default_value(true), "Reload settings file when it is saved. Log level, FPS display, display number, default font and fallback timeout change at once, others after restart")
 		(S_TARGETFPS, po::value<unsigned int>()->default_value(200), "Target FPS for program")
 		(S_CUSTOMENABLED, po::value<bool>()->default_value(false), "Enabling custom window to create in a custom location")
 		(S_CUSTOMLEFT, po::value<unsigned int>()->default_value(100), "Custom window settings. Left coordinate in pixels")
@@ -76,11 +211,54 @@ void INIFile::Init(int argc, char* argv[])
 		(S_CUSTOMHEIGHT, po::value<unsigned int>()->default_value(300), "Custom window settings. Width in pixels")
 		(S_TABLONUMBER, po::value<unsigned int>()->default_value(5), "Display number in LDP protocol")
 		(S_COMPORT, po::value<std::string>()->default_value("COM1"), "Serial port number")
-		(S_FALLBACK, po::value<std::string>()->default_value("fallback.jpg"), "Fallback image to use when not active")
+		(S_FALLBACK, po::value<std::string>()->default_value("fallback.jpg"), "Fallback images to use when not active, several separated by ; are shown in turn")
 		(S_DISPLAYFPS, po::value<bool>()->default_value(true), "Enabling displaying of FPS")
 		(S_FALLBACKTIMEOUT, po::value<unsigned int>()->default_value(180), "Fallback timeout after witch change picture to fallback image")
+		(S_FALLBACKINTERVAL, po::value<unsigned int>()->default_value(30), "Seconds each fallback image is shown when there are several")
 
 		(S_DEFAULTFONT, po::value<std::string>()->default_value("arial.ttf"), "Default font to use in display form")
+		(S_PREWARMSIZES, po::value<std::string>()->default_value("1-16"), "Text sizes to render Latin and Cyrillic glyphs of default font for at startup, in background. List like 1-4,8,12-16. Empty is off")
+
+		(S_TEXTCACHEMEMORY, po::value<unsigned int>()->default_value(64), "Memory limit in megabytes for cache of rendered text. 0 disables cache")
+		(S_GLYPHCACHEMEMORY, po::value<unsigned int>()->default_value(16), "Memory limit in megabytes for glyphs shared by text renderers, least recently used are dropped over it")
+		(S_RASTERTHREADS, po::value<unsigned int>()->default_value(0), "Number of threads rendering text in background. 0 is number of cores minus one")
+		(S_RENDERBACKEND, po::value<std::string>()->default_value("window"), "Render backend: window (OpenGL) or software (CPU framebuffer, no display needed)")
+		(S_SNAPSHOTFILE, po::value<std::string>()->default_value("snapshot.png"), "Software backend. File to save rendered frame to")
+		(S_SNAPSHOTINTERVAL, po::value<unsigned int>()->default_value(0), "Software backend. Interval in seconds between frame saves. 0 is off")
+		(S_COMPOSITETHREADS, po::value<unsigned int>()->default_value(0), "Software backend. Threads compositing bands of frame in parallel. 0 is number of cores")
+
+		(S_WALLCOLUMNS, po::value<unsigned int>()->default_value(1), "Video wall. Custom window size is split into this many columns of tiles, each with own window (output) and render thread")
+		(S_WALLROWS, po::value<unsigned int>()->default_value(1), "Video wall. Number of rows of tiles, 1x1 is single window")
+		(S_WALLCOORDINATEDIGITS, po::value<unsigned int>()->default_value(3), "Video wall. Digits of every coordinate in field commands, 3 as in LDP or 4 for canvas wider or higher than 999")
+
+		(S_PALETTE, po::value<std::string>()->default_value(""), "Colors of indexed color commands ($f0II, %7v0II and others) as RRGGBB separated by ;, replacing palette entries from 00. The rest are standard 256 colors: 16 basic, 6x6x6 cube and 24 grays")
+
+		(S_SCENEFILE, po::value<std::string>()->default_value("scene.snapshot"), "File keeping fields shown on the wall, restored after restart if not older than fallback timeout. Empty is off")
+		(S_SCENEMAXFIELDS, po::value<unsigned int>()->default_value(1024), "Number of fields the scene file can keep, 1 KB each")
+
+		(S_MEDIACLIPS, po::value<std::string>()->default_value(""), "Animated pictures and clips played in a loop on top of fields, separated by ;. Each is left,top,width,height,fps,file where file is MJPEG (.mjpg) or numbered pictures like logo_%03d.png")
+		(S_MEDIARINGFRAMES, po::value<unsigned int>()->default_value(3), "Frames of every clip decoded ahead, memory is this many frames of clip size")
+
+		(S_FLIGHTRECORDERFILE, po::value<std::string>()->default_value("flight.rec"), "File of binary events recorded in production, kept after crash or hang, the previous one is renamed to .prev. Empty is off")
+		(S_FLIGHTRECORDEREVENTS, po::value<unsigned int>()->default_value(1048576), "Number of last events in flight recorder file, 32 bytes each")
+		(S_FLIGHTRECORDERDECODE, po::value<std::string>()->default_value(""), "Print flight recorder file as text and exit instead of normal work. Usually given in command line")
+
+		(S_METRICSADDRESS, po::value<std::string>()->default_value("127.0.0.1"), "Address of HTTP server giving counters for monitoring at /metrics in Prometheus format")
+		(S_METRICSPORT, po::value<unsigned int>()->default_value(9464), "Port of metrics HTTP server. 0 is off")
+
+		(S_EXPORTNAME, po::value<std::string>()->default_value(""), "Name of shared memory the shown frames are published to for local recorders and streamers. Empty is off, tiled wall is not exported")
+		(S_EXPORTSLOTS, po::value<unsigned int>()->default_value(3), "Frames kept in export shared memory, memory is this many frames of window size")
+		(S_EXPORTEVERYFRAME, po::value<unsigned int>()->default_value(1), "Every Nth shown frame is exported, 1 is all. Also applies to remote view")
+
+		(S_REMOTEVIEWADDRESS, po::value<std::string>()->default_value("127.0.0.1"), "Address of TCP stream of changed frame tiles for remote view of the board")
+		(S_REMOTEVIEWPORT, po::value<unsigned int>()->default_value(0), "Port of remote view stream. 0 is off, tiled wall has no remote view")
+		(S_REMOTEVIEWTILESIZE, po::value<unsigned int>()->default_value(32), "Size in pixels of square tiles compared between frames, 8 to 256")
+		(S_REMOTEVIEWKEYFRAME, po::value<unsigned int>()->default_value(10), "Interval in seconds between keyframes with all tiles for remote view clients. 0 is only on connect")
+
+		(S_STATISTICSINTERVAL, po::value<unsigned int>()->default_value(300), "Interval in seconds between frame time and running text statistics in log, F9 logs them at once. 0 is off")
+
+		(S_BENCHMARKMODE, po::value<std::string>()->default_value(""), "Run benchmark instead of normal work and exit: kernels, render or all. Usually given in command line")
+		(S_BENCHMARKITERATIONS, po::value<unsigned int>()->default_value(100), "Number of measured iterations in benchmark")
 		;
 
 	po::store(po::parse_command_line(argc, argv, m_configOptions), m_vm);
@@ -1,4 +1,11 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
 
@@ -14,13 +21,59 @@ namespace po = boost::program_options;
 #define S_COMPORT "Main.ComPort"
 #define S_FALLBACK "Main.FallBackImage"
 #define S_FALLBACKTIMEOUT "Main.FallBackTimeout" 
+#define S_FALLBACKINTERVAL "Main.FallBackInterval"
 #define S_DISPLAYFPS "Main.DisplayFPS"
 #define S_DEFAULTFONT "Fonts.Default"
+#define S_PREWARMSIZES "Fonts.PrewarmSizes"
+#define S_TEXTCACHEMEMORY "Cache.TextMemoryLimitMB"
+#define S_GLYPHCACHEMEMORY "Cache.GlyphMemoryLimitMB"
+#define S_RASTERTHREADS "Render.RasterThreads"
+#define S_RENDERBACKEND "Render.Backend"
+#define S_SNAPSHOTFILE "Render.SnapshotFile"
+#define S_SNAPSHOTINTERVAL "Render.SnapshotInterval"
+#define S_COMPOSITETHREADS "Render.CompositeThreads"
+#define S_WALLCOLUMNS "Wall.TileColumns"
+#define S_WALLROWS "Wall.TileRows"
+#define S_WALLCOORDINATEDIGITS "Wall.CoordinateDigits"
+#define S_PALETTE "Colors.Palette"
+#define S_SCENEFILE "Scene.SnapshotFile"
+#define S_SCENEMAXFIELDS "Scene.MaxFields"
+#define S_MEDIACLIPS "Media.Clips"
+#define S_MEDIARINGFRAMES "Media.RingFrames"
+#define S_FLIGHTRECORDERFILE "FlightRecorder.File"
+#define S_FLIGHTRECORDEREVENTS "FlightRecorder.Events"
+#define S_FLIGHTRECORDERDECODE "FlightRecorder.Decode"
+#define S_METRICSADDRESS "Metrics.Address"
+#define S_METRICSPORT "Metrics.Port"
+#define S_EXPORTNAME "Export.SharedMemory"
+#define S_EXPORTSLOTS "Export.Slots"
+#define S_EXPORTEVERYFRAME "Export.EveryFrame"
+#define S_REMOTEVIEWADDRESS "RemoteView.Address"
+#define S_REMOTEVIEWPORT "RemoteView.Port"
+#define S_REMOTEVIEWTILESIZE "RemoteView.TileSize"
+#define S_REMOTEVIEWKEYFRAME "RemoteView.KeyframeInterval"
+#define S_STATISTICSINTERVAL "Statistics.LogInterval"
+#define S_BENCHMARKMODE "Benchmark.Mode"
+#define S_BENCHMARKITERATIONS "Benchmark.Iterations"
+#define S_WATCHSETTINGS "Main.WatchSettingsFile"
+
+//settings read while board works, compiled to typed values. Published snapshot is never changed,
+//new one is published when file is reloaded, so readers need no lock
+struct SettingsSnapshot
+{
+	uint64_t version;  //1 for the first, increases with every publish
+	unsigned int logLevel;
+	bool displayFPS;
+	unsigned int tabloNumber;
+	std::string defaultFont;
+	unsigned int fallbackTimeout;  //seconds
+};
 
 class INIFile
 {
 public:
 	INIFile(std::string fileName, int argc, char* argv[]);
+	~INIFile();
 
 	void LoadConfigFile(std::string fileName);
 	void LogConfigOptions(std::stringstream& stream);
@@ -30,10 +83,38 @@ public:
 	unsigned int GetUInt(std::string name);
 	std::string GetString(std::string name);
 	bool GetBool(std::string name);
+
+	//overrides value for the rest of program run, config file is not changed.
+	//Snapshot is published again from start values with this one, meant for setup before board works
+	void SetUInt(std::string name, unsigned int value);
+	void SetString(std::string name, std::string value);
+
+	//any thread, reference stays valid for the whole program run.
+	//Get* above give values from start, snapshot follows file changes
+	const SettingsSnapshot& GetSnapshot() const
+	{
+		return *m_snapshot.load(std::memory_order_acquire);
+	}
+	//reloads file when it is saved, in own thread
+	void StartWatching();
+	//reads file and command line again and publishes snapshot, keeps old one on error
+	bool Reload();
 private:
 	void Init(int argc, char* argv[]);
+	void Parse(po::variables_map& vm, const std::string& fileName);
+	void Publish(const po::variables_map& vm);
+	void WatchThreadFunction();
 
 	po::variables_map m_vm;
 	po::options_description m_configOptions;
 	bool m_loadSucsessful;
+	std::string m_fileName;
+	std::vector<std::string> m_arguments;
+
+	//published snapshots are kept, readers may still use old ones. Only a few are made in program run
+	std::mutex m_publishMutex;
+	std::vector<std::unique_ptr<const SettingsSnapshot>> m_snapshots;
+	std::atomic<const SettingsSnapshot*> m_snapshot;
+	void* m_stopEvent;  //Windows event handle
+	std::thread m_watchThread;
 };
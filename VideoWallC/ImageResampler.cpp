@@ -0,0 +1,94 @@
+#include "ImageResampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+ImageResampler::ImageResampler(unsigned int sourceWidth, unsigned int sourceHeight, unsigned int targetWidth, unsigned int targetHeight) :
+	m_sourceWidth(sourceWidth),
+	m_sourceHeight(sourceHeight),
+	m_targetWidth(targetWidth),
+	m_targetHeight(targetHeight),
+	m_columns(ComputeTaps(sourceWidth, targetWidth)),
+	m_rows(ComputeTaps(sourceHeight, targetHeight)),
+	m_line(size_t(sourceWidth) * 4)
+{
+}
+
+//separable, premultiplied alpha, one target row at a time so large pictures need no big buffer
+void ImageResampler::Resample(const sf::Uint8 * source, sf::Uint8 * target)
+{
+	if (m_sourceWidth == m_targetWidth && m_sourceHeight == m_targetHeight)
+	{
+		std::memcpy(target, source, size_t(m_targetWidth) * m_targetHeight * 4);
+		return;
+	}
+
+	for (unsigned int y = 0; y < m_targetHeight; y++)
+	{
+		std::fill(m_line.begin(), m_line.end(), 0.0f);
+		const FilterTaps& row = m_rows[y];
+		for (size_t i = 0; i < row.weights.size(); i++)
+		{
+			const sf::Uint8* sourceLine = &source[size_t(row.first + i) * m_sourceWidth * 4];
+			const float weight = row.weights[i];
+			for (unsigned int x = 0; x < m_sourceWidth; x++)
+			{
+				float alphaWeight = sourceLine[x * 4 + 3] * weight;
+				m_line[x * 4 + 0] += sourceLine[x * 4 + 0] * alphaWeight;
+				m_line[x * 4 + 1] += sourceLine[x * 4 + 1] * alphaWeight;
+				m_line[x * 4 + 2] += sourceLine[x * 4 + 2] * alphaWeight;
+				m_line[x * 4 + 3] += alphaWeight;
+			}
+		}
+
+		sf::Uint8* targetLine = &target[size_t(y) * m_targetWidth * 4];
+		for (unsigned int x = 0; x < m_targetWidth; x++)
+		{
+			const FilterTaps& column = m_columns[x];
+			float sum[4] = { 0, 0, 0, 0 };
+			for (size_t i = 0; i < column.weights.size(); i++)
+			{
+				const float* value = &m_line[size_t(column.first + i) * 4];
+				for (int c = 0; c < 4; c++) sum[c] += value[c] * column.weights[i];
+			}
+			float alpha = sum[3];
+			for (int c = 0; c < 3; c++) targetLine[x * 4 + c] = (alpha > 0) ? (sf::Uint8)std::min(std::lround(sum[c] / alpha), 255L) : 0;
+			targetLine[x * 4 + 3] = (sf::Uint8)std::min(std::lround(alpha), 255L);
+		}
+	}
+}
+
+unsigned int ImageResampler::GetSourceWidth() const
+{
+	return m_sourceWidth;
+}
+
+unsigned int ImageResampler::GetSourceHeight() const
+{
+	return m_sourceHeight;
+}
+
+//tent filter, widened by scale when shrinking so every source pixel counts
+std::vector<ImageResampler::FilterTaps> ImageResampler::ComputeTaps(unsigned int sourceSize, unsigned int targetSize)
+{
+	std::vector<FilterTaps> taps(targetSize);
+	const float scale = (float)sourceSize / targetSize;
+	const float support = std::max(scale, 1.0f);
+	for (unsigned int i = 0; i < targetSize; i++)
+	{
+		const float center = (i + 0.5f) * scale;
+		int first = std::max((int)std::floor(center - support), 0);
+		int last = std::min((int)std::ceil(center + support), (int)sourceSize - 1);
+		FilterTaps& tap = taps[i];
+		tap.first = first;
+		float total = 0;
+		for (int s = first; s <= last; s++)
+		{
+			float weight = std::max(0.0f, 1.0f - std::abs((s + 0.5f - center) / support));
+			tap.weights.push_back(weight);
+			total += weight;
+		}
+		for (float& weight : tap.weights) weight /= total;
+	}
+	return taps;
+}
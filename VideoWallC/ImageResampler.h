@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+//high quality scaling of RGBA pictures, filter is computed once for given sizes so frames of a clip reuse it
+class ImageResampler
+{
+public:
+	ImageResampler(unsigned int sourceWidth, unsigned int sourceHeight, unsigned int targetWidth, unsigned int targetHeight);
+
+	//target has room for targetWidth * targetHeight pixels
+	void Resample(const sf::Uint8* source, sf::Uint8* target);
+
+	unsigned int GetSourceWidth() const;
+	unsigned int GetSourceHeight() const;
+
+private:
+	//source pixels and their weights for one target pixel along one axis
+	struct FilterTaps
+	{
+		int first;
+		std::vector<float> weights;
+	};
+
+	static std::vector<FilterTaps> ComputeTaps(unsigned int sourceSize, unsigned int targetSize);
+
+	const unsigned int m_sourceWidth;
+	const unsigned int m_sourceHeight;
+	const unsigned int m_targetWidth;
+	const unsigned int m_targetHeight;
+	const std::vector<FilterTaps> m_columns;
+	const std::vector<FilterTaps> m_rows;
+	std::vector<float> m_line;
+};
@@ -1,191 +1,97 @@
 #include "LDPField.h"
+#include "TextRasterizer.h"
+#include "Cp1251.h"
 #include "Log.h"
 #include <sstream>
 #include <iomanip>
 #include <iostream>
 
-LDPField::LDPField() :
-m_bounds				(0, 0, 100, 10),
+LDPField::LDPField(FieldHotData& hot, uint32_t slot) :
+m_hot					(hot),
+m_slot					(slot),
 m_textColor				(255, 255, 255, 255),
 m_bgColor				(0, 0, 0, 255),
 m_textString			(),
 m_textSize				(30),
 m_textStyle				(sf::Text::Style::Regular),
-m_textRunningSpeed		(60),
-m_textRunningPosition	(0.0),
 //m_textRunningLastUpdateMicro(0),
 //m_textRunningCurrentMicro(0),
 //m_textRunningUpdateEveryMicro((int)round(1000000 / m_textRunningSpeed)),
 m_fontFileName			(),
-m_fieldType				(DisplayType::LeftAlign),
 m_formatString			("%d.%m.%Y %I:%M:%S"),
-m_textObject			(),
-m_fieldTexture			(),
-m_drawSprite			(),
-m_textFont				(),
-m_TextWidth				(0),
-m_textRunning			(false),
+m_dateTimeString		(),
+m_pTextCache			(nullptr),
+m_pRasterPool			(nullptr),
+m_rasterJob				(),
+m_renderedText			(),
 m_usingGoodFont			(false),
-m_metricsNeedUpdate		(true),
-m_elapsedSeconds		(0),
 m_elapsedCount			(0)
 {
-	LOG_DEBUG("LDPField OnCreate enter");
-}
-
-LDPField::LDPField(sf::FloatRect rect, sf::String text) :
-m_bounds				(rect),
-m_textColor				(255, 255, 255, 255),
-m_bgColor				(0, 0, 0, 255),
-m_textString			(text),
-m_textSize				(30),
-m_textStyle				(sf::Text::Style::Regular),
-m_textRunningSpeed		(60),
-m_textRunningPosition	(0.0),
-//m_textRunningLastUpdateMicro(0),
-//m_textRunningCurrentMicro(0),
-//m_textRunningUpdateEveryMicro((int)round(1000000 / m_textRunningSpeed)),
-m_fontFileName			(),
-m_fieldType				(DisplayType::LeftAlign),
-m_formatString			("%d.%m.%Y %I:%M:%S"),
-m_textObject			(),
-m_fieldTexture			(),
-m_drawSprite			(),
-m_textFont				(),
-m_TextWidth				(0),
-m_textRunning			(false),
-m_usingGoodFont			(false),
-m_metricsNeedUpdate		(true),
-m_elapsedSeconds		(0),
-m_elapsedCount			(0)
-{
-	LOG_DEBUG("LDPField OnCreate enter");	
-}
-
-LDPField::LDPField(const LDPField & copy) :
-m_bounds(copy.m_bounds),
-m_textColor(copy.m_textColor),
-m_bgColor(copy.m_bgColor),
-m_textString(copy.m_textString),
-m_textSize(copy.m_textSize),
-m_textStyle(copy.m_textStyle),
-m_textRunningSpeed(copy.m_textRunningSpeed),
-m_textRunningPosition(copy.m_textRunningPosition),
-//m_textRunningLastUpdateMicro(copy.m_textRunningLastUpdateMicro),
-//m_textRunningCurrentMicro(copy.m_textRunningCurrentMicro),
-//m_textRunningUpdateEveryMicro((int)round(1000000 / m_textRunningSpeed)),
-m_fontFileName(copy.m_fontFileName),
-m_fieldType(copy.m_fieldType),
-m_formatString(copy.m_formatString),
-m_textObject(copy.m_textObject),
-m_fieldTexture(),
-m_drawSprite(copy.m_drawSprite),
-m_textFont(copy.m_textFont),
-m_TextWidth(copy.m_TextWidth),
-m_textRunning(copy.m_textRunning),
-m_usingGoodFont(copy.m_usingGoodFont),
-m_metricsNeedUpdate(true),
-m_elapsedSeconds(copy.m_elapsedSeconds),
-m_elapsedCount(0)
-{
-	LOG_DEBUG("LDPField OnCopy enter");
-	EnsureMetricsUpdate();	
+	LOG_HOT_DEBUG("LDPField OnCreate enter");
+	m_hot.bounds[m_slot] = sf::FloatRect(0, 0, 100, 10);
+	m_hot.scrollPosition[m_slot] = 0.0;
+	m_hot.textWidth[m_slot] = 0;
+	m_hot.speed[m_slot] = 60;
+	m_hot.scrollIntervalMicro[m_slot] = 0;
+	m_hot.flags[m_slot] = FieldHotData::MetricsDirty;
+	m_hot.type[m_slot] = DisplayType::LeftAlign;
+	m_hot.scrollStatistics[m_slot].Reset();
 }
 
 LDPField::~LDPField()
 {
-	LOG_DEBUG("LDPField OnDestroy enter");
+	LOG_HOT_DEBUG("LDPField OnDestroy enter");
 }
 
-void LDPField::draw(sf::RenderWindow & window)
+void LDPField::draw(RenderBackend& backend)
 {
-	EnsureMetricsUpdate();
-
-	if (m_usingGoodFont == false) return;
+	EnsureMetricsUpdate(backend);
 
-	//m_fieldTexture.clear(m_bgColor);
-	//m_fieldTexture.draw(m_textObject);
-	//m_fieldTexture.display();
-	
-	window.draw(m_drawSprite);
-}
-
-bool LDPField::update(sf::Int64 elapsedMicroseconds, bool needUpdateRunning)
-{
-	bool returnValue = false;
-	if (m_metricsNeedUpdate == true) returnValue = true;
-	EnsureMetricsUpdate();
+	if (m_usingGoodFont == false || m_renderedText == nullptr) return;
 
-	/*if (m_textRunning == true)
+	const sf::FloatRect& bounds = m_hot.bounds[m_slot];
+	sf::IntRect texRect(0, 0, m_renderedText->width, m_renderedText->height);
+	if (HasFlag(FieldHotData::Running) == true)
 	{
-		double offset = elapsedMicroseconds * (m_textRunningSpeed / 1000. / 1000.);
-		//sf::Vector2f pos = m_textObject.getPosition();
-		double pos = m_textRunningPosition;
-		//std::cout << elapsedMicroseconds << '\n';
-
-		pos += offset;
-		//pos += 0.5;
-		if (std::abs(pos) > m_TextWidth) pos -= m_TextWidth;
-		m_textRunningPosition = pos;
-		//pos.x = round(pos.x);
-
-		sf::IntRect rect = m_drawSprite.getTextureRect();
-		rect.left = (int)round(m_textRunningPosition);
-		m_drawSprite.setTextureRect(rect);
-		//m_textObject.setPosition(pos);
-	}*/
-	//m_textRunningCurrentMicro += elapsedMicroseconds;
-
-	if (m_textRunning == true)
-	{		
-		//if (m_textRunningCurrentMicro >= (m_textRunningLastUpdateMicro + m_textRunningUpdateEveryMicro))
-		//if (current >= (last + m_textRunningUpdateEveryMicro))
-		if (needUpdateRunning == true)
-		{
-			//m_textRunningLastUpdateMicro += m_textRunningUpdateEveryMicro;			
-			m_textRunningPosition += 1;
-			if (std::abs(m_textRunningPosition) > m_TextWidth) m_textRunningPosition -= m_TextWidth;			
-			sf::IntRect rect = m_drawSprite.getTextureRect();
-			rect.left = (int)round(m_textRunningPosition);
-			m_drawSprite.setTextureRect(rect);
-			returnValue = true;
-			//LOG_TRACE("TextRunningPosition={}", m_textRunningPosition);
-		}		
+		texRect.left = (int)round(m_hot.scrollPosition[m_slot]);
+		texRect.width = (int)bounds.width;
+		texRect.height = (int)bounds.height;
 	}
+	backend.DrawBitmap(*m_renderedText, texRect, sf::Vector2f(bounds.left, bounds.top));
+}
 
-	m_elapsedSeconds += elapsedMicroseconds / 1000.0 / 1000.0;
-	if (m_elapsedSeconds > 0.5)
-	{
-		m_elapsedSeconds -= 0.5;
+bool LDPField::update(RenderBackend& backend)
+{
+	return EnsureMetricsUpdate(backend);
+}
 
-		if (m_fieldType == LDPField::DisplayType::DateTime)
-		{
-			SYSTEMTIME local;
-			GetLocalTime(&local);
-			m_elapsedCount = (int)(((local.wSecond * 1000) + local.wMilliseconds) / 500);
+void LDPField::tickClock()
+{
+	if (getFieldType() != LDPField::DisplayType::DateTime) return;
 
-			UpdateDateTime();
-			m_metricsNeedUpdate = true;			
-		}
-	}
+	SYSTEMTIME local;
+	GetLocalTime(&local);
+	m_elapsedCount = (int)(((local.wSecond * 1000) + local.wMilliseconds) / 500);
 
-	return returnValue;
+	UpdateDateTime();
+	SetFlag(FieldHotData::MetricsDirty, true);
 }
 
-const sf::FloatRect LDPField::getBounds()
+const sf::FloatRect& LDPField::getBounds() const
 {
-	return m_bounds;
+	return m_hot.bounds[m_slot];
 }
 
-void LDPField::setBounds(sf::FloatRect& bounds)
+void LDPField::setBounds(const sf::FloatRect& bounds)
 {
-	if (bounds.left == m_bounds.left &&
-		bounds.width == m_bounds.width &&
-		bounds.top == m_bounds.top &&
-		bounds.height == m_bounds.height) return;
-
-	m_bounds = bounds;
-	m_metricsNeedUpdate = true;	
+	sf::FloatRect& current = m_hot.bounds[m_slot];
+	if (bounds.left == current.left &&
+		bounds.width == current.width &&
+		bounds.top == current.top &&
+		bounds.height == current.height) return;
+
+	current = bounds;
+	SetFlag(FieldHotData::MetricsDirty, true);
 }
 
 const sf::Color LDPField::getTextColor() const
@@ -198,7 +104,7 @@ void LDPField::setTextColor(sf::Color color)
 	if (color != m_textColor)
 	{
 		m_textColor = color;
-		m_metricsNeedUpdate = true;
+		SetFlag(FieldHotData::MetricsDirty, true);
 	}
 }
 
@@ -212,7 +118,7 @@ void LDPField::setBGColor(sf::Color bgColor)
 	if (bgColor != m_bgColor)
 	{
 		m_bgColor = bgColor;
-		m_metricsNeedUpdate = true;
+		SetFlag(FieldHotData::MetricsDirty, true);
 	}
 }
 
@@ -221,12 +127,13 @@ const sf::String& LDPField::getTextString() const
 	return m_textString;
 }
 
-void LDPField::setTextString(std::string text)
+void LDPField::setTextString(const std::string& text)
 {
-	if (text != m_textString)
+	sf::String decoded(Cp1251::Decode(text));
+	if (decoded != m_textString)
 	{
-		m_textString = text;
-		m_metricsNeedUpdate = true;
+		m_textString = decoded;
+		SetFlag(FieldHotData::MetricsDirty, true);
 	}
 }
 
@@ -240,7 +147,7 @@ void LDPField::setTextSize(uint32_t size)
 	if (size != m_textSize)
 	{
 		m_textSize = size;
-		m_metricsNeedUpdate = true;
+		SetFlag(FieldHotData::MetricsDirty, true);
 	}
 }
 
@@ -254,43 +161,38 @@ void LDPField::setTextStyle(sf::Text::Style style)
 	if (style != m_textStyle)
 	{
 		m_textStyle = style;
-		m_metricsNeedUpdate = true;
+		SetFlag(FieldHotData::MetricsDirty, true);
 	}
 }
 
 float LDPField::getTextSpeed() const
 {
-	return m_textRunningSpeed;
+	return m_hot.speed[m_slot];
 }
 
 void LDPField::setTextSpeed(float speed)
 {
-	if (speed != m_textRunningSpeed)
+	if (speed != m_hot.speed[m_slot])
 	{
-		m_textRunningSpeed = speed;
+		m_hot.speed[m_slot] = speed;
 		//CalculateRunningMicroseconds();
 	}
 }
 
-const sf::Font* LDPField::getFont() const
-{
-	return &m_textFont;
-}
-
 bool LDPField::setFont(std::string fontName)
 {
 	if (m_fontFileName.compare(fontName) != 0)
 	{
-		bool b = m_textFont.loadFromFile(fontName);
+		bool b = TextRasterizer::CheckFont(fontName);
 		if (b == true)
 		{
-			m_metricsNeedUpdate = true;
+			SetFlag(FieldHotData::MetricsDirty, true);
 			m_usingGoodFont = true;
 			m_fontFileName = fontName;
 		}
 		else
 		{
-			m_metricsNeedUpdate = false;
+			SetFlag(FieldHotData::MetricsDirty, false);
 			m_usingGoodFont = false;
 		}
 		return b;
@@ -301,15 +203,16 @@ bool LDPField::setFont(std::string fontName)
 
 const LDPField::DisplayType LDPField::getFieldType() const
 {
-	return m_fieldType;
+	return (DisplayType)m_hot.type[m_slot];
 }
 
 void LDPField::setDisplayType(LDPField::DisplayType type)
 {
-	if (type != m_fieldType)
+	if (type != getFieldType())
 	{
-		m_fieldType = type;
-		m_metricsNeedUpdate = true;
+		m_hot.type[m_slot] = (uint8_t)type;
+		SetFlag(FieldHotData::DateTime, type == DisplayType::DateTime);
+		SetFlag(FieldHotData::MetricsDirty, true);
 	}
 }
 
@@ -323,114 +226,163 @@ void LDPField::setFormatString(std::string format)
 	if (format != m_formatString)
 	{
 		m_formatString = format;
-		m_metricsNeedUpdate = true;
+		SetFlag(FieldHotData::MetricsDirty, true);
 	}
 }
 
 bool LDPField::getMetricsNeedUpdate() const
 {
-	return m_metricsNeedUpdate;
+	return HasFlag(FieldHotData::MetricsDirty);
+}
+
+bool LDPField::isRenderPending() const
+{
+	return HasFlag(FieldHotData::MetricsDirty) || HasFlag(FieldHotData::RasterPending);
+}
+
+uint32_t LDPField::getSlot() const
+{
+	return m_slot;
 }
 
-void LDPField::EnsureMetricsUpdate()
+void LDPField::setTextCache(TextCache* cache)
 {
-	if (m_metricsNeedUpdate)
+	m_pTextCache = cache;
+}
+
+void LDPField::setRasterPool(RasterWorkerPool* pool)
+{
+	m_pRasterPool = pool;
+}
+
+const RunningStatistics & LDPField::getScrollStatistics() const
+{
+	return m_hot.scrollStatistics[m_slot];
+}
+
+void LDPField::resetScrollStatistics()
+{
+	m_hot.scrollStatistics[m_slot].Reset();
+}
+
+bool LDPField::HasFlag(FieldHotData::Flags flag) const
+{
+	return (m_hot.flags[m_slot] & flag) != 0;
+}
+
+void LDPField::SetFlag(FieldHotData::Flags flag, bool value)
+{
+	if (value) m_hot.flags[m_slot] |= flag;
+	else m_hot.flags[m_slot] &= ~flag;
+}
+
+void LDPField::SetRasterJob(std::shared_ptr<RasterJob> job)
+{
+	m_rasterJob = job;
+	SetFlag(FieldHotData::RasterPending, m_rasterJob != nullptr);
+}
+
+bool LDPField::EnsureMetricsUpdate(RenderBackend& backend)
+{
+	bool applied = false;
+	if (HasFlag(FieldHotData::MetricsDirty))
 	{
-		CalculateMetrics();
+		applied = CalculateMetrics(backend);
 	}
+	if (CheckRasterJob(backend) == true) applied = true;
+	return applied;
 }
 
-void LDPField::CalculateMetrics()
+//returns true if new text is already applied
+bool LDPField::CalculateMetrics(RenderBackend& backend)
 {
 	//checking if the font is good
 	if (m_usingGoodFont == false)
 	{
-		m_metricsNeedUpdate = false;
-		return;
+		SetFlag(FieldHotData::MetricsDirty, false);
+		return false;
 	}		
-		
-	sf::Texture& texture = const_cast<sf::Texture&>(m_textFont.getTexture(m_textSize));
-	texture.setSmooth(true);	
-
-	//calculating lower bounds
-	sf::Text tempText("Hxj", m_textFont, m_textSize);
-	tempText.setStyle(m_textStyle);
-	sf::FloatRect tempBounds = tempText.getLocalBounds();
-	float t = m_bounds.height - (tempBounds.top + tempBounds.height);
-	m_textObject.setOrigin(0, -t);
-	
-	//updating text object
-	m_textObject.setFont(m_textFont);
-	m_textObject.setCharacterSize(m_textSize);
-	m_textObject.setStyle(m_textStyle);
-	if (m_fieldType != DisplayType::DateTime)
+	SetFlag(FieldHotData::MetricsDirty, false);
+
+	//looking for the same text already rendered
+	TextCacheKey key = MakeCacheKey();
+	TextCache* cache = GetTextCache();
+	std::shared_ptr<const RenderedText> rendered;
+	if (cache != nullptr) rendered = cache->Find(key);
+	if (rendered != nullptr)
 	{
-		std::wstring wtemp = m_textString;
-		m_textObject.setString(wtemp);
+		SetRasterJob(nullptr);
+		ApplyRenderedText(rendered);
+		return true;
 	}
-	m_textObject.setFillColor(m_textColor);
-	m_textObject.setPosition(0, 0);
-	tempBounds = m_textObject.getLocalBounds();
 
-	//looking for aligment
-	m_textRunning = false;
-	switch (m_fieldType)
+	//already waiting for the same text
+	if (m_rasterJob != nullptr && m_rasterJob->key == key) return false;
+
+	if (m_pRasterPool != nullptr)
 	{
-	default:
-	case DisplayType::LeftAlign:		
-		break;
-	case DisplayType::RightAlign:
-		m_textObject.setPosition(m_bounds.width - tempBounds.width - 4, 0);		
-		break;
-	case DisplayType::CenterAlign:
-		m_textObject.setPosition(m_bounds.width / 2 - tempBounds.width / 2, 0);		
-		break;
-	case DisplayType::OptionalLeft:
-		if (tempBounds.width > m_bounds.width) m_textRunning = true;
-		break;
-	case DisplayType::Running:
-		m_textRunning = true;
-		break;
+		//old text stays on screen until worker is done
+		SetRasterJob(m_pRasterPool->Submit(key));
+		return false;
 	}
 
-	if (m_textRunning == true)
-	{	
-		std::wstring tempString = m_textString + L"   ";
-		m_textObject.setString(tempString);
-		tempBounds = m_textObject.getLocalBounds();
-		m_TextWidth = tempBounds.width + tempBounds.left;		
-
-		//updating field position and size	
-		m_fieldTexture.create((int)tempBounds.width, (int)m_bounds.height);
-		m_fieldTexture.clear(m_bgColor);
-		m_fieldTexture.draw(m_textObject);
-		m_fieldTexture.display();
-		sf::Texture& texture = const_cast<sf::Texture&>(m_fieldTexture.getTexture());
-		texture.setRepeated(true);
-
-		sf::IntRect texRect;
-		texRect.left = (int)round(m_textRunningPosition);
-		texRect.top = 0;
-		texRect.width = (int)m_bounds.width;
-		texRect.height = (int)m_bounds.height;
-
-		m_drawSprite.setTexture(m_fieldTexture.getTexture(), true);
-		m_drawSprite.setTextureRect(texRect);
-		m_drawSprite.setPosition(m_bounds.left, m_bounds.top);
-	}	
-	else
-	{
-		//updating field position and size	
-		m_fieldTexture.create((int)m_bounds.width, (int)m_bounds.height);
-		m_fieldTexture.clear(m_bgColor);
-		m_fieldTexture.draw(m_textObject);
-		m_fieldTexture.display();
+	//no workers, rendering on this thread
+	thread_local TextRasterizer rasterizer;
+	std::shared_ptr<RenderedText> newRendered = rasterizer.Render(key);
+	backend.PrepareBitmap(*newRendered);
+	if (cache != nullptr) cache->Insert(key, newRendered);
+	SetRasterJob(nullptr);
+	ApplyRenderedText(newRendered);
+	return true;
+}
+
+bool LDPField::CheckRasterJob(RenderBackend& backend)
+{
+	if (m_rasterJob == nullptr || m_rasterJob->done.load() == false) return false;
+
+	std::shared_ptr<RasterJob> job = m_rasterJob;
+	SetRasterJob(nullptr);
+	if (job->result == nullptr) return false;
+
+	backend.PrepareBitmap(*job->result);
+	TextCache* cache = GetTextCache();
+	if (cache != nullptr) cache->Insert(job->key, job->result);
+	ApplyRenderedText(job->result);
+	return true;
+}
+
+const sf::String& LDPField::GetDisplayString() const
+{
+	if (getFieldType() == DisplayType::DateTime) return m_dateTimeString;
+	return m_textString;
+}
+
+TextCache* LDPField::GetTextCache() const
+{
+	if (getFieldType() == DisplayType::DateTime) return nullptr;
+	return m_pTextCache;
+}
 
-		m_drawSprite.setTexture(m_fieldTexture.getTexture(), true);
-		m_drawSprite.setPosition(m_bounds.left, m_bounds.top);
-	}	
+TextCacheKey LDPField::MakeCacheKey() const
+{
+	TextCacheKey key;
+	key.text = GetDisplayString().toUtf32();
+	key.fontName = m_fontFileName;
+	key.textSize = m_textSize;
+	key.textStyle = m_textStyle;
+	key.textColor = m_textColor.toInteger();
+	key.bgColor = m_bgColor.toInteger();
+	key.width = (uint32_t)m_hot.bounds[m_slot].width;
+	key.height = (uint32_t)m_hot.bounds[m_slot].height;
+	key.displayType = getFieldType();
+	return key;
+}
 
-	m_metricsNeedUpdate = false;
+void LDPField::ApplyRenderedText(std::shared_ptr<const RenderedText> rendered)
+{
+	m_renderedText = rendered;
+	SetFlag(FieldHotData::Running, rendered->running);
+	m_hot.textWidth[m_slot] = rendered->textWidth;
 }
 
 void LDPField::UpdateDateTime()
@@ -466,11 +418,7 @@ void LDPField::UpdateDateTime()
 
 	std::stringstream tempStream;
 	tempStream << std::put_time(&tm, tempFormat.c_str()) << '\n';
-	m_textObject.setString(tempStream.str());
-
-	//m_fieldTexture.clear(m_bgColor);
-	//m_fieldTexture.draw(m_textObject);
-	//m_fieldTexture.display();
+	m_dateTimeString = Cp1251::Decode(tempStream.str());
 }
 
 //void LDPField::CalculateRunningMicroseconds()
@@ -1,5 +1,11 @@
 #pragma once
 #include <SFML/Graphics.hpp>
+#include <memory>
+#include "TextCache.h"
+#include "RasterWorkerPool.h"
+#include "RenderBackend.h"
+#include "Statistics.h"
+#include "FieldStore.h"
 
 class LDPField
 {
@@ -14,16 +20,20 @@ public:
 		DateTime		= 1 << 4
 	};
 
-	LDPField();
-	LDPField(sf::FloatRect rect, sf::String text);
-	LDPField(const LDPField& copy);
+	//fields are created by FieldStore, hot state lives in its arrays at slot
+	LDPField(FieldHotData& hot, uint32_t slot);
+	LDPField(const LDPField& copy) = delete;
+	LDPField& operator=(const LDPField& copy) = delete;
 	~LDPField();
 
-	void draw(sf::RenderWindow &window);
-	bool update(sf::Int64 elapsedMicroseconds, bool needUpdateRunning);
+	void draw(RenderBackend& backend);
+	//applies new text and date/time changes, running text is moved by FieldStore::AdvanceRunning
+	bool update(RenderBackend& backend);
+	//every half a second for date/time fields, blinking separators and new time
+	void tickClock();
 
-	const sf::FloatRect getBounds();
-	void setBounds(sf::FloatRect& bounds);
+	const sf::FloatRect& getBounds() const;
+	void setBounds(const sf::FloatRect& bounds);
 
 	const sf::Color getTextColor() const;
 	void setTextColor(sf::Color color);
@@ -32,7 +42,8 @@ public:
 	void setBGColor(sf::Color bgColor);
 
 	const sf::String& getTextString() const;
-	void setTextString(std::string text);
+	//text as it comes in protocol, Windows-1251
+	void setTextString(const std::string& text);
 
 	uint32_t getTextSize() const;
 	void setTextSize(uint32_t size);
@@ -43,7 +54,6 @@ public:
 	float getTextSpeed() const;
 	void setTextSpeed(float speed);
 
-	const sf::Font* getFont() const;
 	bool setFont(std::string fontName);
 
 	const LDPField::DisplayType getFieldType() const;
@@ -53,36 +63,52 @@ public:
 	void setFormatString(std::string format);
 
 	bool getMetricsNeedUpdate() const;
+	//true until text of field is rendered
+	bool isRenderPending() const;
+
+	//slot in FieldStore, stays the same while field lives
+	uint32_t getSlot() const;
+
+	void setTextCache(TextCache* cache);
+	void setRasterPool(RasterWorkerPool* pool);
+
+	//intervals between running text steps in microseconds, smooth scroll has small deviation
+	const RunningStatistics& getScrollStatistics() const;
+	void resetScrollStatistics();
 
 private:
-	sf::FloatRect		m_bounds;
+	FieldHotData&		m_hot;
+	const uint32_t		m_slot;
 	sf::Color			m_textColor;
 	sf::Color			m_bgColor;
 	sf::String			m_textString;
 	uint32_t			m_textSize;	
 	sf::Text::Style		m_textStyle;
-	float				m_textRunningSpeed;
-	double				m_textRunningPosition;
 	//sf::Int64			m_textRunningLastUpdateMicro;
 	//sf::Int64			m_textRunningCurrentMicro;
 	//sf::Int64			m_textRunningUpdateEveryMicro;
 	std::string			m_fontFileName;
-	DisplayType			m_fieldType;
 	std::string			m_formatString;
 
-	sf::Text			m_textObject;
-	sf::RenderTexture	m_fieldTexture;
-	sf::Sprite			m_drawSprite;
-	sf::Font			m_textFont;
-	float				m_TextWidth;
-	bool				m_textRunning;
+	sf::String			m_dateTimeString;
+	TextCache*			m_pTextCache;
+	RasterWorkerPool*	m_pRasterPool;
+	std::shared_ptr<RasterJob> m_rasterJob;
+	std::shared_ptr<const RenderedText> m_renderedText;
 	bool				m_usingGoodFont;
-	bool				m_metricsNeedUpdate;
-	double				m_elapsedSeconds;
 	size_t				m_elapsedCount;
 
-	void EnsureMetricsUpdate();
-	void CalculateMetrics();
+	bool HasFlag(FieldHotData::Flags flag) const;
+	void SetFlag(FieldHotData::Flags flag, bool value);
+	void SetRasterJob(std::shared_ptr<RasterJob> job);
+	bool EnsureMetricsUpdate(RenderBackend& backend);
+	bool CalculateMetrics(RenderBackend& backend);
+	bool CheckRasterJob(RenderBackend& backend);
+	const sf::String& GetDisplayString() const;
+	TextCacheKey MakeCacheKey() const;
+	//nullptr for clocks, their text is new every tick and would push station names out of cache
+	TextCache* GetTextCache() const;
+	void ApplyRenderedText(std::shared_ptr<const RenderedText> rendered);
 	void UpdateDateTime();
 
 	//void CalculateRunningMicroseconds();
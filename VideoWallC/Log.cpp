@@ -1,12 +1,17 @@
 #include "Log.h"
+#include "AsyncLogSink.h"
 
 namespace vw {
 	std::shared_ptr<spdlog::logger> Log::m_logger;
 
+	static const size_t LOG_RING_CAPACITY = 8192;  //messages, about 4 MB
+
 	void Log::Init()
 	{
-		m_logger = spdlog::rotating_logger_mt("Main", "output.log", 1024 * 1024 * 20, 20);
-		m_logger->flush_on(spdlog::level::debug);
+		//file is written and rotated only by writer thread of async sink
+		auto fileSink = std::make_shared<spdlog::sinks::rotating_file_sink_st>("output.log", 1024 * 1024 * 20, 20);
+		m_logger = std::make_shared<spdlog::logger>("Main", std::make_shared<AsyncLogSink>(fileSink, LOG_RING_CAPACITY));
+		m_logger->flush_on(spdlog::level::err);
 		m_logger->set_pattern("[%d.%m.%Y %T.%f][%l]  %v");
 		m_logger->set_level(spdlog::level::trace);
 	}
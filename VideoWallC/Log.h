@@ -23,6 +23,16 @@ namespace vw {
 #define LOG_ERROR(...) ::vw::Log::GetLogger()->error(__VA_ARGS__)
 #define LOG_CRITICAL(...) ::vw::Log::GetLogger()->critical(__VA_ARGS__)
 
+//trace and debug in packet ingest and per field code, compiled only with CUSTOM_HOTPATHLOG (debug build),
+//so debug level in production does not slow down packets and frames
+#ifdef CUSTOM_HOTPATHLOG
+#define LOG_HOT_TRACE(...) LOG_TRACE(__VA_ARGS__)
+#define LOG_HOT_DEBUG(...) LOG_DEBUG(__VA_ARGS__)
+#else
+#define LOG_HOT_TRACE(...) ((void)0)
+#define LOG_HOT_DEBUG(...) ((void)0)
+#endif
+
 /*
 trace = SPDLOG_LEVEL_TRACE,
 debug = SPDLOG_LEVEL_DEBUG,
@@ -0,0 +1,394 @@
+#include "MediaField.h"
+#include "ImageResampler.h"
+#include "Log.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+//reads frames of clip one by one and starts over at the end
+class MediaFrameSource
+{
+public:
+	virtual ~MediaFrameSource() {}
+	//false when no frame can be read at all
+	virtual bool Next(sf::Image& image) = 0;
+	//one picture, nothing to decode after first frame
+	virtual bool IsStill() const = 0;
+};
+
+//files numbered with printf like %d or %03d, numbering starts at 0 or 1
+class ImageSequenceSource : public MediaFrameSource
+{
+public:
+	ImageSequenceSource(const std::string& pattern) :
+		m_prefix(pattern),
+		m_suffix(),
+		m_width(0),
+		m_numbered(false),
+		m_first(0),
+		m_index(0)
+	{
+		size_t percent = pattern.find('%');
+		if (percent == std::string::npos) return;
+		size_t digits = percent + 1;
+		while (digits < pattern.size() && isdigit((unsigned char)pattern[digits])) digits++;
+		if (digits >= pattern.size() || pattern[digits] != 'd') return;
+		m_prefix = pattern.substr(0, percent);
+		m_suffix = pattern.substr(digits + 1);
+		m_width = (digits > percent + 1) ? std::stoul(pattern.substr(percent + 1, digits - percent - 1)) : 0;
+		m_numbered = true;
+		std::ifstream zero(GetName(0), std::ios::binary);
+		m_first = zero.is_open() ? 0 : 1;
+		m_index = m_first;
+	}
+
+	bool Next(sf::Image& image) override
+	{
+		if (m_numbered == false) return image.loadFromFile(m_prefix);
+		if (image.loadFromFile(GetName(m_index)))
+		{
+			m_index++;
+			return true;
+		}
+		//past the last picture
+		if (m_index == m_first) return false;
+		m_index = m_first;
+		return Next(image);
+	}
+
+	bool IsStill() const override
+	{
+		return m_numbered == false;
+	}
+
+private:
+	std::string GetName(size_t index) const
+	{
+		std::string number = std::to_string(index);
+		if (number.size() < m_width) number.insert(0, m_width - number.size(), '0');
+		return m_prefix + number + m_suffix;
+	}
+
+	std::string m_prefix;
+	std::string m_suffix;
+	size_t m_width;
+	bool m_numbered;
+	size_t m_first;
+	size_t m_index;
+};
+
+static const size_t MJPEG_CHUNK_SIZE = 64 * 1024;
+static const size_t MJPEG_MAX_FRAME_SIZE = 16 * 1024 * 1024;
+
+//concatenated JPEG pictures, each from FFD8 start marker to FFD9 end marker. File is read in chunks,
+//only the frame being cut out is kept in memory. Segments are walked by their length, so FFD9 of
+//EXIF thumbnail in APP1 does not end the frame
+class MjpegSource : public MediaFrameSource
+{
+public:
+	MjpegSource(const std::string& fileName) :
+		m_file(fileName, std::ios::binary),
+		m_buffer(),
+		m_framesInPass(0),
+		m_scanPosition(0),
+		m_scanState(ScanSegments)
+	{
+	}
+
+	bool Next(sf::Image& image) override
+	{
+		if (m_file.is_open() == false) return false;
+		while (true)
+		{
+			size_t start = FindMarker(0xD8, 0);
+			if (start != std::string::npos)
+			{
+				//frame is kept at the beginning of buffer, so scan goes on from where it stopped when next chunk comes
+				if (start != 0)
+				{
+					m_buffer.erase(m_buffer.begin(), m_buffer.begin() + start);
+					m_scanPosition = 0;
+				}
+				size_t end = FindFrameEnd();
+				if (end != std::string::npos)
+				{
+					bool decoded = image.loadFromMemory(&m_buffer[0], end + 2);
+					m_buffer.erase(m_buffer.begin(), m_buffer.begin() + end + 2);
+					m_scanPosition = 0;
+					if (decoded)
+					{
+						m_framesInPass++;
+						return true;
+					}
+					LOG_DEBUG("Skipping broken MJPEG frame of {} bytes", end + 2);
+					continue;
+				}
+			}
+			else if (m_buffer.size() > 1)
+			{
+				//garbage between frames, last byte may be half of marker
+				m_buffer.erase(m_buffer.begin(), m_buffer.end() - 1);
+			}
+
+			if (m_buffer.size() > MJPEG_MAX_FRAME_SIZE)
+			{
+				LOG_ERROR("MJPEG frame is bigger than {} bytes, skipping", MJPEG_MAX_FRAME_SIZE);
+				m_buffer.clear();
+				m_scanPosition = 0;
+			}
+			if (ReadChunk() == false)
+			{
+				//end of file, starting over unless there was nothing to show
+				if (m_framesInPass == 0) return false;
+				m_framesInPass = 0;
+				m_buffer.clear();
+				m_scanPosition = 0;
+				m_file.clear();
+				m_file.seekg(0);
+			}
+		}
+	}
+
+	bool IsStill() const override
+	{
+		return false;
+	}
+
+private:
+	size_t FindMarker(unsigned char marker, size_t from) const
+	{
+		for (size_t i = from; i + 1 < m_buffer.size(); i++)
+		{
+			if ((unsigned char)m_buffer[i] == 0xFF && (unsigned char)m_buffer[i + 1] == marker) return i;
+		}
+		return std::string::npos;
+	}
+
+	//position of EOI of frame at the beginning of buffer, npos if frame is not read whole yet
+	size_t FindFrameEnd()
+	{
+		if (m_scanPosition == 0)
+		{
+			m_scanPosition = 2;
+			m_scanState = ScanSegments;
+		}
+		size_t& i = m_scanPosition;
+		while (i + 1 < m_buffer.size())
+		{
+			if (m_scanState == ScanPlain)
+			{
+				size_t end = FindMarker(0xD9, i);
+				//last byte may be half of marker
+				if (end == std::string::npos) i = m_buffer.size() - 1;
+				return end;
+			}
+			if (m_scanState == ScanEntropyData)
+			{
+				//entropy coded data after scan header ends at first marker that is not stuffed zero or restart
+				unsigned char next = (unsigned char)m_buffer[i + 1];
+				if ((unsigned char)m_buffer[i] == 0xFF && next != 0x00 && (next < 0xD0 || next > 0xD7)) m_scanState = ScanSegments;
+				else i++;
+				continue;
+			}
+
+			//not a marker where segment should start, looking for end marker the simple way
+			if ((unsigned char)m_buffer[i] != 0xFF)
+			{
+				m_scanState = ScanPlain;
+				continue;
+			}
+			unsigned char marker = (unsigned char)m_buffer[i + 1];
+			if (marker == 0xFF)
+			{
+				//fill byte
+				i++;
+				continue;
+			}
+			if (marker == 0xD9) return i;
+			//markers without length
+			if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))
+			{
+				i += 2;
+				continue;
+			}
+			if (i + 3 >= m_buffer.size()) return std::string::npos;
+			size_t length = ((size_t)(unsigned char)m_buffer[i + 2] << 8) | (unsigned char)m_buffer[i + 3];
+			i += 2 + length;
+			if (marker == 0xDA) m_scanState = ScanEntropyData;
+		}
+		return std::string::npos;
+	}
+
+	bool ReadChunk()
+	{
+		size_t size = m_buffer.size();
+		m_buffer.resize(size + MJPEG_CHUNK_SIZE);
+		m_file.read(&m_buffer[size], MJPEG_CHUNK_SIZE);
+		m_buffer.resize(size + (size_t)m_file.gcount());
+		return m_file.gcount() > 0;
+	}
+
+	std::ifstream m_file;
+	enum ScanState
+	{
+		ScanSegments,
+		ScanEntropyData,
+		ScanPlain	//data is not JPEG segments, frame ends at first EOI
+	};
+
+	std::vector<char> m_buffer;
+	size_t m_framesInPass;
+	//where frame end search stopped, 0 - not started
+	size_t m_scanPosition;
+	ScanState m_scanState;
+};
+
+static bool IsMjpegFile(const std::string& fileName)
+{
+	size_t dot = fileName.find_last_of('.');
+	if (dot == std::string::npos) return false;
+	std::string extension = fileName.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	return extension == "mjpg" || extension == "mjpeg";
+}
+
+MediaField::MediaField(const MediaClip & clip, size_t ringFrames) :
+	m_clip(clip),
+	m_frameMicro((sf::Int64)(1000000 / clip.fps)),
+	m_shown(),
+	m_haveFrame(false),
+	m_sinceFrameMicro(0),
+	m_ring(std::max(ringFrames, size_t(2))),
+	m_readIndex(0),
+	m_writeIndex(0),
+	m_readyCount(0),
+	m_stopping(false),
+	m_decodeThread()
+{
+	const size_t frameSize = size_t(clip.area.width) * clip.area.height * 4;
+	m_shown.width = clip.area.width;
+	m_shown.height = clip.area.height;
+	m_shown.streamed = true;
+	m_shown.pixels.resize(frameSize);
+	for (std::vector<sf::Uint8>& frame : m_ring) frame.resize(frameSize);
+
+	std::thread t(&MediaField::DecodeThreadFunction, this);
+	m_decodeThread.swap(t);
+	LOG_INFO("Media field file={0} at ({1},{2}) {3}x{4}, fps={5}, ring of {6} frames", clip.file, clip.area.left, clip.area.top,
+		clip.area.width, clip.area.height, clip.fps, m_ring.size());
+}
+
+MediaField::~MediaField()
+{
+	{
+		std::lock_guard<std::mutex> mut(m_ringMutex);
+		m_stopping = true;
+	}
+	m_ringCondition.notify_all();
+	m_decodeThread.join();
+}
+
+bool MediaField::Update(RenderBackend & backend, sf::Int64 elapsedMicro)
+{
+	m_sinceFrameMicro += elapsedMicro;
+	if (m_haveFrame && m_sinceFrameMicro < m_frameMicro) return false;
+	{
+		std::lock_guard<std::mutex> mut(m_ringMutex);
+		//decoder is late, current frame stays
+		if (m_readyCount == 0) return false;
+		//shown buffer goes back to ring, nothing is allocated
+		m_shown.pixels.swap(m_ring[m_readIndex]);
+		m_readIndex = (m_readIndex + 1) % m_ring.size();
+		m_readyCount--;
+	}
+	m_ringCondition.notify_one();
+
+	//keeping cadence, but not catching up after a stall
+	m_sinceFrameMicro = m_haveFrame ? std::min(m_sinceFrameMicro - m_frameMicro, m_frameMicro) : 0;
+	m_haveFrame = true;
+	backend.PrepareBitmap(m_shown);
+	return true;
+}
+
+void MediaField::Draw(RenderBackend & backend)
+{
+	if (m_haveFrame == false) return;
+	backend.DrawBitmap(m_shown, sf::IntRect(0, 0, m_shown.width, m_shown.height), sf::Vector2f((float)m_clip.area.left, (float)m_clip.area.top));
+}
+
+std::vector<MediaClip> MediaField::ParseClipList(const std::string & list)
+{
+	std::vector<MediaClip> clips;
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ';'))
+	{
+		if (item.find_first_not_of(" \t") == std::string::npos) continue;
+		std::stringstream itemStream(item);
+		std::string values[5];
+		for (std::string& value : values) std::getline(itemStream, value, ',');
+		std::string file;
+		std::getline(itemStream, file);
+		size_t first = file.find_first_not_of(" \t");
+		size_t last = file.find_last_not_of(" \t");
+		try
+		{
+			if (first == std::string::npos) throw std::invalid_argument("no file");
+			MediaClip clip;
+			clip.area = sf::IntRect(std::stoi(values[0]), std::stoi(values[1]), std::stoi(values[2]), std::stoi(values[3]));
+			clip.fps = std::stof(values[4]);
+			clip.file = file.substr(first, last - first + 1);
+			if (clip.area.width <= 0 || clip.area.height <= 0 || clip.fps <= 0) throw std::invalid_argument("empty area or fps");
+			clips.push_back(clip);
+		}
+		catch (std::exception& e)
+		{
+			LOG_ERROR("Wrong media clip={0}, expected left,top,width,height,fps,file: {1}", item, e.what());
+		}
+	}
+	return clips;
+}
+
+void MediaField::DecodeThreadFunction()
+{
+	LOG_DEBUG("Media decode thread enter, file={}", m_clip.file);
+	std::unique_ptr<MediaFrameSource> source;
+	if (IsMjpegFile(m_clip.file)) source.reset(new MjpegSource(m_clip.file));
+	else source.reset(new ImageSequenceSource(m_clip.file));
+
+	//picture and scaling filter are reused by all frames of the same size
+	sf::Image image;
+	std::unique_ptr<ImageResampler> resampler;
+	size_t decodedCount = 0;
+	std::unique_lock<std::mutex> lock(m_ringMutex);
+	while (true)
+	{
+		m_ringCondition.wait(lock, [this] { return m_stopping || m_readyCount < m_ring.size(); });
+		if (m_stopping) break;
+		//slot at write index is not touched by render thread until it is counted as ready
+		std::vector<sf::Uint8>& frame = m_ring[m_writeIndex];
+		lock.unlock();
+
+		if (source->Next(image) == false)
+		{
+			LOG_ERROR("Failed to read frames of media file={}, field stays empty", m_clip.file);
+			lock.lock();
+			break;
+		}
+		sf::Vector2u size = image.getSize();
+		if (resampler == nullptr || resampler->GetSourceWidth() != size.x || resampler->GetSourceHeight() != size.y)
+		{
+			resampler.reset(new ImageResampler(size.x, size.y, m_clip.area.width, m_clip.area.height));
+		}
+		resampler->Resample(image.getPixelsPtr(), frame.data());
+		decodedCount++;
+
+		lock.lock();
+		m_writeIndex = (m_writeIndex + 1) % m_ring.size();
+		m_readyCount++;
+		if (source->IsStill()) break;
+	}
+	lock.unlock();
+	LOG_DEBUG("Media decode thread exit, file={0}, decoded {1} frames", m_clip.file, decodedCount);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RenderBackend.h"
+
+//where and what to play, file is MJPEG (.mjpg, .mjpeg) or numbered picture sequence like logo_%03d.png
+struct MediaClip
+{
+	sf::IntRect area;
+	float fps;
+	std::string file;
+};
+
+class MediaFrameSource;
+
+//region of the wall playing animated logo or short clip in a loop. Frames are decoded and scaled on own thread
+//into a ring of few preallocated frames, so memory does not depend on clip length
+class MediaField
+{
+public:
+	MediaField(const MediaClip& clip, size_t ringFrames);
+	~MediaField();
+
+	//render thread, takes next frame when it is due and uploads it, returns true when frame changed
+	bool Update(RenderBackend& backend, sf::Int64 elapsedMicro);
+	void Draw(RenderBackend& backend);
+
+	//"left,top,width,height,fps,file; ..." to clips, wrong entries are logged and skipped
+	static std::vector<MediaClip> ParseClipList(const std::string& list);
+
+private:
+	void DecodeThreadFunction();
+
+	const MediaClip m_clip;
+	const sf::Int64 m_frameMicro;
+
+	//render thread side
+	Bitmap m_shown;
+	bool m_haveFrame;
+	sf::Int64 m_sinceFrameMicro;
+
+	//frames decoded ahead, decode thread writes at m_writeIndex, render thread swaps out at m_readIndex
+	std::vector<std::vector<sf::Uint8>> m_ring;
+	size_t m_readIndex;
+	size_t m_writeIndex;
+	size_t m_readyCount;
+	std::mutex m_ringMutex;
+	std::condition_variable m_ringCondition;
+	bool m_stopping;
+	std::thread m_decodeThread;
+};
@@ -0,0 +1,180 @@
+#include "Metrics.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+static const size_t MODE_CHARACTERS = 36;  //0-9 and a-z
+static const size_t OPCODE_COUNT = MODE_CHARACTERS * MODE_CHARACTERS + 1;  //last one is any other
+static const size_t BUCKET_COUNT = 22;  //upper bounds are 1 microsecond * 2^index, last one is +Inf
+
+//counters of one thread, written only by it
+struct MetricsShard
+{
+	std::atomic<uint64_t> counters[Metrics::CounterCount];
+	std::atomic<uint64_t> commands[OPCODE_COUNT];
+	std::atomic<uint64_t> buckets[Metrics::LatencyCount][BUCKET_COUNT];
+	std::atomic<uint64_t> latencySum[Metrics::LatencyCount];
+};
+
+struct MetricsRegistry
+{
+	std::mutex shardsMutex;
+	//shards stay after their threads exit, so totals never go back
+	std::vector<std::unique_ptr<MetricsShard>> shards;
+	std::atomic<int64_t> gauges[Metrics::GaugeCount];
+};
+
+static MetricsRegistry& GetRegistry()
+{
+	static MetricsRegistry registry;
+	return registry;
+}
+
+static thread_local MetricsShard* threadShard = nullptr;
+
+static MetricsShard& GetShard()
+{
+	if (threadShard == nullptr)
+	{
+		std::unique_ptr<MetricsShard> shard(new MetricsShard());
+		threadShard = shard.get();
+		MetricsRegistry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.shardsMutex);
+		registry.shards.push_back(std::move(shard));
+	}
+	return *threadShard;
+}
+
+//owner thread is the only writer, plain load and store are enough
+static inline void Increase(std::atomic<uint64_t>& value, uint64_t amount)
+{
+	value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+static size_t GetModeIndex(char mode)
+{
+	if (mode >= '0' && mode <= '9') return mode - '0';
+	if (mode >= 'a' && mode <= 'z') return 10 + (mode - 'a');
+	return MODE_CHARACTERS;
+}
+
+static char GetModeCharacter(size_t index)
+{
+	return (index < 10) ? char('0' + index) : char('a' + index - 10);
+}
+
+void Metrics::Add(Counter counter, uint64_t value)
+{
+	Increase(GetShard().counters[counter], value);
+}
+
+void Metrics::CountCommand(char majorMode, char minorMode)
+{
+	size_t major = GetModeIndex(majorMode);
+	size_t minor = GetModeIndex(minorMode);
+	size_t index = (major < MODE_CHARACTERS && minor < MODE_CHARACTERS) ? major * MODE_CHARACTERS + minor : OPCODE_COUNT - 1;
+	Increase(GetShard().commands[index], 1);
+}
+
+void Metrics::RecordLatency(Latency latency, uint64_t micro)
+{
+	size_t bucket = 0;
+	while (bucket < BUCKET_COUNT - 1 && (uint64_t(1) << bucket) < micro) bucket++;
+	MetricsShard& shard = GetShard();
+	Increase(shard.buckets[latency][bucket], 1);
+	Increase(shard.latencySum[latency], micro);
+}
+
+void Metrics::Set(Gauge gauge, int64_t value)
+{
+	GetRegistry().gauges[gauge].store(value, std::memory_order_relaxed);
+}
+
+static void FormatHeader(std::ostream& stream, const char* name, const char* type, const char* help)
+{
+	stream << "# HELP " << name << ' ' << help << '\n';
+	stream << "# TYPE " << name << ' ' << type << '\n';
+}
+
+static void FormatHistogram(std::ostream& stream, const char* name, const char* help, const uint64_t* buckets, uint64_t sumMicro)
+{
+	FormatHeader(stream, name, "histogram", help);
+	uint64_t cumulative = 0;
+	for (size_t i = 0; i < BUCKET_COUNT; i++)
+	{
+		cumulative += buckets[i];
+		stream << name << "_bucket{le=\"";
+		if (i == BUCKET_COUNT - 1) stream << "+Inf";
+		else stream << double(uint64_t(1) << i) / 1000000.0;
+		stream << "\"} " << cumulative << '\n';
+	}
+	stream << name << "_sum " << sumMicro / 1000000.0 << '\n';
+	stream << name << "_count " << cumulative << '\n';
+}
+
+std::string Metrics::Format()
+{
+	uint64_t counters[CounterCount] = {};
+	std::vector<uint64_t> commands(OPCODE_COUNT, 0);
+	uint64_t buckets[LatencyCount][BUCKET_COUNT] = {};
+	uint64_t latencySum[LatencyCount] = {};
+	MetricsRegistry& registry = GetRegistry();
+	{
+		std::lock_guard<std::mutex> lock(registry.shardsMutex);
+		for (const std::unique_ptr<MetricsShard>& shard : registry.shards)
+		{
+			for (size_t i = 0; i < CounterCount; i++) counters[i] += shard->counters[i].load(std::memory_order_relaxed);
+			for (size_t i = 0; i < OPCODE_COUNT; i++) commands[i] += shard->commands[i].load(std::memory_order_relaxed);
+			for (size_t i = 0; i < LatencyCount; i++)
+			{
+				for (size_t j = 0; j < BUCKET_COUNT; j++) buckets[i][j] += shard->buckets[i][j].load(std::memory_order_relaxed);
+				latencySum[i] += shard->latencySum[i].load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	std::ostringstream stream;
+	stream.precision(15);
+	FormatHeader(stream, "videowall_received_bytes_total", "counter", "Bytes read from serial port");
+	stream << "videowall_received_bytes_total " << counters[BytesReceived] << '\n';
+	FormatHeader(stream, "videowall_received_packets_total", "counter", "Packets for this board with correct CRC");
+	stream << "videowall_received_packets_total " << counters[PacketsReceived] << '\n';
+	FormatHeader(stream, "videowall_rejected_packets_total", "counter", "Packets dropped by reason");
+	stream << "videowall_rejected_packets_total{reason=\"crc\"} " << counters[PacketsRejectedCRC] << '\n';
+	stream << "videowall_rejected_packets_total{reason=\"address\"} " << counters[PacketsRejectedAddress] << '\n';
+	FormatHeader(stream, "videowall_commands_total", "counter", "Commands executed by opcode");
+	for (size_t i = 0; i < OPCODE_COUNT; i++)
+	{
+		if (commands[i] == 0) continue;
+		stream << "videowall_commands_total{opcode=\"";
+		if (i == OPCODE_COUNT - 1) stream << "other";
+		else stream << GetModeCharacter(i / MODE_CHARACTERS) << GetModeCharacter(i % MODE_CHARACTERS);
+		stream << "\"} " << commands[i] << '\n';
+	}
+	FormatHeader(stream, "videowall_failed_commands_total", "counter", "Commands refused because of field intersection or unknown mode");
+	stream << "videowall_failed_commands_total " << counters[CommandsFailed] << '\n';
+	FormatHeader(stream, "videowall_unchanged_commands_total", "counter", "Field commands skipped without parsing because they repeat the last command of their field");
+	stream << "videowall_unchanged_commands_total " << counters[CommandsUnchanged] << '\n';
+	FormatHeader(stream, "videowall_texture_upload_bytes_total", "counter", "Bytes of bitmaps uploaded to textures");
+	stream << "videowall_texture_upload_bytes_total " << counters[TextureUploadBytes] << '\n';
+	FormatHeader(stream, "videowall_remote_view_bytes_total", "counter", "Bytes of changed tiles sent to remote view clients");
+	stream << "videowall_remote_view_bytes_total " << counters[RemoteViewBytes] << '\n';
+
+	FormatHistogram(stream, "videowall_packet_parse_seconds", "Time to split packet into commands", buckets[PacketParse], latencySum[PacketParse]);
+	FormatHistogram(stream, "videowall_command_apply_seconds", "Time to parse and execute one command", buckets[CommandApply], latencySum[CommandApply]);
+	FormatHistogram(stream, "videowall_frame_interval_seconds", "Time between shown frames", buckets[FrameInterval], latencySum[FrameInterval]);
+
+	FormatHeader(stream, "videowall_fields", "gauge", "Fields on the board");
+	stream << "videowall_fields " << registry.gauges[FieldCount].load(std::memory_order_relaxed) << '\n';
+	FormatHeader(stream, "videowall_render_pending_fields", "gauge", "Fields waiting for text rendering");
+	stream << "videowall_render_pending_fields " << registry.gauges[RenderPending].load(std::memory_order_relaxed) << '\n';
+	FormatHeader(stream, "videowall_text_cache_bytes", "gauge", "Memory of rendered text cache, pixels and textures");
+	stream << "videowall_text_cache_bytes " << registry.gauges[TextCacheBytes].load(std::memory_order_relaxed) << '\n';
+	FormatHeader(stream, "videowall_text_cache_entries", "gauge", "Rendered texts in cache");
+	stream << "videowall_text_cache_entries " << registry.gauges[TextCacheEntries].load(std::memory_order_relaxed) << '\n';
+	FormatHeader(stream, "videowall_fallback_shown", "gauge", "1 when fallback image is shown instead of fields");
+	stream << "videowall_fallback_shown " << registry.gauges[FallbackShown].load(std::memory_order_relaxed) << '\n';
+	return stream.str();
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+//counters of ingest, render and memory for monitoring. Every thread counts into own block without locks
+//and atomic read-modify-write, scrape sums blocks of all threads. Text is in Prometheus exposition format
+class Metrics
+{
+public:
+	enum Counter
+	{
+		BytesReceived = 0,
+		PacketsReceived,
+		PacketsRejectedCRC,
+		PacketsRejectedAddress,
+		CommandsFailed,		//field intersection or unknown command
+		CommandsUnchanged,	//field commands skipped as the same as last one of field
+		TextureUploadBytes,
+		RemoteViewBytes,	//sent to all remote view clients
+		CounterCount
+	};
+
+	enum Latency
+	{
+		PacketParse = 0,	//packet split into commands
+		CommandApply,		//one command parsed and executed
+		FrameInterval,		//between shown frames
+		LatencyCount
+	};
+
+	//last value set, sampled by render thread
+	enum Gauge
+	{
+		FieldCount = 0,
+		RenderPending,
+		TextCacheBytes,
+		TextCacheEntries,
+		FallbackShown,
+		GaugeCount
+	};
+
+	static void Add(Counter counter, uint64_t value = 1);
+	//opcode is major and minor mode characters after %
+	static void CountCommand(char majorMode, char minorMode);
+	static void RecordLatency(Latency latency, uint64_t micro);
+	static void Set(Gauge gauge, int64_t value);
+
+	static std::string Format();
+};
@@ -0,0 +1,79 @@
+#include "MetricsServer.h"
+#include "Metrics.h"
+#include "Log.h"
+
+namespace asio = boost::asio;
+using asio::ip::tcp;
+
+static const size_t MAX_REQUEST_SIZE = 8192;
+
+struct MetricsServer::Connection
+{
+	tcp::socket socket;
+	asio::streambuf request;
+	std::string response;
+
+	Connection(asio::io_service& io) : socket(io), request(MAX_REQUEST_SIZE), response() {}
+};
+
+MetricsServer::MetricsServer(const std::string & address, unsigned short port) :
+	m_io(),
+	m_acceptor(m_io, tcp::endpoint(asio::ip::address::from_string(address), port)),
+	m_thread()
+{
+	StartAccept();
+	std::thread t([this] { m_io.run(); });
+	m_thread.swap(t);
+	LOG_INFO("Metrics server listening on {0}:{1}", address, port);
+}
+
+MetricsServer::~MetricsServer()
+{
+	m_io.stop();
+	if (m_thread.joinable()) m_thread.join();
+}
+
+void MetricsServer::StartAccept()
+{
+	std::shared_ptr<Connection> connection = std::make_shared<Connection>(m_io);
+	m_acceptor.async_accept(connection->socket, [this, connection](const boost::system::error_code& error) { OnAccept(connection, error); });
+}
+
+void MetricsServer::OnAccept(std::shared_ptr<Connection> connection, const boost::system::error_code & error)
+{
+	if (error == asio::error::operation_aborted) return;
+	if (!error)
+	{
+		asio::async_read_until(connection->socket, connection->request, "\r\n\r\n",
+			[this, connection](const boost::system::error_code& error, size_t) { OnRequest(connection, error); });
+	}
+	else LOG_WARN("Metrics server accept failed: {}", error.message());
+	StartAccept();
+}
+
+void MetricsServer::OnRequest(std::shared_ptr<Connection> connection, const boost::system::error_code & error)
+{
+	//too long or cut request, nothing to answer
+	if (error) return;
+
+	std::istream stream(&connection->request);
+	std::string method, path;
+	stream >> method >> path;
+
+	std::string status = "200 OK";
+	std::string body;
+	if (method != "GET") status = "405 Method Not Allowed";
+	else if (path == "/metrics") body = Metrics::Format();
+	else status = "404 Not Found";
+
+	connection->response = "HTTP/1.1 " + status + "\r\n"
+		"Content-Type: text/plain; version=0.0.4\r\n"
+		"Content-Length: " + std::to_string(body.size()) + "\r\n"
+		"Connection: close\r\n\r\n" + body;
+	asio::async_write(connection->socket, asio::buffer(connection->response),
+		[connection](const boost::system::error_code&, size_t)
+	{
+		boost::system::error_code ignored;
+		connection->socket.shutdown(tcp::socket::shutdown_both, ignored);
+	});
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <thread>
+#include <boost/asio.hpp>
+
+//minimal HTTP server answering GET /metrics with Metrics::Format, connections are served by own thread.
+//Meant for local scraping, so it listens on loopback unless configured otherwise
+class MetricsServer
+{
+public:
+	//throws boost::system::system_error if address can't be listened on
+	MetricsServer(const std::string& address, unsigned short port);
+	~MetricsServer();
+
+private:
+	struct Connection;
+
+	void StartAccept();
+	void OnAccept(std::shared_ptr<Connection> connection, const boost::system::error_code& error);
+	void OnRequest(std::shared_ptr<Connection> connection, const boost::system::error_code& error);
+
+	boost::asio::io_service m_io;
+	boost::asio::ip::tcp::acceptor m_acceptor;
+	std::thread m_thread;
+};
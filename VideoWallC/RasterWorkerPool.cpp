@@ -0,0 +1,88 @@
+#include "RasterWorkerPool.h"
+#include "TextRasterizer.h"
+#include "Log.h"
+
+RasterWorkerPool::RasterWorkerPool(size_t threadCount) :
+	m_workers(),
+	m_jobs(),
+	m_stopping(false)
+{
+	if (threadCount == 0)
+	{
+		size_t cores = std::thread::hardware_concurrency();
+		threadCount = (cores > 1) ? cores - 1 : 1;
+	}
+
+	for (size_t i = 0; i < threadCount; i++)
+	{
+		m_workers.emplace_back(&RasterWorkerPool::WorkerFunction, this, i);
+	}
+	LOG_INFO("Launched {} raster worker threads", threadCount);
+}
+
+RasterWorkerPool::~RasterWorkerPool()
+{
+	LOG_TRACE("Raster worker pool destructor enter");
+	{
+		std::lock_guard<std::mutex> mut(m_jobsMutex);
+		m_stopping = true;
+		m_jobs.clear();
+	}
+	m_jobsCondition.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	LOG_TRACE("Raster worker pool destructor exit");
+}
+
+std::shared_ptr<RasterJob> RasterWorkerPool::Submit(const TextCacheKey & key)
+{
+	std::shared_ptr<RasterJob> job = std::make_shared<RasterJob>();
+	job->key = key;
+	job->done.store(false);
+	{
+		std::lock_guard<std::mutex> mut(m_jobsMutex);
+		m_jobs.push_back(job);
+	}
+	m_jobsCondition.notify_one();
+	return job;
+}
+
+size_t RasterWorkerPool::GetThreadCount() const
+{
+	return m_workers.size();
+}
+
+void RasterWorkerPool::WorkerFunction(size_t index)
+{
+	LOG_DEBUG("Raster worker #{} enter", index);
+	TextRasterizer rasterizer;
+
+	while (true)
+	{
+		std::shared_ptr<RasterJob> job;
+		{
+			std::unique_lock<std::mutex> lock(m_jobsMutex);
+			m_jobsCondition.wait(lock, [this] { return m_stopping || m_jobs.empty() == false; });
+			if (m_stopping) break;
+			job = m_jobs.front();
+			m_jobs.pop_front();
+		}
+
+		//nobody waits for this job anymore, field was changed again or deleted
+		if (job.use_count() == 1) continue;
+
+		try
+		{
+			job->result = rasterizer.Render(job->key);
+		}
+		catch (std::exception& e)
+		{
+			LOG_ERROR("Exception in raster worker #{0} with message: {1}", index, e.what());
+			job->result = nullptr;
+		}
+		job->done.store(true);
+	}
+	LOG_DEBUG("Raster worker #{} exit", index);
+}
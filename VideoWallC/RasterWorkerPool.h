@@ -0,0 +1,36 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "TextCache.h"
+
+struct RasterJob
+{
+	TextCacheKey key;
+	std::shared_ptr<RenderedText> result;
+	std::atomic_bool done;
+};
+
+//renders field text on worker threads, results are picked up by fields on render thread
+class RasterWorkerPool
+{
+public:
+	RasterWorkerPool(size_t threadCount);
+	~RasterWorkerPool();
+
+	std::shared_ptr<RasterJob> Submit(const TextCacheKey& key);
+	size_t GetThreadCount() const;
+
+private:
+	void WorkerFunction(size_t index);
+
+	std::vector<std::thread> m_workers;
+	std::deque<std::shared_ptr<RasterJob>> m_jobs;
+	std::mutex m_jobsMutex;
+	std::condition_variable m_jobsCondition;
+	bool m_stopping;
+};
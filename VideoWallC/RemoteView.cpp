@@ -0,0 +1,291 @@
+#include "RemoteView.h"
+#include "Metrics.h"
+#include "Log.h"
+#include <algorithm>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace asio = boost::asio;
+using asio::ip::tcp;
+
+static const char STREAM_MAGIC[4] = { 'V', 'W', 'T', 'D' };
+static const size_t MESSAGE_HEADER_SIZE = 28;
+static const unsigned int MIN_TILE_SIZE = 8;
+static const unsigned int MAX_TILE_SIZE = 256;
+//client that can't take this much is dropped, it reconnects and gets keyframe
+static const size_t MAX_QUEUED_BYTES = 32 * 1024 * 1024;
+static const size_t MAX_PACK_COUNT = 128;
+
+static const uint64_t HASH_PRIME1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t HASH_PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+
+struct RemoteView::Connection
+{
+	tcp::socket socket;
+	std::deque<Message> queue;
+	size_t queuedBytes;
+	bool waitingKeyframe;
+	bool closed;
+	char readBuffer[64];
+
+	Connection(asio::io_service& io) : socket(io), queue(), queuedBytes(0), waitingKeyframe(true), closed(false) {}
+};
+
+template<typename T>
+static void Append(std::string& message, T value)
+{
+	message.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static void Put(std::string& message, size_t offset, T value)
+{
+	memcpy(&message[offset], &value, sizeof(T));
+}
+
+//murmur3 finalizer
+static inline uint64_t Mix(uint64_t value)
+{
+	value ^= value >> 33;
+	value *= 0xFF51AFD7ED558CCDULL;
+	value ^= value >> 33;
+	value *= 0xC4CEB9FE1A85EC53ULL;
+	value ^= value >> 33;
+	return value;
+}
+
+//two 64 bit lanes take 16 bytes per step like xxHash3 accumulators. Key changes every step,
+//so content moved inside tile, like running text, changes hash too
+static uint64_t HashTile(const sf::Uint8* pixels, size_t stride, unsigned int width, unsigned int height)
+{
+	__m128i accumulator = _mm_set_epi64x((long long)HASH_PRIME1, (long long)HASH_PRIME2);
+	__m128i key = _mm_set_epi32(0x7C01812C, (int)0xF721AD1C, (int)0xDED46DE9, (int)0x839097DB);
+	const __m128i keyStep = _mm_set1_epi32((int)0x9E3779B1);
+	const unsigned int blocks = width / 4;
+	uint64_t tail = 0;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		const sf::Uint8* row = pixels + y * stride;
+		for (unsigned int i = 0; i < blocks; i++)
+		{
+			__m128i data = _mm_loadu_si128((const __m128i*)(row + i * 16));
+			__m128i keyed = _mm_xor_si128(data, key);
+			__m128i product = _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 32));
+			accumulator = _mm_add_epi64(accumulator, _mm_add_epi64(product, _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2))));
+			key = _mm_add_epi32(key, keyStep);
+		}
+		//pixels of cut tile that don't fill 16 bytes
+		for (unsigned int x = blocks * 4; x < width; x++)
+		{
+			uint32_t pixel;
+			memcpy(&pixel, row + x * 4, 4);
+			tail = (tail ^ pixel) * HASH_PRIME1 + y;
+		}
+	}
+	uint64_t lanes[2];
+	_mm_storeu_si128((__m128i*)lanes, accumulator);
+	return Mix(lanes[0] ^ Mix(lanes[1] + HASH_PRIME2) ^ tail);
+}
+
+static inline void AppendRGB(std::string& message, uint32_t pixel)
+{
+	message.push_back(char(pixel & 0xFF));
+	message.push_back(char((pixel >> 8) & 0xFF));
+	message.push_back(char((pixel >> 16) & 0xFF));
+}
+
+//RGB of tile, runs of equal pixels packed, format is in header
+static void PackTile(const sf::Uint8* pixels, size_t stride, unsigned int width, unsigned int height, std::vector<uint32_t>& tileBuffer, std::string& message)
+{
+	//tile pixels in a row without alpha, runs go on to next tile row
+	const size_t count = size_t(width) * height;
+	tileBuffer.resize(count);
+	uint32_t* tile = tileBuffer.data();
+	for (unsigned int y = 0; y < height; y++)
+	{
+		memcpy(tile + y * width, pixels + y * stride, width * 4);
+		for (unsigned int x = 0; x < width; x++) tile[y * width + x] &= 0x00FFFFFF;
+	}
+
+	size_t i = 0;
+	while (i < count)
+	{
+		size_t run = 1;
+		while (i + run < count && run < MAX_PACK_COUNT && tile[i + run] == tile[i]) run++;
+		if (run > 1)
+		{
+			message.push_back(char(127 + run));
+			AppendRGB(message, tile[i]);
+			i += run;
+			continue;
+		}
+		//literal pixels until the next run
+		size_t start = i;
+		while (i < count && i - start < MAX_PACK_COUNT && (i + 1 >= count || tile[i + 1] != tile[i])) i++;
+		message.push_back(char(i - start - 1));
+		for (size_t j = start; j < i; j++) AppendRGB(message, tile[j]);
+	}
+}
+
+RemoteView::RemoteView(const std::string & address, unsigned short port, unsigned int width, unsigned int height,
+	unsigned int tileSize, unsigned int keyframeSeconds) :
+	m_width(width),
+	m_height(height),
+	m_tileSize(std::min(std::max(tileSize, MIN_TILE_SIZE), MAX_TILE_SIZE)),
+	m_tileColumns((width + m_tileSize - 1) / m_tileSize),
+	m_tileRows((height + m_tileSize - 1) / m_tileSize),
+	m_keyframeInterval(keyframeSeconds),
+	m_tileHashes(m_tileColumns * m_tileRows, 0),
+	m_lastKeyframe(),
+	m_tileBuffer(),
+	m_clientCount(0),
+	m_keyframeRequested(false),
+	m_io(),
+	m_acceptor(m_io, tcp::endpoint(asio::ip::address::from_string(address), port)),
+	m_connections(),
+	m_thread()
+{
+	StartAccept();
+	std::thread t([this] { m_io.run(); });
+	m_thread.swap(t);
+	LOG_INFO("Remote view listening on {0}:{1}, {2}x{3} tiles of {4} pixels", address, port, m_tileColumns, m_tileRows, m_tileSize);
+}
+
+RemoteView::~RemoteView()
+{
+	m_io.stop();
+	if (m_thread.joinable()) m_thread.join();
+	m_connections.clear();
+}
+
+void RemoteView::EncodeFrame(const sf::Uint8 * pixels, uint64_t sequence)
+{
+	//hashes are not kept while nobody watches, first client asks for keyframe anyway
+	if (m_clientCount.load() == 0) return;
+
+	bool keyframe = m_keyframeRequested.exchange(false);
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (m_keyframeInterval.count() != 0 && now - m_lastKeyframe >= m_keyframeInterval) keyframe = true;
+	if (keyframe) m_lastKeyframe = now;
+
+	std::shared_ptr<std::string> message = std::make_shared<std::string>(MESSAGE_HEADER_SIZE, '\0');
+	const size_t stride = size_t(m_width) * 4;
+	uint32_t tileCount = 0;
+	for (unsigned int row = 0; row < m_tileRows; row++)
+	{
+		const unsigned int top = row * m_tileSize;
+		const unsigned int tileHeight = std::min(m_tileSize, m_height - top);
+		for (unsigned int column = 0; column < m_tileColumns; column++)
+		{
+			const unsigned int left = column * m_tileSize;
+			const unsigned int tileWidth = std::min(m_tileSize, m_width - left);
+			const sf::Uint8* tilePixels = pixels + top * stride + left * 4;
+			const uint32_t index = row * m_tileColumns + column;
+			uint64_t hash = HashTile(tilePixels, stride, tileWidth, tileHeight);
+			if (keyframe == false && hash == m_tileHashes[index]) continue;
+			m_tileHashes[index] = hash;
+
+			Append<uint32_t>(*message, index);
+			const size_t sizeOffset = message->size();
+			Append<uint32_t>(*message, 0);
+			PackTile(tilePixels, stride, tileWidth, tileHeight, m_tileBuffer, *message);
+			Put<uint32_t>(*message, sizeOffset, uint32_t(message->size() - sizeOffset - 4));
+			tileCount++;
+		}
+	}
+	//nothing changed, nothing sent
+	if (tileCount == 0) return;
+
+	memcpy(&(*message)[0], STREAM_MAGIC, sizeof(STREAM_MAGIC));
+	Put<uint32_t>(*message, 4, uint32_t(message->size() - 8));
+	Put<uint64_t>(*message, 8, sequence);
+	Put<uint16_t>(*message, 16, uint16_t(m_width));
+	Put<uint16_t>(*message, 18, uint16_t(m_height));
+	Put<uint16_t>(*message, 20, uint16_t(m_tileSize));
+	Put<uint8_t>(*message, 22, keyframe ? 1 : 0);
+	Put<uint32_t>(*message, 24, tileCount);
+	Message sent = message;
+	m_io.post([this, sent, keyframe] { Broadcast(sent, keyframe); });
+}
+
+void RemoteView::StartAccept()
+{
+	std::shared_ptr<Connection> connection = std::make_shared<Connection>(m_io);
+	m_acceptor.async_accept(connection->socket, [this, connection](const boost::system::error_code& error) { OnAccept(connection, error); });
+}
+
+void RemoteView::OnAccept(std::shared_ptr<Connection> connection, const boost::system::error_code & error)
+{
+	if (error == asio::error::operation_aborted) return;
+	if (!error)
+	{
+		boost::system::error_code ignored;
+		connection->socket.set_option(tcp::no_delay(true), ignored);
+		LOG_INFO("Remote view client connected from {}", connection->socket.remote_endpoint(ignored).address().to_string());
+		m_connections.push_back(connection);
+		m_keyframeRequested.store(true);
+		m_clientCount++;
+		StartRead(connection);
+	}
+	else LOG_WARN("Remote view accept failed: {}", error.message());
+	StartAccept();
+}
+
+void RemoteView::StartRead(std::shared_ptr<Connection> connection)
+{
+	//clients send nothing, reading only finds out when they leave
+	connection->socket.async_read_some(asio::buffer(connection->readBuffer),
+		[this, connection](const boost::system::error_code& error, size_t)
+	{
+		if (error) CloseConnection(connection);
+		else StartRead(connection);
+	});
+}
+
+void RemoteView::Broadcast(Message message, bool keyframe)
+{
+	//copy, slow clients are removed on the way
+	std::vector<std::shared_ptr<Connection>> connections(m_connections);
+	for (const std::shared_ptr<Connection>& connection : connections)
+	{
+		if (connection->waitingKeyframe && keyframe == false) continue;
+		connection->waitingKeyframe = false;
+		if (connection->queuedBytes + message->size() > MAX_QUEUED_BYTES)
+		{
+			LOG_WARN("Remote view client is too slow, {} bytes queued, disconnected", connection->queuedBytes);
+			CloseConnection(connection);
+			continue;
+		}
+		connection->queue.push_back(message);
+		connection->queuedBytes += message->size();
+		if (connection->queue.size() == 1) StartWrite(connection);
+	}
+}
+
+void RemoteView::StartWrite(std::shared_ptr<Connection> connection)
+{
+	asio::async_write(connection->socket, asio::buffer(*connection->queue.front()),
+		[this, connection](const boost::system::error_code& error, size_t written)
+	{
+		if (error)
+		{
+			CloseConnection(connection);
+			return;
+		}
+		Metrics::Add(Metrics::RemoteViewBytes, written);
+		connection->queuedBytes -= connection->queue.front()->size();
+		connection->queue.pop_front();
+		if (connection->queue.empty() == false) StartWrite(connection);
+	});
+}
+
+void RemoteView::CloseConnection(std::shared_ptr<Connection> connection)
+{
+	if (connection->closed) return;
+	connection->closed = true;
+	boost::system::error_code ignored;
+	connection->socket.close(ignored);
+	m_connections.erase(std::remove(m_connections.begin(), m_connections.end(), connection), m_connections.end());
+	m_clientCount--;
+	LOG_INFO("Remote view client disconnected, {} left", m_connections.size());
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include <SFML/Graphics.hpp>
+
+//remote view of the board for operators. Frame is split into tiles, only tiles with changed hash are sent,
+//so static board costs nothing and running text costs its line. Every client gets keyframe with all tiles
+//on connect and all clients get one every keyframe interval. Nothing is encoded while nobody is connected.
+//Stream of TCP messages, numbers little endian:
+//	"VWTD", uint32 size of the rest, uint64 frame sequence, uint16 width, height, tile size,
+//	uint8 1 for keyframe, uint8 0, uint32 tile count, then tiles:
+//	uint32 tile index (row by row), uint32 data size, data is RGB pixels of tile top row first packed by bytes:
+//	0-127 is N+1 literal pixels following, 128-255 is N-127 times the one following pixel.
+//Tiles in last column and row are cut by frame size
+class RemoteView
+{
+public:
+	//throws boost::system::system_error if address can't be listened on
+	RemoteView(const std::string& address, unsigned short port, unsigned int width, unsigned int height,
+		unsigned int tileSize, unsigned int keyframeSeconds);
+	~RemoteView();
+
+	//export thread, pixels RGBA top row first
+	void EncodeFrame(const sf::Uint8* pixels, uint64_t sequence);
+
+private:
+	struct Connection;
+	typedef std::shared_ptr<const std::string> Message;
+
+	void StartAccept();
+	void OnAccept(std::shared_ptr<Connection> connection, const boost::system::error_code& error);
+	void StartRead(std::shared_ptr<Connection> connection);
+	void Broadcast(Message message, bool keyframe);
+	void StartWrite(std::shared_ptr<Connection> connection);
+	void CloseConnection(std::shared_ptr<Connection> connection);
+
+	const unsigned int m_width;
+	const unsigned int m_height;
+	const unsigned int m_tileSize;
+	const unsigned int m_tileColumns;
+	const unsigned int m_tileRows;
+	const std::chrono::seconds m_keyframeInterval;
+
+	//export thread
+	std::vector<uint64_t> m_tileHashes;
+	std::chrono::steady_clock::time_point m_lastKeyframe;
+	std::vector<uint32_t> m_tileBuffer;
+
+	std::atomic<unsigned int> m_clientCount;
+	std::atomic<bool> m_keyframeRequested;
+
+	boost::asio::io_service m_io;
+	boost::asio::ip::tcp::acceptor m_acceptor;
+	std::vector<std::shared_ptr<Connection>> m_connections;  //io thread
+	std::thread m_thread;
+};
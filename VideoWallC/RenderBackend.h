@@ -0,0 +1,29 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include "Bitmap.h"
+
+class FrameExport;
+
+//target for drawing fields, window (OpenGL) or memory framebuffer (CPU)
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend() {}
+
+	//called on render thread before bitmap is drawn first time
+	virtual void PrepareBitmap(Bitmap& bitmap) = 0;
+
+	virtual void Clear(const sf::Color& color) = 0;
+	//source rectangle wraps around for repeated bitmaps
+	virtual void DrawBitmap(const Bitmap& bitmap, const sf::IntRect& source, const sf::Vector2f& position) = 0;
+	virtual void DrawBitmapScaled(const Bitmap& bitmap, const sf::FloatRect& destination) = 0;
+	//finishes draw calls of the frame, bitmaps are not read after it returns. Display calls it if it was not called
+	virtual void Flush() {}
+	//shows frame and waits for frame limit, bitmaps are not read
+	virtual void Display() = 0;
+
+	virtual sf::Vector2u GetSize() const = 0;
+
+	//shown frames are given to export after Display, nullptr stops it. Backends not able to read frames ignore it
+	virtual void SetFrameExport(FrameExport* frameExport) {}
+};
@@ -0,0 +1,222 @@
+#include "SceneSnapshot.h"
+#include "Log.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/crc.hpp>
+
+namespace bip = boost::interprocess;
+
+static const char SNAPSHOT_MAGIC[8] = { 'V', 'W', 'S', 'C', 'E', 'N', 'E', 0 };
+static const uint32_t SNAPSHOT_VERSION = 2;
+static const size_t RECORD_COMMAND_SIZE = 1012;  //text command with attributes and long running text
+//disk write of dirty pages, off the packet path
+static const std::chrono::seconds FLUSH_INTERVAL(2);
+
+struct SceneSnapshot::Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t recordCount;
+	uint32_t reserved;
+	int64_t updated;
+};
+
+struct SceneSnapshot::Record
+{
+	//0 - empty or being written, 1 - command is complete if checksum matches
+	uint32_t state;
+	uint32_t length;
+	uint32_t checksum;
+	char command[RECORD_COMMAND_SIZE];
+};
+
+//pages of mapped file reach disk in any order, so state alone does not prove command is whole after power loss
+static uint32_t RecordChecksum(uint32_t length, const char* command)
+{
+	boost::crc_32_type crc;
+	crc.process_bytes(&length, sizeof(length));
+	crc.process_bytes(command, length);
+	return crc.checksum();
+}
+
+static bool PrepareFile(const std::string& fileName, size_t fileSize)
+{
+	std::fstream file(fileName, std::ios::in | std::ios::out | std::ios::binary);
+	if (file.is_open())
+	{
+		file.seekg(0, std::ios::end);
+		if ((size_t)file.tellg() == fileSize) return true;
+		file.close();
+	}
+
+	//new file or layout is changed, old content is useless
+	LOG_INFO("Creating scene snapshot file {0}, {1} bytes", fileName, fileSize);
+	file.open(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (file.is_open() == false) return false;
+	file.seekp(fileSize - 1);
+	file.put(0);
+	return file.good();
+}
+
+SceneSnapshot::SceneSnapshot() :
+	m_mapping(),
+	m_region(),
+	m_header(nullptr),
+	m_records(nullptr),
+	m_recordCount(0),
+	m_overflowLogged(false),
+	m_dirty(false),
+	m_flushMutex(),
+	m_flushCondition(),
+	m_stopping(false),
+	m_flushThread()
+{
+}
+
+SceneSnapshot::~SceneSnapshot()
+{
+	{
+		std::lock_guard<std::mutex> mut(m_flushMutex);
+		m_stopping = true;
+	}
+	m_flushCondition.notify_all();
+	if (m_flushThread.joinable()) m_flushThread.join();
+	if (m_region != nullptr) m_region->flush();
+}
+
+bool SceneSnapshot::Open(const std::string & fileName, size_t maxFields)
+{
+	size_t fileSize = sizeof(Header) + maxFields * sizeof(Record);
+	if (PrepareFile(fileName, fileSize) == false)
+	{
+		LOG_ERROR("Failed to create scene snapshot file {}", fileName);
+		return false;
+	}
+
+	try
+	{
+		m_mapping.reset(new bip::file_mapping(fileName.c_str(), bip::read_write));
+		m_region.reset(new bip::mapped_region(*m_mapping, bip::read_write, 0, fileSize));
+	}
+	catch (bip::interprocess_exception& e)
+	{
+		LOG_ERROR("Failed to map scene snapshot file {0}: {1}", fileName, e.what());
+		m_region.reset();
+		m_mapping.reset();
+		return false;
+	}
+
+	m_header = static_cast<Header*>(m_region->get_address());
+	m_records = reinterpret_cast<Record*>(m_header + 1);
+	m_recordCount = maxFields;
+
+	if (std::memcmp(m_header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+		m_header->version != SNAPSHOT_VERSION ||
+		m_header->recordSize != sizeof(Record) ||
+		m_header->recordCount != maxFields)
+	{
+		LOG_INFO("Scene snapshot file {} has no valid scene, initializing", fileName);
+		std::memset(m_region->get_address(), 0, fileSize);
+		std::memcpy(m_header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+		m_header->version = SNAPSHOT_VERSION;
+		m_header->recordSize = sizeof(Record);
+		m_header->recordCount = (uint32_t)maxFields;
+	}
+
+	if (m_flushThread.joinable() == false)
+	{
+		std::thread t(&SceneSnapshot::flushThreadFunction, this);
+		m_flushThread.swap(t);
+	}
+	return true;
+}
+
+bool SceneSnapshot::IsOpen() const
+{
+	return m_header != nullptr;
+}
+
+std::vector<std::string> SceneSnapshot::TakeCommands(std::time_t & updated)
+{
+	std::vector<std::string> commands;
+	updated = 0;
+	if (IsOpen() == false) return commands;
+
+	updated = (std::time_t)m_header->updated;
+	size_t damaged = 0;
+	for (size_t i = 0; i < m_recordCount; i++)
+	{
+		const Record& record = m_records[i];
+		if (record.state != 1) continue;
+		if (record.length > RECORD_COMMAND_SIZE || record.checksum != RecordChecksum(record.length, record.command))
+		{
+			damaged++;
+			continue;
+		}
+		commands.emplace_back(record.command, record.length);
+	}
+	if (damaged != 0) LOG_WARN("Scene snapshot has {} damaged records, their fields are not restored", damaged);
+	ClearAll();
+	return commands;
+}
+
+void SceneSnapshot::SetField(uint32_t slot, const std::string & command)
+{
+	if (IsOpen() == false) return;
+	if (slot >= m_recordCount)
+	{
+		if (m_overflowLogged == false) LOG_ERROR("Scene snapshot is full, {} fields are saved", m_recordCount);
+		m_overflowLogged = true;
+		return;
+	}
+
+	Record& record = m_records[slot];
+	record.state = 0;
+	if (command.size() > RECORD_COMMAND_SIZE)
+	{
+		LOG_ERROR("Command of field #{0} is {1} bytes, too long for scene snapshot", slot, command.size());
+		return;
+	}
+	//crash of the program in the middle leaves record empty, power loss leaves checksum not matching
+	record.length = (uint32_t)command.size();
+	std::memcpy(record.command, command.data(), command.size());
+	record.checksum = RecordChecksum(record.length, record.command);
+	record.state = 1;
+}
+
+void SceneSnapshot::ClearField(uint32_t slot)
+{
+	if (IsOpen() == false || slot >= m_recordCount) return;
+	m_records[slot].state = 0;
+}
+
+void SceneSnapshot::ClearAll()
+{
+	if (IsOpen() == false) return;
+	for (size_t i = 0; i < m_recordCount; i++) m_records[i].state = 0;
+}
+
+void SceneSnapshot::Commit(std::time_t updated)
+{
+	if (IsOpen() == false) return;
+	m_header->updated = (int64_t)updated;
+	m_dirty.store(true);
+}
+
+void SceneSnapshot::flushThreadFunction()
+{
+	LOG_DEBUG("Scene snapshot flush thread enter");
+	std::unique_lock<std::mutex> lock(m_flushMutex);
+	while (m_flushCondition.wait_for(lock, FLUSH_INTERVAL, [this] { return m_stopping; }) == false)
+	{
+		if (m_dirty.exchange(false) == false) continue;
+		lock.unlock();
+		if (m_region->flush(0, 0, true) == false) LOG_WARN("Failed to flush scene snapshot to disk");
+		lock.lock();
+	}
+	LOG_DEBUG("Scene snapshot flush thread exit");
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace boost { namespace interprocess { class file_mapping; class mapped_region; } }
+
+//last command of every field kept in a memory mapped file, survives restart and crash of the program
+//record index is field slot, so every applied command rewrites only its own record. Pages reach disk
+//from background thread every few seconds, records torn by power loss fail checksum and are not restored
+class SceneSnapshot
+{
+public:
+	SceneSnapshot();
+	~SceneSnapshot();
+
+	//maps file, creating or resizing it when needed. false if file can't be used
+	bool Open(const std::string& fileName, size_t maxFields);
+	bool IsOpen() const;
+
+	//commands of all stored fields and time of the last commit, records are cleared
+	std::vector<std::string> TakeCommands(std::time_t& updated);
+
+	void SetField(uint32_t slot, const std::string& command);
+	void ClearField(uint32_t slot);
+	void ClearAll();
+	//marks time of the last applied packet, pages are written to disk by flush thread
+	void Commit(std::time_t updated);
+
+private:
+	struct Header;
+	struct Record;
+
+	void flushThreadFunction();
+
+	std::unique_ptr<boost::interprocess::file_mapping> m_mapping;
+	std::unique_ptr<boost::interprocess::mapped_region> m_region;
+	Header* m_header;
+	Record* m_records;
+	size_t m_recordCount;
+	bool m_overflowLogged;
+
+	std::atomic<bool> m_dirty;
+	std::mutex m_flushMutex;
+	std::condition_variable m_flushCondition;
+	bool m_stopping;
+	std::thread m_flushThread;
+};
@@ -0,0 +1,265 @@
+#include "SoftwareRenderBackend.h"
+#include "Log.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+//rows composited by one task, small enough to spread a 720p frame over many cores
+static const int BAND_HEIGHT = 32;
+
+static inline int WrapCoordinate(int value, int size)
+{
+	value %= size;
+	return (value < 0) ? value + size : value;
+}
+
+SoftwareRenderBackend::SoftwareRenderBackend(unsigned int width, unsigned int height, unsigned int frameLimit, unsigned int compositeThreads) :
+	m_kernels(BlendKernels::Get()),
+	m_compositePool(compositeThreads),
+	m_commands(),
+	m_bandCommands((height + BAND_HEIGHT - 1) / BAND_HEIGHT),
+	m_framebuffer(size_t(width) * height * 4, 0),
+	m_exportFramebuffer(),
+	m_frameExport(nullptr),
+	m_lastFrameExported(false),
+	m_width(width),
+	m_height(height),
+	m_frameDuration(std::chrono::steady_clock::duration::zero()),
+	m_nextFrame(std::chrono::steady_clock::now()),
+	m_frameCount(0)
+{
+	if (frameLimit != 0) m_frameDuration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds(1)) / frameLimit;
+	LOG_DEBUG("Software render backend created with size={0}x{1}, frame limit={2}, composite threads={3}", width, height, frameLimit, m_compositePool.GetThreadCount());
+}
+
+SoftwareRenderBackend::~SoftwareRenderBackend()
+{
+	SetFrameExport(nullptr);
+}
+
+void SoftwareRenderBackend::PrepareBitmap(Bitmap & bitmap)
+{
+	//pixels are used directly
+}
+
+void SoftwareRenderBackend::Clear(const sf::Color & color)
+{
+	//everything before is covered
+	m_commands.clear();
+	m_commands.push_back(DrawCommand::Clear(color));
+}
+
+void SoftwareRenderBackend::DrawBitmap(const Bitmap & bitmap, const sf::IntRect & source, const sf::Vector2f & position)
+{
+	if (bitmap.pixels.empty() || source.width <= 0 || source.height <= 0) return;
+	m_commands.push_back(DrawCommand::Draw(bitmap, source, position));
+}
+
+void SoftwareRenderBackend::DrawBitmapScaled(const Bitmap & bitmap, const sf::FloatRect & destination)
+{
+	if (bitmap.pixels.empty() || destination.width <= 0 || destination.height <= 0) return;
+	m_commands.push_back(DrawCommand::DrawScaledTo(bitmap, destination));
+}
+
+void SoftwareRenderBackend::Flush()
+{
+	if (m_commands.empty()) return;
+
+	//binning by bounds, band worker looks only at commands that reach its rows
+	for (std::vector<uint32_t>& band : m_bandCommands) band.clear();
+	for (size_t i = 0; i < m_commands.size(); i++)
+	{
+		int first, last;
+		GetCommandRows(m_commands[i], first, last);
+		if (first >= last) continue;
+		for (int band = first / BAND_HEIGHT; band <= (last - 1) / BAND_HEIGHT; band++) m_bandCommands[band].push_back((uint32_t)i);
+	}
+
+	m_compositePool.Run(m_bandCommands.size(), [this](size_t band)
+	{
+		const int y1 = (int)band * BAND_HEIGHT;
+		const int y2 = std::min(y1 + BAND_HEIGHT, (int)m_height);
+		for (uint32_t index : m_bandCommands[band])
+		{
+			const DrawCommand& command = m_commands[index];
+			switch (command.type)
+			{
+			case DrawCommand::ClearColor:
+				ClearRows(command.color, y1, y2);
+				break;
+			case DrawCommand::DrawSource:
+				BlendBitmap(*command.bitmap, command.source, sf::Vector2f(command.destination.left, command.destination.top), y1, y2);
+				break;
+			case DrawCommand::DrawScaled:
+				BlendBitmapScaled(*command.bitmap, command.destination, y1, y2);
+				break;
+			}
+		}
+	});
+	m_commands.clear();
+}
+
+void SoftwareRenderBackend::GetCommandRows(const DrawCommand & command, int & first, int & last) const
+{
+	switch (command.type)
+	{
+	case DrawCommand::ClearColor:
+		first = 0;
+		last = (int)m_height;
+		break;
+	case DrawCommand::DrawSource:
+		first = (int)std::round(command.destination.top);
+		last = first + command.source.height;
+		break;
+	case DrawCommand::DrawScaled:
+		first = (int)std::ceil(command.destination.top - 0.5f);
+		last = (int)std::ceil(command.destination.top + command.destination.height - 0.5f);
+		break;
+	}
+	first = std::max(first, 0);
+	last = std::min(last, (int)m_height);
+}
+
+void SoftwareRenderBackend::ClearRows(const sf::Color & color, int y1, int y2)
+{
+	m_kernels.FillRow(&m_framebuffer[size_t(y1) * m_width * 4], color, int(m_width * (y2 - y1)));
+}
+
+void SoftwareRenderBackend::BlendBitmap(const Bitmap & bitmap, const sf::IntRect & source, const sf::Vector2f & position, int bandY1, int bandY2)
+{
+	int dstX = (int)std::round(position.x);
+	int dstY = (int)std::round(position.y);
+	int x1 = std::max(dstX, 0);
+	int x2 = std::min(dstX + source.width, (int)m_width);
+	int y1 = std::max(dstY, bandY1);
+	int y2 = std::min(dstY + source.height, bandY2);
+	const int bitmapWidth = (int)bitmap.width;
+	const int bitmapHeight = (int)bitmap.height;
+
+	for (int y = y1; y < y2; y++)
+	{
+		int srcY = source.top + (y - dstY);
+		if (bitmap.repeated) srcY = WrapCoordinate(srcY, bitmapHeight);
+		else if (srcY < 0 || srcY >= bitmapHeight) continue;
+
+		const sf::Uint8* srcLine = &bitmap.pixels[size_t(srcY) * bitmapWidth * 4];
+		sf::Uint8* dstLine = &m_framebuffer[size_t(y) * m_width * 4];
+
+		if (bitmap.repeated)
+		{
+			//same as GL_REPEAT, copying in runs up to the bitmap edge
+			int x = x1;
+			while (x < x2)
+			{
+				int srcX = WrapCoordinate(source.left + (x - dstX), bitmapWidth);
+				int count = std::min(x2 - x, bitmapWidth - srcX);
+				m_kernels.BlendRow(dstLine + x * 4, srcLine + srcX * 4, count);
+				x += count;
+			}
+		}
+		else
+		{
+			int srcX1 = source.left + (x1 - dstX);
+			int srcX2 = source.left + (x2 - dstX);
+			int skip = std::max(-srcX1, 0);
+			srcX1 += skip;
+			srcX2 = std::min(srcX2, bitmapWidth);
+			if (srcX2 > srcX1) m_kernels.BlendRow(dstLine + (x1 + skip) * 4, srcLine + srcX1 * 4, srcX2 - srcX1);
+		}
+	}
+}
+
+void SoftwareRenderBackend::BlendBitmapScaled(const Bitmap & bitmap, const sf::FloatRect & destination, int bandY1, int bandY2)
+{
+	//nearest sampling at pixel centers, like a non smooth texture
+	int x1 = std::max((int)std::ceil(destination.left - 0.5f), 0);
+	int x2 = std::min((int)std::ceil(destination.left + destination.width - 0.5f), (int)m_width);
+	int y1 = std::max((int)std::ceil(destination.top - 0.5f), bandY1);
+	int y2 = std::min((int)std::ceil(destination.top + destination.height - 0.5f), bandY2);
+	float scaleX = bitmap.width / destination.width;
+	float scaleY = bitmap.height / destination.height;
+
+	std::vector<sf::Uint8> line(size_t(std::max(x2 - x1, 0)) * 4);
+	for (int y = y1; y < y2; y++)
+	{
+		int srcY = std::min((int)((y + 0.5f - destination.top) * scaleY), (int)bitmap.height - 1);
+		const sf::Uint8* srcLine = &bitmap.pixels[size_t(srcY) * bitmap.width * 4];
+		for (int x = x1; x < x2; x++)
+		{
+			int srcX = std::min((int)((x + 0.5f - destination.left) * scaleX), (int)bitmap.width - 1);
+			std::copy(srcLine + srcX * 4, srcLine + srcX * 4 + 4, &line[size_t(x - x1) * 4]);
+		}
+		if (x2 > x1) m_kernels.BlendRow(&m_framebuffer[(size_t(y) * m_width + x1) * 4], line.data(), x2 - x1);
+	}
+}
+
+void SoftwareRenderBackend::Display()
+{
+	Flush();
+	m_frameCount++;
+
+	m_lastFrameExported = false;
+	if (m_frameExport != nullptr && m_frameExport->IsFrameDue())
+	{
+		//render thread does not wait for export of previous frame
+		if (m_frameExport->IsBusy()) m_frameExport->SkipFrame();
+		else
+		{
+			//previous exported frame is already copied, its buffer gets the next frame
+			m_framebuffer.swap(m_exportFramebuffer);
+			m_frameExport->Publish(m_exportFramebuffer.data(), false);
+			m_lastFrameExported = true;
+		}
+	}
+
+	//frame limit, same idea as sf::Window::setFramerateLimit
+	if (m_frameDuration != std::chrono::steady_clock::duration::zero())
+	{
+		auto now = std::chrono::steady_clock::now();
+		m_nextFrame += m_frameDuration;
+		if (m_nextFrame < now) m_nextFrame = now;
+		else std::this_thread::sleep_until(m_nextFrame);
+	}
+}
+
+sf::Vector2u SoftwareRenderBackend::GetSize() const
+{
+	return sf::Vector2u(m_width, m_height);
+}
+
+void SoftwareRenderBackend::SetFrameExport(FrameExport * frameExport)
+{
+	if (m_frameExport != nullptr) m_frameExport->WaitIdle();
+	if (m_lastFrameExported)
+	{
+		m_framebuffer.swap(m_exportFramebuffer);
+		m_lastFrameExported = false;
+	}
+	m_frameExport = frameExport;
+	if (m_frameExport != nullptr) m_exportFramebuffer.resize(m_framebuffer.size());
+	else std::vector<sf::Uint8>().swap(m_exportFramebuffer);
+}
+
+const std::vector<sf::Uint8>& SoftwareRenderBackend::GetFramebuffer() const
+{
+	return m_lastFrameExported ? m_exportFramebuffer : m_framebuffer;
+}
+
+uint64_t SoftwareRenderBackend::GetFrameCount() const
+{
+	return m_frameCount;
+}
+
+size_t SoftwareRenderBackend::GetCompositeThreadCount() const
+{
+	return m_compositePool.GetThreadCount();
+}
+
+bool SoftwareRenderBackend::SaveToFile(const std::string & fileName) const
+{
+	sf::Image image;
+	image.create(m_width, m_height, GetFramebuffer().data());
+	bool result = image.saveToFile(fileName);
+	if (result == false) LOG_ERROR("Failed to save framebuffer to file={}", fileName);
+	return result;
+}
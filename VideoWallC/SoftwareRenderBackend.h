@@ -0,0 +1,59 @@
+#pragma once
+#include <chrono>
+#include "RenderBackend.h"
+#include "BlendKernels.h"
+#include "DrawCommand.h"
+#include "CompositeWorkerPool.h"
+#include "FrameExport.h"
+
+//composites fields into RGBA framebuffer in memory, no OpenGL or display needed.
+//Draw calls are collected and composited in Flush, horizontal bands of frame in parallel
+class SoftwareRenderBackend : public RenderBackend
+{
+public:
+	//compositeThreads 0 is number of cores
+	SoftwareRenderBackend(unsigned int width, unsigned int height, unsigned int frameLimit, unsigned int compositeThreads);
+	~SoftwareRenderBackend();
+
+	void PrepareBitmap(Bitmap& bitmap) override;
+
+	void Clear(const sf::Color& color) override;
+	void DrawBitmap(const Bitmap& bitmap, const sf::IntRect& source, const sf::Vector2f& position) override;
+	void DrawBitmapScaled(const Bitmap& bitmap, const sf::FloatRect& destination) override;
+	//bitmaps drawn since previous frame must live until it returns
+	void Flush() override;
+	void Display() override;
+
+	sf::Vector2u GetSize() const override;
+	//exported frame is handed over by swapping framebuffers, no copy on render thread
+	void SetFrameExport(FrameExport* frameExport) override;
+
+	const std::vector<sf::Uint8>& GetFramebuffer() const;
+	uint64_t GetFrameCount() const;
+	size_t GetCompositeThreadCount() const;
+	bool SaveToFile(const std::string& fileName) const;
+
+private:
+	//rows of frame that command changes, [first, last)
+	void GetCommandRows(const DrawCommand& command, int& first, int& last) const;
+	//every function changes only rows y1 to y2 of framebuffer
+	void ClearRows(const sf::Color& color, int y1, int y2);
+	void BlendBitmap(const Bitmap& bitmap, const sf::IntRect& source, const sf::Vector2f& position, int bandY1, int bandY2);
+	void BlendBitmapScaled(const Bitmap& bitmap, const sf::FloatRect& destination, int bandY1, int bandY2);
+
+	const BlendKernels& m_kernels;
+	CompositeWorkerPool m_compositePool;
+	std::vector<DrawCommand> m_commands;
+	//indexes of commands touching every band, in draw order
+	std::vector<std::vector<uint32_t>> m_bandCommands;
+	std::vector<sf::Uint8> m_framebuffer;
+	//frame being copied by export, the last shown one when m_lastFrameExported is set
+	std::vector<sf::Uint8> m_exportFramebuffer;
+	FrameExport* m_frameExport;
+	bool m_lastFrameExported;
+	unsigned int m_width;
+	unsigned int m_height;
+	std::chrono::steady_clock::duration m_frameDuration;
+	std::chrono::steady_clock::time_point m_nextFrame;
+	uint64_t m_frameCount;
+};
@@ -0,0 +1,164 @@
+#include "Statistics.h"
+#include <algorithm>
+#include <cmath>
+
+static const int SUB_BUCKET_BITS = 7;
+static const uint64_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;  //exact values
+static const uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;  //steps per power of two above exact values
+static const int MAX_VALUE_BITS = 40;  //about 12 days in microseconds, bigger values are put in the last bucket
+static const size_t BUCKET_COUNT = SUB_BUCKET_COUNT + (MAX_VALUE_BITS - SUB_BUCKET_BITS) * SUB_BUCKET_HALF;
+
+static int HighestBit(uint64_t value)
+{
+	int bit = 0;
+	while (value >>= 1) bit++;
+	return bit;
+}
+
+Histogram::Histogram() :
+	m_counts(BUCKET_COUNT, 0),
+	m_count(0),
+	m_min(0),
+	m_max(0),
+	m_sum(0)
+{
+}
+
+void Histogram::Record(uint64_t value)
+{
+	m_counts[GetBucketIndex(value)]++;
+	m_min = (m_count == 0) ? value : std::min(m_min, value);
+	m_max = std::max(m_max, value);
+	m_sum += (double)value;
+	m_count++;
+}
+
+void Histogram::Merge(const Histogram & other)
+{
+	if (other.m_count == 0) return;
+	for (size_t i = 0; i < BUCKET_COUNT; i++) m_counts[i] += other.m_counts[i];
+	m_min = (m_count == 0) ? other.m_min : std::min(m_min, other.m_min);
+	m_max = std::max(m_max, other.m_max);
+	m_sum += other.m_sum;
+	m_count += other.m_count;
+}
+
+void Histogram::Reset()
+{
+	std::fill(m_counts.begin(), m_counts.end(), 0);
+	m_count = 0;
+	m_min = 0;
+	m_max = 0;
+	m_sum = 0;
+}
+
+uint64_t Histogram::GetCount() const
+{
+	return m_count;
+}
+
+uint64_t Histogram::GetMin() const
+{
+	return m_min;
+}
+
+uint64_t Histogram::GetMax() const
+{
+	return m_max;
+}
+
+double Histogram::GetMean() const
+{
+	return (m_count == 0) ? 0.0 : m_sum / m_count;
+}
+
+uint64_t Histogram::GetPercentile(double percentile) const
+{
+	if (m_count == 0) return 0;
+	percentile = std::min(std::max(percentile, 0.0), 100.0);
+	uint64_t target = std::max((uint64_t)std::ceil(m_count * percentile / 100.0), (uint64_t)1);
+
+	uint64_t total = 0;
+	for (size_t i = 0; i < BUCKET_COUNT; i++)
+	{
+		total += m_counts[i];
+		if (total >= target) return std::min(std::max(GetBucketHighestValue(i), m_min), m_max);
+	}
+	return m_max;
+}
+
+size_t Histogram::GetBucketIndex(uint64_t value)
+{
+	if (value < SUB_BUCKET_COUNT) return (size_t)value;
+
+	int shift = HighestBit(value) - (SUB_BUCKET_BITS - 1);
+	if (shift > MAX_VALUE_BITS - SUB_BUCKET_BITS) return BUCKET_COUNT - 1;
+	return (size_t)(SUB_BUCKET_COUNT + (shift - 1) * SUB_BUCKET_HALF + ((value >> shift) - SUB_BUCKET_HALF));
+}
+
+uint64_t Histogram::GetBucketHighestValue(size_t index)
+{
+	if (index < SUB_BUCKET_COUNT) return index;
+
+	uint64_t shift = (index - SUB_BUCKET_COUNT) / SUB_BUCKET_HALF + 1;
+	uint64_t step = (index - SUB_BUCKET_COUNT) % SUB_BUCKET_HALF + SUB_BUCKET_HALF;
+	return ((step + 1) << shift) - 1;
+}
+
+RunningStatistics::RunningStatistics() :
+	m_count(0),
+	m_mean(0),
+	m_m2(0),
+	m_min(0),
+	m_max(0)
+{
+}
+
+void RunningStatistics::Record(double value)
+{
+	m_count++;
+	double delta = value - m_mean;
+	m_mean += delta / m_count;
+	m_m2 += delta * (value - m_mean);
+	m_min = (m_count == 1) ? value : std::min(m_min, value);
+	m_max = (m_count == 1) ? value : std::max(m_max, value);
+}
+
+void RunningStatistics::Reset()
+{
+	m_count = 0;
+	m_mean = 0;
+	m_m2 = 0;
+	m_min = 0;
+	m_max = 0;
+}
+
+uint64_t RunningStatistics::GetCount() const
+{
+	return m_count;
+}
+
+double RunningStatistics::GetMean() const
+{
+	return m_mean;
+}
+
+double RunningStatistics::GetVariance() const
+{
+	return (m_count < 2) ? 0.0 : m_m2 / (m_count - 1);
+}
+
+double RunningStatistics::GetStandardDeviation() const
+{
+	return std::sqrt(GetVariance());
+}
+
+double RunningStatistics::GetMin() const
+{
+	return m_min;
+}
+
+double RunningStatistics::GetMax() const
+{
+	return m_max;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//log-linear histogram of integer values in the HdrHistogram manner
+//values below 128 are exact, bigger values are kept with 64 steps per power of two (1.5% precision)
+class Histogram
+{
+public:
+	Histogram();
+
+	void Record(uint64_t value);
+	void Merge(const Histogram& other);
+	void Reset();
+
+	uint64_t GetCount() const;
+	uint64_t GetMin() const;
+	uint64_t GetMax() const;
+	double GetMean() const;
+	//percentile in 0..100, returns highest value of bucket it falls into, but not more than max
+	uint64_t GetPercentile(double percentile) const;
+
+private:
+	static size_t GetBucketIndex(uint64_t value);
+	static uint64_t GetBucketHighestValue(size_t index);
+
+	std::vector<uint64_t> m_counts;
+	uint64_t m_count;
+	uint64_t m_min;
+	uint64_t m_max;
+	double m_sum;
+};
+
+//count, mean, variance without storing values (Welford)
+class RunningStatistics
+{
+public:
+	RunningStatistics();
+
+	void Record(double value);
+	void Reset();
+
+	uint64_t GetCount() const;
+	double GetMean() const;
+	double GetVariance() const;
+	double GetStandardDeviation() const;
+	double GetMin() const;
+	double GetMax() const;
+
+private:
+	uint64_t m_count;
+	double m_mean;
+	double m_m2;
+	double m_min;
+	double m_max;
+};
@@ -0,0 +1,140 @@
+#include "TextCache.h"
+#include "Log.h"
+#include <boost/functional/hash.hpp>
+
+bool TextCacheKey::operator==(const TextCacheKey& other) const
+{
+	return textSize == other.textSize &&
+		textStyle == other.textStyle &&
+		textColor == other.textColor &&
+		bgColor == other.bgColor &&
+		width == other.width &&
+		height == other.height &&
+		displayType == other.displayType &&
+		text == other.text &&
+		fontName == other.fontName;
+}
+
+size_t TextCacheKeyHash::operator()(const TextCacheKey& key) const
+{
+	size_t seed = boost::hash_range(key.text.begin(), key.text.end());
+	boost::hash_combine(seed, key.fontName);
+	boost::hash_combine(seed, key.textSize);
+	boost::hash_combine(seed, key.textStyle);
+	boost::hash_combine(seed, key.textColor);
+	boost::hash_combine(seed, key.bgColor);
+	boost::hash_combine(seed, key.width);
+	boost::hash_combine(seed, key.height);
+	boost::hash_combine(seed, key.displayType);
+	return seed;
+}
+
+size_t RenderedText::GetMemorySize() const
+{
+	return sizeof(RenderedText) + Bitmap::GetMemorySize();
+}
+
+TextCache::TextCache(size_t memoryLimit) :
+	m_lruList(),
+	m_lookup(),
+	m_memoryLimit(memoryLimit),
+	m_memoryUsed(0),
+	m_hits(0),
+	m_misses(0),
+	m_insertions(0),
+	m_evictions(0)
+{
+	LOG_DEBUG("Text cache created with memory limit={}", m_memoryLimit);
+}
+
+TextCache::~TextCache()
+{
+	LogStatistics();
+	Clear();
+}
+
+std::shared_ptr<const RenderedText> TextCache::Find(const TextCacheKey & key)
+{
+	std::lock_guard<std::mutex> mut(m_cacheMutex);
+	auto found = m_lookup.find(key);
+	if (found == m_lookup.end())
+	{
+		m_misses++;
+		return nullptr;
+	}
+
+	//moving entry to the front of LRU list
+	m_lruList.splice(m_lruList.begin(), m_lruList, found->second);
+	m_hits++;
+	return found->second->second;
+}
+
+void TextCache::Insert(const TextCacheKey & key, std::shared_ptr<const RenderedText> value)
+{
+	if (value == nullptr) return;
+	size_t valueSize = value->GetMemorySize();
+
+	std::lock_guard<std::mutex> mut(m_cacheMutex);
+	//bitmaps bigger than the whole cache are not stored, field keeps its own copy
+	if (valueSize > m_memoryLimit) return;
+
+	auto found = m_lookup.find(key);
+	if (found != m_lookup.end())
+	{
+		m_memoryUsed -= found->second->second->GetMemorySize();
+		found->second->second = value;
+		m_lruList.splice(m_lruList.begin(), m_lruList, found->second);
+	}
+	else
+	{
+		m_lruList.emplace_front(key, value);
+		m_lookup[key] = m_lruList.begin();
+	}
+	m_memoryUsed += valueSize;
+	m_insertions++;
+
+	EvictToLimit();
+}
+
+void TextCache::Clear()
+{
+	std::lock_guard<std::mutex> mut(m_cacheMutex);
+	m_lookup.clear();
+	m_lruList.clear();
+	m_memoryUsed = 0;
+}
+
+TextCache::Statistics TextCache::GetStatistics()
+{
+	std::lock_guard<std::mutex> mut(m_cacheMutex);
+	Statistics stats;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.insertions = m_insertions;
+	stats.evictions = m_evictions;
+	stats.entries = m_lookup.size();
+	stats.memoryUsed = m_memoryUsed;
+	stats.memoryLimit = m_memoryLimit;
+	return stats;
+}
+
+void TextCache::LogStatistics()
+{
+	Statistics stats = GetStatistics();
+	uint64_t lookups = stats.hits + stats.misses;
+	double hitRate = (lookups == 0) ? 0.0 : 100.0 * stats.hits / lookups;
+	LOG_INFO("Text cache statistics: hits={0}, misses={1}, hit rate={2:.1f}%, insertions={3}, evictions={4}, entries={5}, memory={6}/{7} bytes",
+		stats.hits, stats.misses, hitRate, stats.insertions, stats.evictions, stats.entries, stats.memoryUsed, stats.memoryLimit);
+}
+
+void TextCache::EvictToLimit()
+{
+	while (m_memoryUsed > m_memoryLimit && m_lruList.empty() == false)
+	{
+		CacheEntry& last = m_lruList.back();
+		m_memoryUsed -= last.second->GetMemorySize();
+		m_lookup.erase(last.first);
+		m_lruList.pop_back();
+		m_evictions++;
+	}
+}
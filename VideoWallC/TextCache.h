@@ -0,0 +1,78 @@
+#pragma once
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <SFML/Graphics.hpp>
+#include "Bitmap.h"
+
+//everything that changes pixels of rendered field text
+struct TextCacheKey
+{
+	std::basic_string<sf::Uint32> text;
+	std::string fontName;
+	uint32_t textSize;
+	uint32_t textStyle;
+	uint32_t textColor;
+	uint32_t bgColor;
+	uint32_t width;
+	uint32_t height;
+	uint32_t displayType;
+
+	bool operator==(const TextCacheKey& other) const;
+};
+
+struct TextCacheKeyHash
+{
+	size_t operator()(const TextCacheKey& key) const;
+};
+
+struct RenderedText : public Bitmap
+{
+	float textWidth;
+	bool running;
+
+	size_t GetMemorySize() const;
+};
+
+class TextCache
+{
+public:
+	struct Statistics
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t insertions;
+		uint64_t evictions;
+		size_t entries;
+		size_t memoryUsed;
+		size_t memoryLimit;
+	};
+
+	TextCache(size_t memoryLimit);
+	~TextCache();
+
+	std::shared_ptr<const RenderedText> Find(const TextCacheKey& key);
+	void Insert(const TextCacheKey& key, std::shared_ptr<const RenderedText> value);
+	void Clear();
+
+	Statistics GetStatistics();
+	void LogStatistics();
+
+private:
+	typedef std::pair<TextCacheKey, std::shared_ptr<const RenderedText>> CacheEntry;
+	typedef std::list<CacheEntry> CacheList;
+
+	void EvictToLimit();
+
+	CacheList m_lruList;
+	std::unordered_map<TextCacheKey, CacheList::iterator, TextCacheKeyHash> m_lookup;
+	std::mutex m_cacheMutex;
+
+	size_t m_memoryLimit;
+	size_t m_memoryUsed;
+	uint64_t m_hits;
+	uint64_t m_misses;
+	uint64_t m_insertions;
+	uint64_t m_evictions;
+};
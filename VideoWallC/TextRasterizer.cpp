@@ -0,0 +1,386 @@
+#include "TextRasterizer.h"
+#include "LDPField.h"
+#include "Log.h"
+#include <algorithm>
+#include <cmath>
+#include FT_OUTLINE_H
+
+static const float ITALIC_SHEAR = 0.209f;  //12 degrees, same as sf::Text
+
+TextRasterizer::TextRasterizer() :
+	m_kernels(BlendKernels::Get()),
+	m_library(nullptr),
+	m_faces(),
+	m_glyphs(),
+	m_glyphsFace(nullptr),
+	m_glyphsFontName(),
+	m_glyphsSize(0),
+	m_glyphsRendered(0)
+{
+	if (FT_Init_FreeType(&m_library) != 0)
+	{
+		LOG_ERROR("Failed to initialize FreeType library");
+		m_library = nullptr;
+	}
+}
+
+TextRasterizer::~TextRasterizer()
+{
+	m_glyphs.clear();
+	for (auto& face : m_faces)
+	{
+		if (face.second != nullptr) FT_Done_Face(face.second);
+	}
+	if (m_library != nullptr) FT_Done_FreeType(m_library);
+}
+
+std::shared_ptr<RenderedText> TextRasterizer::Render(const TextCacheKey & key)
+{
+	std::shared_ptr<RenderedText> rendered = std::make_shared<RenderedText>();
+	rendered->textWidth = 0;
+	rendered->running = false;
+	rendered->width = std::max(key.width, 1u);
+	rendered->height = std::max(key.height, 1u);
+
+	sf::Color textColor(key.textColor);
+	sf::Color bgColor(key.bgColor);
+
+	FT_Face face = SelectFace(key.fontName, key.textSize);
+
+	TextLayout layout;
+	float posX = 0;
+	float posY = 0;
+	if (face != nullptr)
+	{
+		//calculating lower bounds
+		const sf::Uint32 boundsText[] = { 'H', 'x', 'j' };
+		LayoutText(face, std::basic_string<sf::Uint32>(boundsText, 3), key.textSize, key.textStyle, layout);
+		posY = key.height - (layout.bounds.top + layout.bounds.height);
+
+		LayoutText(face, key.text, key.textSize, key.textStyle, layout);
+
+		//looking for aligment
+		switch (key.displayType)
+		{
+		default:
+		case LDPField::DisplayType::LeftAlign:
+			break;
+		case LDPField::DisplayType::RightAlign:
+			posX = key.width - layout.bounds.width - 4;
+			break;
+		case LDPField::DisplayType::CenterAlign:
+			posX = key.width / 2.f - layout.bounds.width / 2;
+			break;
+		case LDPField::DisplayType::OptionalLeft:
+			if (layout.bounds.width > key.width) rendered->running = true;
+			break;
+		case LDPField::DisplayType::Running:
+			rendered->running = true;
+			break;
+		}
+
+		if (rendered->running == true)
+		{
+			std::basic_string<sf::Uint32> tempString = key.text;
+			tempString.append(3, ' ');
+			LayoutText(face, tempString, key.textSize, key.textStyle, layout);
+			rendered->textWidth = layout.bounds.width + layout.bounds.left;
+			rendered->width = std::max((unsigned int)layout.bounds.width, 1u);
+		}
+		rendered->repeated = rendered->running;
+	}
+
+	rendered->pixels.resize(size_t(rendered->width) * rendered->height * 4);
+	m_kernels.FillRow(rendered->pixels.data(), bgColor, int(rendered->width * rendered->height));
+
+	if (face != nullptr) DrawLayout(layout, posX, posY, key.textStyle, textColor, *rendered);
+
+	return rendered;
+}
+
+size_t TextRasterizer::Prewarm(const std::string & fontName, uint32_t size, const std::vector<sf::Uint32>& codePoints)
+{
+	FT_Face face = SelectFace(fontName, size);
+	if (face == nullptr) return 0;
+
+	size_t renderedBefore = m_glyphsRendered;
+	for (sf::Uint32 codePoint : codePoints) GetGlyph(face, codePoint, sf::Text::Style::Regular);
+	return m_glyphsRendered - renderedBefore;
+}
+
+bool TextRasterizer::CheckFont(const std::string & fontName)
+{
+	static std::mutex checkMutex;
+	static std::map<std::string, bool> checkedFonts;
+
+	std::lock_guard<std::mutex> mut(checkMutex);
+	auto found = checkedFonts.find(fontName);
+	if (found != checkedFonts.end()) return found->second;
+
+	TextRasterizer rasterizer;
+	bool result = (rasterizer.GetFace(fontName) != nullptr);
+	checkedFonts[fontName] = result;
+	return result;
+}
+
+FT_Face TextRasterizer::GetFace(const std::string & fontName)
+{
+	auto found = m_faces.find(fontName);
+	if (found != m_faces.end()) return found->second;
+
+	FT_Face face = nullptr;
+	if (m_library == nullptr || FT_New_Face(m_library, fontName.c_str(), 0, &face) != 0)
+	{
+		LOG_ERROR("Failed to load font face from file={}", fontName);
+		face = nullptr;
+	}
+	else if (FT_Select_Charmap(face, FT_ENCODING_UNICODE) != 0)
+	{
+		LOG_ERROR("Font={} has no unicode character map", fontName);
+		FT_Done_Face(face);
+		face = nullptr;
+	}
+
+	m_faces[fontName] = face;
+	return face;
+}
+
+FT_Face TextRasterizer::SelectFace(const std::string & fontName, uint32_t size)
+{
+	FT_Face face = GetFace(fontName);
+	if (face == nullptr || FT_Set_Pixel_Sizes(face, 0, size) != 0)
+	{
+		LOG_ERROR("Can't render text with font={0}, size={1}", fontName, size);
+		return nullptr;
+	}
+	if (face != m_glyphsFace || size != m_glyphsSize)
+	{
+		m_glyphs.clear();
+		m_glyphsFace = face;
+		m_glyphsFontName = fontName;
+		m_glyphsSize = size;
+	}
+	return face;
+}
+
+const GlyphBitmap & TextRasterizer::GetGlyph(FT_Face face, sf::Uint32 codePoint, uint32_t style)
+{
+	bool bold = (style & sf::Text::Style::Bold) != 0;
+	auto key = std::make_pair(codePoint, (uint32_t)bold);
+	auto found = m_glyphs.find(key);
+	if (found != m_glyphs.end()) return *found->second;
+
+	//other thread or pre-warm may have it already
+	GlyphKey sharedKey = { m_glyphsFontName, m_glyphsSize, codePoint, bold };
+	std::shared_ptr<const GlyphBitmap> shared = GlyphCache::Get().Find(sharedKey);
+	if (shared != nullptr)
+	{
+		m_glyphs[key] = shared;
+		return *shared;
+	}
+
+	std::shared_ptr<GlyphBitmap> rendered = std::make_shared<GlyphBitmap>();
+	RenderGlyph(face, codePoint, bold, *rendered);
+	m_glyphsRendered++;
+	GlyphCache::Get().Insert(sharedKey, rendered);
+	m_glyphs[key] = rendered;
+	return *rendered;
+}
+
+void TextRasterizer::RenderGlyph(FT_Face face, sf::Uint32 codePoint, bool bold, GlyphBitmap & glyph)
+{
+	glyph.left = 0;
+	glyph.top = 0;
+	glyph.width = 0;
+	glyph.height = 0;
+	glyph.advance = 0;
+
+	//same load flags as sf::Font
+	FT_UInt index = FT_Get_Char_Index(face, codePoint);
+	if (FT_Load_Glyph(face, index, FT_LOAD_TARGET_NORMAL | FT_LOAD_FORCE_AUTOHINT) != 0) return;
+
+	const FT_Pos weight = 1 << 6;
+	if (bold && face->glyph->format == FT_GLYPH_FORMAT_OUTLINE) FT_Outline_Embolden(&face->glyph->outline, weight);
+	if (FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL) != 0) return;
+
+	const FT_Bitmap& bitmap = face->glyph->bitmap;
+	glyph.advance = static_cast<float>(face->glyph->metrics.horiAdvance) / static_cast<float>(1 << 6);
+	if (bold) glyph.advance += static_cast<float>(weight) / static_cast<float>(1 << 6);
+	glyph.left = face->glyph->bitmap_left;
+	glyph.top = -face->glyph->bitmap_top;
+	glyph.width = bitmap.width;
+	glyph.height = bitmap.rows;
+
+	glyph.coverage.resize(size_t(glyph.width) * glyph.height);
+	const unsigned char* source = bitmap.buffer;
+	for (int y = 0; y < glyph.height; y++)
+	{
+		for (int x = 0; x < glyph.width; x++)
+		{
+			sf::Uint8 value;
+			if (bitmap.pixel_mode == FT_PIXEL_MODE_MONO) value = ((source[x / 8]) & (1 << (7 - (x % 8)))) ? 255 : 0;
+			else value = source[x];
+			glyph.coverage[y * glyph.width + x] = value;
+		}
+		source += bitmap.pitch;
+	}
+}
+
+float TextRasterizer::GetKerning(FT_Face face, sf::Uint32 first, sf::Uint32 second)
+{
+	if (first == 0 || second == 0 || FT_HAS_KERNING(face) == 0) return 0;
+
+	FT_Vector kerning;
+	FT_Get_Kerning(face, FT_Get_Char_Index(face, first), FT_Get_Char_Index(face, second), FT_KERNING_UNFITTED, &kerning);
+	return static_cast<float>(kerning.x) / static_cast<float>(1 << 6);
+}
+
+void TextRasterizer::LayoutText(FT_Face face, const std::basic_string<sf::Uint32>& text, uint32_t size, uint32_t style, TextLayout & layout)
+{
+	layout.glyphs.clear();
+	layout.lines.clear();
+	layout.lineBaselines.clear();
+	layout.bounds = sf::FloatRect();
+	layout.underlineOffset = 0;
+	layout.underlineThickness = 0;
+	layout.strikeThroughOffset = 0;
+
+	if (text.empty()) return;
+
+	float italicShear = (style & sf::Text::Style::Italic) ? ITALIC_SHEAR : 0.f;
+	float whitespaceWidth = GetGlyph(face, ' ', style).advance;
+	float lineSpacing = static_cast<float>(face->size->metrics.height) / static_cast<float>(1 << 6);
+	if (FT_IS_SCALABLE(face))
+	{
+		layout.underlineOffset = -static_cast<float>(FT_MulFix(face->underline_position, face->size->metrics.y_scale)) / static_cast<float>(1 << 6);
+		layout.underlineThickness = static_cast<float>(FT_MulFix(face->underline_thickness, face->size->metrics.y_scale)) / static_cast<float>(1 << 6);
+	}
+	const GlyphBitmap& xGlyph = GetGlyph(face, 'x', style);
+	layout.strikeThroughOffset = xGlyph.top + xGlyph.height / 2.f;
+
+	float x = 0;
+	float y = static_cast<float>(size);
+	float minX = static_cast<float>(size);
+	float minY = static_cast<float>(size);
+	float maxX = 0;
+	float maxY = 0;
+	sf::Uint32 prevChar = 0;
+
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		sf::Uint32 curChar = text[i];
+		if (curChar == '\r') continue;
+
+		x += GetKerning(face, prevChar, curChar);
+		prevChar = curChar;
+
+		if (curChar == ' ' || curChar == '\n' || curChar == '\t')
+		{
+			minX = std::min(minX, x);
+			minY = std::min(minY, y);
+
+			switch (curChar)
+			{
+			case ' ': x += whitespaceWidth; break;
+			case '\t': x += whitespaceWidth * 4; break;
+			case '\n':
+				layout.lines.push_back(sf::Vector2f(0, x));
+				layout.lineBaselines.push_back(y);
+				y += lineSpacing;
+				x = 0;
+				break;
+			}
+
+			maxX = std::max(maxX, x);
+			maxY = std::max(maxY, y);
+			continue;
+		}
+
+		const GlyphBitmap& glyph = GetGlyph(face, curChar, style);
+		float left = static_cast<float>(glyph.left);
+		float top = static_cast<float>(glyph.top);
+		float right = left + glyph.width;
+		float bottom = top + glyph.height;
+
+		minX = std::min(minX, x + left - italicShear * bottom);
+		maxX = std::max(maxX, x + right - italicShear * top);
+		minY = std::min(minY, y + top);
+		maxY = std::max(maxY, y + bottom);
+
+		PlacedGlyph placed;
+		placed.bitmap = &glyph;
+		placed.x = x;
+		placed.y = y;
+		layout.glyphs.push_back(placed);
+
+		x += glyph.advance;
+	}
+	if (x > 0)
+	{
+		layout.lines.push_back(sf::Vector2f(0, x));
+		layout.lineBaselines.push_back(y);
+	}
+
+	layout.bounds.left = minX;
+	layout.bounds.top = minY;
+	layout.bounds.width = maxX - minX;
+	layout.bounds.height = maxY - minY;
+}
+
+void TextRasterizer::DrawLayout(const TextLayout & layout, float x, float y, uint32_t style, sf::Color color, RenderedText & target)
+{
+	const int targetWidth = (int)target.width;
+	const int targetHeight = (int)target.height;
+	bool italic = (style & sf::Text::Style::Italic) != 0;
+
+	for (const PlacedGlyph& placed : layout.glyphs)
+	{
+		const GlyphBitmap& glyph = *placed.bitmap;
+		int originX = (int)std::round(x + placed.x) + glyph.left;
+		int originY = (int)std::round(y + placed.y) + glyph.top;
+
+		for (int row = 0; row < glyph.height; row++)
+		{
+			int targetY = originY + row;
+			if (targetY < 0 || targetY >= targetHeight) continue;
+			int shear = italic ? (int)std::round(-ITALIC_SHEAR * (glyph.top + row)) : 0;
+
+			//clipping glyph row to target width
+			int rowX = originX + shear;
+			int colStart = std::max(-rowX, 0);
+			int colEnd = std::min(glyph.width, targetWidth - rowX);
+			if (colEnd <= colStart) continue;
+
+			const sf::Uint8* coverage = &glyph.coverage[size_t(row) * glyph.width];
+			sf::Uint8* line = &target.pixels[size_t(targetY) * targetWidth * 4];
+			m_kernels.BlendCoverageRow(line + (rowX + colStart) * 4, coverage + colStart, color, colEnd - colStart);
+		}
+	}
+
+	for (size_t i = 0; i < layout.lines.size(); i++)
+	{
+		float left = x + layout.lines[i].x;
+		float right = x + layout.lines[i].y;
+		float baseline = y + layout.lineBaselines[i];
+		if (style & sf::Text::Style::Underlined)
+			DrawHorizontalLine(left, right, baseline + layout.underlineOffset, layout.underlineThickness, color, target);
+		if (style & sf::Text::Style::StrikeThrough)
+			DrawHorizontalLine(left, right, baseline + layout.strikeThroughOffset, layout.underlineThickness, color, target);
+	}
+}
+
+void TextRasterizer::DrawHorizontalLine(float left, float right, float y, float thickness, sf::Color color, RenderedText & target)
+{
+	int top = (int)std::round(y - thickness / 2);
+	int bottom = std::max((int)std::round(y + thickness / 2), top + 1);
+	int x1 = std::max((int)std::round(left), 0);
+	int x2 = std::min((int)std::round(right), (int)target.width);
+	if (x2 <= x1) return;
+
+	const std::vector<sf::Uint8> coverage(x2 - x1, 255);
+	for (int row = std::max(top, 0); row < std::min(bottom, (int)target.height); row++)
+	{
+		sf::Uint8* line = &target.pixels[size_t(row) * target.width * 4];
+		m_kernels.BlendCoverageRow(line + x1 * 4, coverage.data(), color, x2 - x1);
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <vector>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include "TextCache.h"
+#include "BlendKernels.h"
+#include "GlyphCache.h"
+
+//CPU text renderer on top of FreeType, reproduces sf::Text layout
+//one instance per thread, FreeType faces are not thread safe
+class TextRasterizer
+{
+public:
+	TextRasterizer();
+	~TextRasterizer();
+
+	std::shared_ptr<RenderedText> Render(const TextCacheKey& key);
+	//renders glyphs into shared GlyphCache ahead of the first text that needs them, returns number of new glyphs
+	size_t Prewarm(const std::string& fontName, uint32_t size, const std::vector<sf::Uint32>& codePoints);
+
+	static bool CheckFont(const std::string& fontName);
+
+private:
+	struct PlacedGlyph
+	{
+		const GlyphBitmap* bitmap;
+		float x;
+		float y;
+	};
+
+	struct TextLayout
+	{
+		std::vector<PlacedGlyph> glyphs;
+		sf::FloatRect bounds;
+		float underlineOffset;
+		float underlineThickness;
+		float strikeThroughOffset;
+		std::vector<sf::Vector2f> lines;  //start and end x of every line, y is in lineBaselines
+		std::vector<float> lineBaselines;
+	};
+
+	FT_Face GetFace(const std::string& fontName);
+	//face with pixel size set, nullptr if font can't be used
+	FT_Face SelectFace(const std::string& fontName, uint32_t size);
+	const GlyphBitmap& GetGlyph(FT_Face face, sf::Uint32 codePoint, uint32_t style);
+	void RenderGlyph(FT_Face face, sf::Uint32 codePoint, bool bold, GlyphBitmap& glyph);
+	float GetKerning(FT_Face face, sf::Uint32 first, sf::Uint32 second);
+	void LayoutText(FT_Face face, const std::basic_string<sf::Uint32>& text, uint32_t size, uint32_t style, TextLayout& layout);
+	void DrawLayout(const TextLayout& layout, float x, float y, uint32_t style, sf::Color color, RenderedText& target);
+	void DrawHorizontalLine(float left, float right, float y, float thickness, sf::Color color, RenderedText& target);
+
+	const BlendKernels& m_kernels;
+	FT_Library m_library;
+	std::map<std::string, FT_Face> m_faces;
+	//glyphs of the current face and size taken from GlyphCache, valid until they change
+	std::map<std::pair<sf::Uint32, uint32_t>, std::shared_ptr<const GlyphBitmap>> m_glyphs;
+	FT_Face m_glyphsFace;
+	std::string m_glyphsFontName;
+	uint32_t m_glyphsSize;
+	size_t m_glyphsRendered;
+};
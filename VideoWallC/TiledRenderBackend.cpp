@@ -0,0 +1,251 @@
+#include "TiledRenderBackend.h"
+#include "WindowRenderBackend.h"
+#include "Log.h"
+#include "Metrics.h"
+#include <Windows.h>
+
+TiledRenderBackend::TiledRenderBackend(unsigned int width, unsigned int height, unsigned int columns, unsigned int rows,
+	bool software, const sf::Vector2i& windowOrigin, unsigned int frameLimit) :
+	m_tiles(),
+	m_commands(),
+	m_width(width),
+	m_height(height),
+	m_drawFrame(0),
+	m_presentFrame(0),
+	m_flushed(false),
+	m_tilesPending(0),
+	m_stopping(false)
+{
+	if (columns == 0) columns = 1;
+	if (rows == 0) rows = 1;
+
+	for (unsigned int row = 0; row < rows; row++)
+	{
+		for (unsigned int column = 0; column < columns; column++)
+		{
+			std::unique_ptr<Tile> tile(new Tile());
+			//last column and row take remainder of canvas
+			int left = (int)(width * column / columns);
+			int top = (int)(height * row / rows);
+			int right = (int)(width * (column + 1) / columns);
+			int bottom = (int)(height * (row + 1) / rows);
+			tile->area = sf::IntRect(left, top, right - left, bottom - top);
+			tile->softwareBackend = nullptr;
+			tile->windowBackend = nullptr;
+
+			if (software)
+			{
+				//tiles already run in parallel, one thread composites each of them
+				tile->softwareBackend = new SoftwareRenderBackend(tile->area.width, tile->area.height, frameLimit, 1);
+				tile->backend.reset(tile->softwareBackend);
+			}
+			else
+			{
+				tile->window.reset(new sf::RenderWindow(sf::VideoMode(tile->area.width, tile->area.height), "VideoWall", sf::Style::None));
+				tile->window->setPosition(windowOrigin + sf::Vector2i(left, top));
+				tile->window->setMouseCursorVisible(false);
+				if (frameLimit == 60)
+				{
+					tile->window->setVerticalSyncEnabled(true);
+					tile->window->setFramerateLimit(0);
+				}
+				else
+				{
+					tile->window->setVerticalSyncEnabled(false);
+					tile->window->setFramerateLimit(frameLimit);
+				}
+				//context becomes active on tile thread
+				tile->window->setActive(false);
+				tile->windowBackend = new WindowRenderBackend(*tile->window);
+				tile->backend.reset(tile->windowBackend);
+			}
+			m_tiles.push_back(std::move(tile));
+		}
+	}
+
+	for (size_t i = 0; i < m_tiles.size(); i++)
+	{
+		m_tiles[i]->thread = std::thread(&TiledRenderBackend::TileThreadFunction, this, m_tiles[i].get(), i);
+	}
+	LOG_INFO("Tiled render backend created with canvas={0}x{1}, tiles={2}x{3}, software={4}", width, height, columns, rows, software);
+}
+
+TiledRenderBackend::~TiledRenderBackend()
+{
+	LOG_TRACE("Tiled render backend destructor enter");
+	{
+		std::lock_guard<std::mutex> mut(m_phaseMutex);
+		m_stopping = true;
+	}
+	m_phaseCondition.notify_all();
+	for (size_t i = 0; i < m_tiles.size(); i++)
+	{
+		m_tiles[i]->thread.join();
+	}
+	for (size_t i = 0; i < m_tiles.size(); i++)
+	{
+		if (m_tiles[i]->window != nullptr) m_tiles[i]->window->close();
+	}
+	LOG_TRACE("Tiled render backend destructor exit");
+}
+
+void TiledRenderBackend::PrepareBitmap(Bitmap & bitmap)
+{
+	//all tiles are of the same kind and windows share textures, so first tile decides.
+	//Software tiles use pixels directly, only window tiles upload
+	Tile& first = *m_tiles[0];
+	if (first.windowBackend != nullptr) Metrics::Add(Metrics::TextureUploadBytes, first.windowBackend->UploadBitmap(bitmap));
+	else first.backend->PrepareBitmap(bitmap);
+}
+
+void TiledRenderBackend::Clear(const sf::Color & color)
+{
+	m_commands.push_back(DrawCommand::Clear(color));
+}
+
+void TiledRenderBackend::DrawBitmap(const Bitmap & bitmap, const sf::IntRect & source, const sf::Vector2f & position)
+{
+	m_commands.push_back(DrawCommand::Draw(bitmap, source, position));
+}
+
+void TiledRenderBackend::DrawBitmapScaled(const Bitmap & bitmap, const sf::FloatRect & destination)
+{
+	m_commands.push_back(DrawCommand::DrawScaledTo(bitmap, destination));
+}
+
+void TiledRenderBackend::Flush()
+{
+	if (m_flushed) return;
+	RunPhase(m_drawFrame);
+	m_commands.clear();
+	m_flushed = true;
+}
+
+void TiledRenderBackend::Display()
+{
+	//all tiles finish drawing before any of them presents, so outputs show the same frame
+	Flush();
+	RunPhase(m_presentFrame);
+	m_flushed = false;
+}
+
+sf::Vector2u TiledRenderBackend::GetSize() const
+{
+	return sf::Vector2u(m_width, m_height);
+}
+
+bool TiledRenderBackend::PollEvent(sf::Event & event)
+{
+	for (size_t i = 0; i < m_tiles.size(); i++)
+	{
+		if (m_tiles[i]->window != nullptr && m_tiles[i]->window->pollEvent(event)) return true;
+	}
+	return false;
+}
+
+void TiledRenderBackend::BringToForeground()
+{
+	for (size_t i = 0; i < m_tiles.size(); i++)
+	{
+		if (m_tiles[i]->window == nullptr) continue;
+		sf::WindowHandle hndl = m_tiles[i]->window->getSystemHandle();
+		SetWindowPos(hndl, HWND_TOPMOST, 0, 0, 0, 0, SWP_SHOWWINDOW | SWP_NOMOVE | SWP_NOSIZE);
+		SetForegroundWindow(hndl);
+		SetActiveWindow(hndl);
+		RedrawWindow(hndl, NULL, NULL, RDW_FRAME | RDW_INVALIDATE | RDW_ALLCHILDREN);
+	}
+}
+
+bool TiledRenderBackend::SaveToFiles(const std::string & fileName) const
+{
+	bool result = true;
+	size_t extension = fileName.find_last_of('.');
+	if (extension == std::string::npos) extension = fileName.size();
+	for (size_t i = 0; i < m_tiles.size(); i++)
+	{
+		const Tile& tile = *m_tiles[i];
+		if (tile.softwareBackend == nullptr) continue;
+		std::string tileName = fileName;
+		tileName.insert(extension, "_" + std::to_string(tile.area.left) + "_" + std::to_string(tile.area.top));
+		if (tile.softwareBackend->SaveToFile(tileName) == false) result = false;
+	}
+	return result;
+}
+
+size_t TiledRenderBackend::GetTileCount() const
+{
+	return m_tiles.size();
+}
+
+void TiledRenderBackend::TileThreadFunction(Tile* tile, size_t index)
+{
+	LOG_DEBUG("Tile #{0} thread enter, area={1},{2} {3}x{4}", index, tile->area.left, tile->area.top, tile->area.width, tile->area.height);
+	if (tile->window != nullptr) tile->window->setActive(true);
+
+	uint64_t drawFrame = 0;
+	uint64_t presentFrame = 0;
+	std::unique_lock<std::mutex> lock(m_phaseMutex);
+	while (true)
+	{
+		m_phaseCondition.wait(lock, [&] { return m_stopping || m_drawFrame != drawFrame; });
+		if (m_stopping) break;
+		drawFrame = m_drawFrame;
+		lock.unlock();
+		try
+		{
+			Replay(*tile);
+			tile->backend->Flush();
+		}
+		catch (std::exception& e)
+		{
+			LOG_ERROR("Exception while drawing tile #{0}: {1}", index, e.what());
+		}
+		lock.lock();
+		if (--m_tilesPending == 0) m_doneCondition.notify_one();
+
+		m_phaseCondition.wait(lock, [&] { return m_stopping || m_presentFrame != presentFrame; });
+		if (m_stopping) break;
+		presentFrame = m_presentFrame;
+		lock.unlock();
+		tile->backend->Display();
+		lock.lock();
+		if (--m_tilesPending == 0) m_doneCondition.notify_one();
+	}
+	lock.unlock();
+
+	if (tile->window != nullptr) tile->window->setActive(false);
+	LOG_DEBUG("Tile #{} thread exit", index);
+}
+
+void TiledRenderBackend::Replay(Tile & tile) const
+{
+	const sf::FloatRect area(tile.area);
+	const sf::Vector2f offset((float)tile.area.left, (float)tile.area.top);
+	for (const DrawCommand& command : m_commands)
+	{
+		switch (command.type)
+		{
+		case DrawCommand::ClearColor:
+			tile.backend->Clear(command.color);
+			break;
+		case DrawCommand::DrawSource:
+			if (area.intersects(command.destination) == false) break;
+			tile.backend->DrawBitmap(*command.bitmap, command.source, sf::Vector2f(command.destination.left, command.destination.top) - offset);
+			break;
+		case DrawCommand::DrawScaled:
+			if (area.intersects(command.destination) == false) break;
+			tile.backend->DrawBitmapScaled(*command.bitmap, sf::FloatRect(command.destination.left - offset.x, command.destination.top - offset.y,
+				command.destination.width, command.destination.height));
+			break;
+		}
+	}
+}
+
+void TiledRenderBackend::RunPhase(uint64_t & phaseCounter)
+{
+	std::unique_lock<std::mutex> lock(m_phaseMutex);
+	m_tilesPending = m_tiles.size();
+	phaseCounter++;
+	m_phaseCondition.notify_all();
+	m_doneCondition.wait(lock, [this] { return m_tilesPending == 0; });
+}
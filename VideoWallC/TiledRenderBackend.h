@@ -0,0 +1,70 @@
+#pragma once
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "RenderBackend.h"
+#include "DrawCommand.h"
+#include "SoftwareRenderBackend.h"
+
+class WindowRenderBackend;
+
+//virtual canvas split into grid of tiles, each tile is own window (output) or framebuffer drawn by own thread.
+//Draw calls are recorded on render thread, Flush replays them on all tiles and Display presents tiles together
+class TiledRenderBackend : public RenderBackend
+{
+public:
+	//windows are placed side by side starting at windowOrigin, frameLimit is the same as TargetFPS setting
+	TiledRenderBackend(unsigned int width, unsigned int height, unsigned int columns, unsigned int rows,
+		bool software, const sf::Vector2i& windowOrigin, unsigned int frameLimit);
+	~TiledRenderBackend();
+
+	void PrepareBitmap(Bitmap& bitmap) override;
+
+	void Clear(const sf::Color& color) override;
+	void DrawBitmap(const Bitmap& bitmap, const sf::IntRect& source, const sf::Vector2f& position) override;
+	void DrawBitmapScaled(const Bitmap& bitmap, const sf::FloatRect& destination) override;
+	//bitmaps drawn since previous frame must live until it returns
+	void Flush() override;
+	void Display() override;
+
+	sf::Vector2u GetSize() const override;
+
+	//events of all tile windows, on thread that created backend
+	bool PollEvent(sf::Event& event);
+	void BringToForeground();
+	//software tiles, one file per tile with column and row added to name
+	bool SaveToFiles(const std::string& fileName) const;
+	size_t GetTileCount() const;
+
+private:
+	struct Tile
+	{
+		sf::IntRect area;
+		std::unique_ptr<sf::RenderWindow> window;
+		std::unique_ptr<RenderBackend> backend;
+		SoftwareRenderBackend* softwareBackend;
+		WindowRenderBackend* windowBackend;
+		std::thread thread;
+	};
+
+	void TileThreadFunction(Tile* tile, size_t index);
+	void Replay(Tile& tile) const;
+	//hands next phase to tile threads and waits until all of them are done with it
+	void RunPhase(uint64_t& phaseCounter);
+
+	std::vector<std::unique_ptr<Tile>> m_tiles;
+	std::vector<DrawCommand> m_commands;
+	unsigned int m_width;
+	unsigned int m_height;
+
+	std::mutex m_phaseMutex;
+	std::condition_variable m_phaseCondition;
+	std::condition_variable m_doneCondition;
+	uint64_t m_drawFrame;
+	uint64_t m_presentFrame;
+	bool m_flushed;
+	size_t m_tilesPending;
+	bool m_stopping;
+};
@@ -0,0 +1,178 @@
+#include "TimerWheel.h"
+#include <algorithm>
+
+static const sf::Int64 TICK_MICRO = 1000;
+
+TimerWheel::TimerWheel() :
+	m_timers(),
+	m_freeTimers(),
+	m_lists(LEVEL_COUNT * SLOT_COUNT, NONE),
+	m_due(),
+	m_nowMicro(0),
+	m_tick(0),
+	m_count(0)
+{
+}
+
+TimerWheel::TimerId TimerWheel::ScheduleOnce(sf::Int64 delayMicro, Callback callback)
+{
+	return Schedule(delayMicro, 0, std::move(callback));
+}
+
+TimerWheel::TimerId TimerWheel::SchedulePeriodic(sf::Int64 periodMicro, Callback callback)
+{
+	return Schedule(periodMicro, std::max(periodMicro, sf::Int64(1)), std::move(callback));
+}
+
+void TimerWheel::Cancel(TimerId id)
+{
+	uint32_t index = (uint32_t)(id & 0xFFFFFFFF);
+	if (id == 0 || index >= m_timers.size()) return;
+	Timer& timer = m_timers[index];
+	if (timer.active == false || timer.generation != (uint32_t)(id >> 32)) return;
+	Unlink(index);
+	timer.active = false;
+	timer.generation++;
+	timer.callback = nullptr;
+	m_freeTimers.push_back(index);
+	m_count--;
+}
+
+void TimerWheel::Advance(sf::Int64 elapsedMicro)
+{
+	if (elapsedMicro > 0) m_nowMicro += elapsedMicro;
+	const sf::Int64 lastTick = m_nowMicro / TICK_MICRO;
+	while (m_tick < lastTick)
+	{
+		m_tick++;
+		//timers of higher levels move down when lower level turns around, highest first
+		if ((m_tick & (SLOT_COUNT - 1)) == 0)
+		{
+			int level = 1;
+			while (level < LEVEL_COUNT - 1 && ((m_tick >> (SLOT_BITS * level)) & (SLOT_COUNT - 1)) == 0) level++;
+			for (; level >= 1; level--) Cascade(level);
+		}
+		FireSlot((uint32_t)(m_tick & (SLOT_COUNT - 1)));
+	}
+}
+
+sf::Int64 TimerWheel::GetNowMicro() const
+{
+	return m_nowMicro;
+}
+
+size_t TimerWheel::GetCount() const
+{
+	return m_count;
+}
+
+TimerWheel::TimerId TimerWheel::Schedule(sf::Int64 delayMicro, sf::Int64 periodMicro, Callback callback)
+{
+	uint32_t index;
+	if (m_freeTimers.empty())
+	{
+		index = (uint32_t)m_timers.size();
+		m_timers.push_back(Timer());
+		m_timers[index].generation = 1;
+	}
+	else
+	{
+		index = m_freeTimers.back();
+		m_freeTimers.pop_back();
+	}
+	Timer& timer = m_timers[index];
+	timer.deadlineMicro = m_nowMicro + std::max(delayMicro, sf::Int64(0));
+	timer.periodMicro = periodMicro;
+	timer.callback = std::move(callback);
+	timer.prev = NONE;
+	timer.next = NONE;
+	timer.list = NONE;
+	timer.active = true;
+	m_count++;
+	//slot of current tick is already fired
+	Insert(index, m_tick + 1);
+	return MakeId(index);
+}
+
+void TimerWheel::Insert(uint32_t index, sf::Int64 minimumTick)
+{
+	Timer& timer = m_timers[index];
+	//never early, deadline inside a tick fires at its end
+	sf::Int64 tick = std::max((timer.deadlineMicro + TICK_MICRO - 1) / TICK_MICRO, minimumTick);
+	sf::Int64 delta = tick - m_tick;
+
+	int level = 0;
+	while (level < LEVEL_COUNT - 1 && delta >= (sf::Int64(1) << (SLOT_BITS * (level + 1)))) level++;
+	if (level == LEVEL_COUNT - 1 && delta >= (sf::Int64(1) << (SLOT_BITS * LEVEL_COUNT)))
+	{
+		//beyond the wheel, parked in the farthest slot and placed again when it cascades
+		tick = m_tick + (sf::Int64(1) << (SLOT_BITS * LEVEL_COUNT)) - 1;
+	}
+	uint32_t list = level * SLOT_COUNT + (uint32_t)((tick >> (SLOT_BITS * level)) & (SLOT_COUNT - 1));
+
+	timer.list = list;
+	timer.prev = NONE;
+	timer.next = m_lists[list];
+	if (timer.next != NONE) m_timers[timer.next].prev = index;
+	m_lists[list] = index;
+}
+
+void TimerWheel::Unlink(uint32_t index)
+{
+	Timer& timer = m_timers[index];
+	if (timer.list == NONE) return;
+	if (timer.prev != NONE) m_timers[timer.prev].next = timer.next;
+	else m_lists[timer.list] = timer.next;
+	if (timer.next != NONE) m_timers[timer.next].prev = timer.prev;
+	timer.list = NONE;
+	timer.prev = NONE;
+	timer.next = NONE;
+}
+
+void TimerWheel::Cascade(int level)
+{
+	uint32_t list = level * SLOT_COUNT + (uint32_t)((m_tick >> (SLOT_BITS * level)) & (SLOT_COUNT - 1));
+	uint32_t index = m_lists[list];
+	m_lists[list] = NONE;
+	while (index != NONE)
+	{
+		uint32_t next = m_timers[index].next;
+		m_timers[index].list = NONE;
+		//may land in slot of current tick, which is fired right after cascading
+		Insert(index, m_tick);
+		index = next;
+	}
+}
+
+void TimerWheel::FireSlot(uint32_t list)
+{
+	//callbacks may schedule and cancel, so slot is taken out before any of them is called
+	m_due.clear();
+	for (uint32_t index = m_lists[list]; index != NONE; index = m_timers[index].next) m_due.push_back(MakeId(index));
+	for (TimerId id : m_due)
+	{
+		uint32_t index = (uint32_t)(id & 0xFFFFFFFF);
+		Timer& timer = m_timers[index];
+		if (timer.active == false || timer.generation != (uint32_t)(id >> 32)) continue;
+		Unlink(index);
+		if (timer.periodMicro != 0)
+		{
+			timer.deadlineMicro += timer.periodMicro;
+			Insert(index, m_tick + 1);
+			//callback may add timers and move the array
+			Callback callback = timer.callback;
+			callback();
+		}
+		else
+		{
+			Callback callback = std::move(timer.callback);
+			Cancel(id);
+			callback();
+		}
+	}
+}
+
+TimerWheel::TimerId TimerWheel::MakeId(uint32_t index) const
+{
+	return (TimerId(m_timers[index].generation) << 32) | index;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <SFML/System.hpp>
+
+//deadlines of render thread in one place. Hierarchical wheel of 1 ms ticks, so scheduling, cancelling and firing
+//do not depend on number of timers. Time is 64 bit microseconds since creation and does not wrap
+class TimerWheel
+{
+public:
+	typedef uint64_t TimerId;  //0 is never returned, cancelling it does nothing
+	typedef std::function<void()> Callback;
+
+	TimerWheel();
+
+	TimerId ScheduleOnce(sf::Int64 delayMicro, Callback callback);
+	//deadlines keep cadence of period, callback is called for every period passed, also after a stall
+	TimerId SchedulePeriodic(sf::Int64 periodMicro, Callback callback);
+	//safe from callbacks, also for timer being called
+	void Cancel(TimerId id);
+
+	//moves time forward and calls due callbacks, earlier ticks first
+	void Advance(sf::Int64 elapsedMicro);
+
+	sf::Int64 GetNowMicro() const;
+	size_t GetCount() const;
+
+private:
+	static const int SLOT_BITS = 8;
+	static const uint32_t SLOT_COUNT = 1 << SLOT_BITS;
+	static const int LEVEL_COUNT = 4;
+	static const uint32_t NONE = 0xFFFFFFFF;
+
+	struct Timer
+	{
+		sf::Int64 deadlineMicro;
+		sf::Int64 periodMicro;
+		Callback callback;
+		uint32_t generation;
+		uint32_t prev;
+		uint32_t next;
+		uint32_t list;  //level * SLOT_COUNT + slot, NONE when not in wheel
+		bool active;
+	};
+
+	TimerId Schedule(sf::Int64 delayMicro, sf::Int64 periodMicro, Callback callback);
+	//puts timer into level and slot by its deadline, not earlier than tick minimum
+	void Insert(uint32_t index, sf::Int64 minimumTick);
+	void Unlink(uint32_t index);
+	void Cascade(int level);
+	void FireSlot(uint32_t list);
+	TimerId MakeId(uint32_t index) const;
+
+	std::vector<Timer> m_timers;
+	std::vector<uint32_t> m_freeTimers;
+	std::vector<uint32_t> m_lists;  //first timer of every slot of every level
+	std::vector<TimerId> m_due;
+	sf::Int64 m_nowMicro;
+	sf::Int64 m_tick;  //last tick with fired slot
+	size_t m_count;
+};
@@ -7,6 +7,18 @@ namespace fs = boost::filesystem;
 
 #include "Log.h"
 #include "INIFile.h"
+#include "TextRasterizer.h"
+#include "WindowRenderBackend.h"
+#include "SoftwareRenderBackend.h"
+#include "TiledRenderBackend.h"
+#include "Benchmark.h"
+#include "FrameProfiler.h"
+#include "TimerWheel.h"
+#include "FlightRecorder.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
+#include "FrameExport.h"
+#include "RemoteView.h"
 
 int main(int argc, char* argv[])
 {
@@ -66,64 +78,177 @@ int main(int argc, char* argv[])
 			LOG_DEBUG("Font={}", settings.GetString(S_DEFAULTFONT));
 		}
 
+		//flight record decoding, runs instead of normal work before file of this run replaces it
+		if (settings.GetString(S_FLIGHTRECORDERDECODE).empty() == false)
+		{
+			ShowWindow(GetConsoleWindow(), SW_SHOW);
+			return FlightRecorder::Decode(settings.GetString(S_FLIGHTRECORDERDECODE), std::cout) ? 0 : 1;
+		}
+
+		//benchmark mode, runs instead of normal work
+		if (settings.GetString(S_BENCHMARKMODE).empty() == false)
+		{
+			ShowWindow(GetConsoleWindow(), SW_SHOW);
+			Benchmark benchmark(&settings);
+			return benchmark.Run(settings.GetString(S_BENCHMARKMODE)) ? 0 : 1;
+		}
+
+		if (settings.GetString(S_FLIGHTRECORDERFILE).empty() == false)
+		{
+			FlightRecorder::Get().Open(settings.GetString(S_FLIGHTRECORDERFILE), settings.GetUInt(S_FLIGHTRECORDEREVENTS));
+		}
+
+		//counters for monitoring, board works without them when port is taken
+		std::unique_ptr<MetricsServer> metricsServer;
+		if (settings.GetUInt(S_METRICSPORT) != 0)
+		{
+			try
+			{
+				metricsServer.reset(new MetricsServer(settings.GetString(S_METRICSADDRESS), (unsigned short)settings.GetUInt(S_METRICSPORT)));
+			}
+			catch (std::exception& e)
+			{
+				LOG_ERROR("Metrics server is not started: {}", e.what());
+			}
+		}
+
 		//initializing Comunication manager
-		FieldsManager manager(settings.GetString(S_COMPORT), 19200, &settings);
+		//deadlines of main cycle, manager and fields, moved by main clock
+		TimerWheel timers;
+		FieldsManager manager(settings.GetString(S_COMPORT), 19200, &settings, &timers);
 
-		//initialize OpenGL system
-		LOG_INFO("Initialize OpenGL");
+		//initialize render backend
 		unsigned int wndW = settings.GetUInt(S_CUSTOMWIDTH);
 		unsigned int wndH = settings.GetUInt(S_CUSTOMHEIGHT);
-		sf::RenderWindow window(sf::VideoMode(wndW, wndH), "VideoWall", sf::Style::None);		
-		sf::Vector2i pos = { 0, 0 };
-		if (settings.GetBool(S_CUSTOMENABLED) == true)
+		std::unique_ptr<sf::RenderWindow> window;
+		std::unique_ptr<RemoteView> remoteView;  //outlives export thread that gives it frames
+		std::unique_ptr<FrameExport> frameExport;  //outlives backend that gives it pixels
+		std::unique_ptr<RenderBackend> backend;
+		SoftwareRenderBackend* softwareBackend = nullptr;
+		TiledRenderBackend* tiledBackend = nullptr;
+		sf::WindowHandle hndl = nullptr;
+		if (settings.GetUInt(S_WALLCOLUMNS) * settings.GetUInt(S_WALLROWS) > 1)
+		{
+			LOG_INFO("Initialize video wall of {0}x{1} tiles", settings.GetUInt(S_WALLCOLUMNS), settings.GetUInt(S_WALLROWS));
+			sf::Vector2i pos = { 0, 0 };
+			if (settings.GetBool(S_CUSTOMENABLED) == true)
+			{
+				pos.x = settings.GetUInt(S_CUSTOMLEFT);
+				pos.y = settings.GetUInt(S_CUSTOMTOP);
+			}
+			tiledBackend = new TiledRenderBackend(wndW, wndH, settings.GetUInt(S_WALLCOLUMNS), settings.GetUInt(S_WALLROWS),
+				settings.GetString(S_RENDERBACKEND) == "software", pos, settings.GetUInt(S_TARGETFPS));
+			backend.reset(tiledBackend);
+		}
+		else if (settings.GetString(S_RENDERBACKEND) == "software")
+		{
+			LOG_INFO("Initialize software renderer");
+			softwareBackend = new SoftwareRenderBackend(wndW, wndH, settings.GetUInt(S_TARGETFPS), settings.GetUInt(S_COMPOSITETHREADS));
+			backend.reset(softwareBackend);
+		}
+		else
+		{
+			LOG_INFO("Initialize OpenGL");
+			window.reset(new sf::RenderWindow(sf::VideoMode(wndW, wndH), "VideoWall", sf::Style::None));
+			sf::Vector2i pos = { 0, 0 };
+			if (settings.GetBool(S_CUSTOMENABLED) == true)
+			{
+				pos.x = settings.GetUInt(S_CUSTOMLEFT);
+				pos.y = settings.GetUInt(S_CUSTOMTOP);
+			}
+			window->setPosition(pos);		
+			window->setMouseCursorVisible(false);
+			window->requestFocus();
+			hndl = window->getSystemHandle();
+
+			//initializing FPS limit
+			if (settings.GetUInt(S_TARGETFPS) != 0)
+			{			
+				if (settings.GetUInt(S_TARGETFPS) == 60)
+				{
+					window->setVerticalSyncEnabled(true);
+					window->setFramerateLimit(0);
+				}
+				else
+				{
+					window->setVerticalSyncEnabled(false);
+					window->setFramerateLimit(settings.GetUInt(S_TARGETFPS));
+				}
+				LOG_DEBUG("Applied FPS limit to window");
+			}	
+
+			backend.reset(new WindowRenderBackend(*window));
+		}
+
+		//publishing shown frames to shared memory, tiles are separate outputs and are not exported
+		if (settings.GetString(S_EXPORTNAME).empty() == false && tiledBackend == nullptr)
+		{
+			try
+			{
+				frameExport.reset(new FrameExport(settings.GetString(S_EXPORTNAME), backend->GetSize().x, backend->GetSize().y,
+					settings.GetUInt(S_EXPORTSLOTS), settings.GetUInt(S_EXPORTEVERYFRAME)));
+			}
+			catch (std::exception& e)
+			{
+				LOG_ERROR("Frame export is off, shared memory failed: {}", e.what());
+			}
+		}
+
+		//changed tiles of exported frames for remote view, export works in process memory when shared memory is off
+		if (settings.GetUInt(S_REMOTEVIEWPORT) != 0 && tiledBackend == nullptr)
 		{
-			pos.x = settings.GetUInt(S_CUSTOMLEFT);
-			pos.y = settings.GetUInt(S_CUSTOMTOP);
+			try
+			{
+				remoteView.reset(new RemoteView(settings.GetString(S_REMOTEVIEWADDRESS), (unsigned short)settings.GetUInt(S_REMOTEVIEWPORT),
+					backend->GetSize().x, backend->GetSize().y, settings.GetUInt(S_REMOTEVIEWTILESIZE), settings.GetUInt(S_REMOTEVIEWKEYFRAME)));
+				if (frameExport == nullptr)
+				{
+					frameExport.reset(new FrameExport("", backend->GetSize().x, backend->GetSize().y, 1, settings.GetUInt(S_EXPORTEVERYFRAME)));
+				}
+				RemoteView* view = remoteView.get();
+				frameExport->SetFrameHandler([view](const sf::Uint8* pixels, uint64_t sequence) { view->EncodeFrame(pixels, sequence); });
+			}
+			catch (std::exception& e)
+			{
+				LOG_ERROR("Remote view is not started: {}", e.what());
+			}
 		}
-		window.setPosition(pos);		
-		window.setMouseCursorVisible(false);
-		window.requestFocus();
-		sf::WindowHandle hndl = window.getSystemHandle();
+		if (frameExport != nullptr) backend->SetFrameExport(frameExport.get());
 
 		//initialize FPS counter
 		LOG_INFO("Initialize fps counter");
-		bool displayFPS = settings.GetBool(S_DISPLAYFPS);
-		uint32_t fpsCount = 0;
-		double fpsTimeElapsed = 0;
+		bool fpsFontLoaded = false;
+		bool displayFPS = false;
+		bool fpsDue = false;
 		uint32_t fpsDrawCalls = 0;
-		sf::Text fpsCounterText;
-		sf::Font fpsFont;
-		if (fpsFont.loadFromFile(settings.GetString(S_DEFAULTFONT)) == true)
+		//rendered the same way as fields, so both backends show the same picture
+		TextRasterizer fpsRasterizer;
+		TextCacheKey fpsKey;
+		fpsKey.fontName = settings.GetString(S_DEFAULTFONT);
+		fpsKey.textSize = 30;
+		fpsKey.textStyle = sf::Text::Style::Regular;
+		fpsKey.textColor = sf::Color::White.toInteger();
+		fpsKey.bgColor = sf::Color::Transparent.toInteger();
+		fpsKey.width = 100;
+		fpsKey.height = 40;
+		fpsKey.displayType = LDPField::DisplayType::RightAlign;
+		const sf::Vector2f fpsPos((float)backend->GetSize().x - fpsKey.width - 6, 0);
+		std::shared_ptr<RenderedText> fpsCounterText;
+		if (TextRasterizer::CheckFont(fpsKey.fontName) == true)
 		{
-			fpsCounterText.setFont(fpsFont);
-			fpsCounterText.setCharacterSize(30);
-			fpsCounterText.setFillColor(sf::Color::White);
-			fpsCounterText.setString(L"000");
-			sf::FloatRect fpsPos = fpsCounterText.getGlobalBounds();
-			fpsCounterText.setPosition(window.getSize().x - fpsPos.width - 10, 0);
+			fpsKey.text = sf::String(L"000").toUtf32();
+			fpsCounterText = fpsRasterizer.Render(fpsKey);
+			fpsFontLoaded = true;
+			displayFPS = settings.GetSnapshot().displayFPS;
 			LOG_DEBUG("Font initialization for fps counter complete");
 		}
 		else
 		{
-			displayFPS = false;
 			LOG_ERROR("ERROR!!! Font initialization for fps counter failed");
 		}		
 
-		//initializing FPS limit
-		if (settings.GetUInt(S_TARGETFPS) != 0)
-		{			
-			if (settings.GetUInt(S_TARGETFPS) == 60)
-			{
-				window.setVerticalSyncEnabled(true);
-				window.setFramerateLimit(0);
-			}
-			else
-			{
-				window.setVerticalSyncEnabled(false);
-				window.setFramerateLimit(settings.GetUInt(S_TARGETFPS));
-			}
-			LOG_DEBUG("Applied FPS limit to window");
-		}	
+		//initialize software backend snapshots
+		const sf::Int64 SNAPSHOT_TIMEOUT = sf::Int64(settings.GetUInt(S_SNAPSHOTINTERVAL)) * 1000000;  //microseconds
 
 		//initialize main clock
 		//sf::Clock clock;
@@ -144,23 +269,33 @@ int main(int argc, char* argv[])
 		//sf::Int64 timeElapsed = 0;
 		sf::Uint64 elapsedMicro = 0;
 
-		//initialize timer to set window to foreground
-		//sf::Time foregroundElapsed;
-		//const sf::Time FOREGROUND_TIMEOUT = sf::seconds(60);	
-		sf::Int64 foregroundElapsed = 0;  //microseconds
+		//main cycle timers only raise flags, the cycle does the work at the same place as before
+		bool forceRedraw = false;
+		bool bringToForeground = false;
+		bool logStatistics = false;
+		const char* statisticsReason = nullptr;  //not null when statistics are to be logged, kept until next frame is shown
+		bool saveSnapshot = false;
 		const sf::Int64 FOREGROUND_TIMEOUT = 60 * 1000000;  //microseconds
-
-		//initialize timer to force screen update
-		//sf::Time forceRedrawElapsed;
-		//const sf::Time FORCEREDRAW_TIMEOUT = sf::seconds(1);
-		sf::Int64 forceRedrawElapsed = 0;  //microseconds
 		const sf::Int64 FORCEREDRAW_TIMEOUT = 1 * 1000000;  //microseconds
-
-		//initialize timer to reset all timers
-		//sf::Time forceResetTimersElapsed;
-		//const sf::Time FORCERESETTIMERS_TIMEOUT = sf::seconds(1800);
-		sf::Int64 forceResetTimersElapsed = 0;
-		const sf::Int64 FORCERESETTIMERS_TIMEOUT = 1800 * 1000000;  //microseconds
+		const sf::Int64 STATISTICS_TIMEOUT = sf::Int64(settings.GetUInt(S_STATISTICSINTERVAL)) * 1000000;  //microseconds
+		timers.SchedulePeriodic(FORCEREDRAW_TIMEOUT, [&] { forceRedraw = true; });
+		if (window != nullptr || tiledBackend != nullptr) timers.SchedulePeriodic(FOREGROUND_TIMEOUT, [&] { bringToForeground = true; });
+		timers.SchedulePeriodic(1000000, [&] { fpsDue = true; });
+		timers.SchedulePeriodic(1000000, [] { FlightRecorder::Get().Calibrate(); });
+		timers.SchedulePeriodic(1000000, [&]
+		{
+			TextCache::Statistics cache = manager.GetTextCacheStatistics();
+			Metrics::Set(Metrics::FieldCount, manager.GetFieldCount());
+			Metrics::Set(Metrics::RenderPending, manager.GetRenderPendingCount());
+			Metrics::Set(Metrics::TextCacheBytes, cache.memoryUsed);
+			Metrics::Set(Metrics::TextCacheEntries, cache.entries);
+			Metrics::Set(Metrics::FallbackShown, manager.IsFallbackShown() ? 1 : 0);
+		});
+		if (STATISTICS_TIMEOUT != 0) timers.SchedulePeriodic(STATISTICS_TIMEOUT, [&] { logStatistics = true; });
+		if ((softwareBackend != nullptr || tiledBackend != nullptr) && SNAPSHOT_TIMEOUT != 0) timers.SchedulePeriodic(SNAPSHOT_TIMEOUT, [&] { saveSnapshot = true; });
+
+		//initialize frame time statistics
+		FrameProfiler profiler;
 
 #ifdef CUSTOM_DEBUGBUILD
 		//manager.ExecuteExternalCommand("%040102500501004%10$1F$00$60$t3$f1FFFF00$h1FF0000$TF$HF$u3F");
@@ -205,14 +340,27 @@ int main(int argc, char* argv[])
 		//bool forceLogAfterSkip = false;
 		//bool forceLogDraw = false;
 
+		//saved settings file changes log level, FPS display and manager settings without restart
+		uint64_t appliedSettingsVersion = settings.GetSnapshot().version;
+		if (settings.GetBool(S_WATCHSETTINGS)) settings.StartWatching();
+
 		LOG_INFO("Entering main cycle");
 		bool running = true;
 		while (running)
 		{
+			const SettingsSnapshot& liveSettings = settings.GetSnapshot();
+			if (liveSettings.version != appliedSettingsVersion)
+			{
+				appliedSettingsVersion = liveSettings.version;
+				vw::Log::SetLogLevel((spdlog::level::level_enum)liveSettings.logLevel);
+				displayFPS = fpsFontLoaded && liveSettings.displayFPS;
+			}
+
 			bool forceLog = false;
+			profiler.Restart();
 
 			sf::Event event;
-			while (window.pollEvent(event))
+			while ((window != nullptr && window->pollEvent(event)) || (tiledBackend != nullptr && tiledBackend->PollEvent(event)))
 			{
 				if (event.type == sf::Event::Closed)
 				{
@@ -224,6 +372,10 @@ int main(int argc, char* argv[])
 					{
 						running = false;
 					}
+					if (event.key.code == sf::Keyboard::F9)
+					{
+						statisticsReason = "on demand";
+					}
 					/*if (event.key.code == sf::Keyboard::F1)
 					{
 						forceLog = true;
@@ -237,6 +389,7 @@ int main(int argc, char* argv[])
 					}*/
 				}
 			}	
+			profiler.Mark(FrameProfiler::EventPoll);
 
 			/*if (forceLog)
 			{
@@ -255,6 +408,7 @@ int main(int argc, char* argv[])
 			//timeElapsed = timeNow - timePrev;  //in microseconds			
 			if (clockMainNow.QuadPart < clockMainPrev.QuadPart)
 			{
+				FlightRecorder::Get().Record(FlightEvent::ClockBackwards, 0, clockMainPrev.QuadPart - clockMainNow.QuadPart);
 				clockMainElapsed.QuadPart = 0;
 				LOG_DEBUG("WARNING!!! clockMainElapsed is wrong, clockMainNow={0}, clockMainPrev={1}", clockMainNow.QuadPart, clockMainPrev.QuadPart);
 			}
@@ -267,38 +421,16 @@ int main(int argc, char* argv[])
 			//sf::Int64 elapsedMicro = elapsed.asMicroseconds();
 			elapsedMicro = static_cast<sf::Uint64>(clockMainElapsed.QuadPart * clockReverseFreq);
 
-			//move timers
-			foregroundElapsed += elapsedMicro;
-			forceRedrawElapsed += elapsedMicro;
-			forceResetTimersElapsed += elapsedMicro;
-			//fpsTimeElapsed += elapsed.asSeconds();
-			fpsTimeElapsed += elapsedMicro / 1000000.0;
-
-			/*if (forceLog)
-			{
-				//LOG_DEBUG("Timers after QuerryCounter: timeNow={0}, timePrev={1}, timeElapsed={2}, elapsedMicro={3}, foregroundElapsed={4}, forceRedrawElapsed={5}, forceResetTimersElapsed={6}, fpsTimeElapsed={7}", timeNow, timePrev, timeElapsed, elapsedMicro, foregroundElapsed, forceRedrawElapsed, forceResetTimersElapsed, fpsTimeElapsed);
-				LOG_DEBUG("Timers after QuerryCounter: clockMainNow={0}, clockMainPrev={1}, clockMainElapsed={2}, elapsedMicro={3}, foregroundElapsed={4}, forceRedrawElapsed={5}, forceResetTimersElapsed={6}, fpsTimeElapsed={7}, clockFreq={8}, clockReverseFreq={9}", clockMainNow.QuadPart, clockMainPrev.QuadPart, clockMainElapsed.QuadPart, elapsedMicro, foregroundElapsed, forceRedrawElapsed, forceResetTimersElapsed, fpsTimeElapsed, clockFreq.QuadPart, clockReverseFreq);
-				LOG_DEBUG("Timeouts: FOREGROUND_TIMEOUT={0}, FORCEREDRAW_TIMEOUT={1}, FORCERESETTIMERS_TIMEOUT={2}", FOREGROUND_TIMEOUT, FORCEREDRAW_TIMEOUT, FORCERESETTIMERS_TIMEOUT);
-			}*/
-
-			//reset all timers			
-			if (forceResetTimersElapsed > FORCERESETTIMERS_TIMEOUT)
-			{
-				//LOG_DEBUG("Force timer reset timer enter, elapsedMicroseconds={0}, clockElapsedMicroseconds={1}", elapsedMicro, clock.getElapsedTime().asMicroseconds());
-				foregroundElapsed = 0;
-				forceRedrawElapsed = 0;
-				forceResetTimersElapsed = 0;
-				fpsTimeElapsed = 0;
-				manager.ResetTimers();
-			}
+			//fires due timers of cycle, running text and clocks
+			timers.Advance(elapsedMicro);
 
-			//failed after 11 days and 4 hours
-			bool updated = manager.UpdateFields(elapsedMicro, forceLog);
+			bool updated = manager.UpdateFields(*backend, elapsedMicro, forceLog);
+			profiler.Mark(FrameProfiler::Update);
 			//if (forceLog) LOG_DEBUG("Before skip condition, updated={0}, forceRedrawElapsed={1}, FORCEREDRAW_TIMEOUT={2}", updated, forceRedrawElapsed, FORCEREDRAW_TIMEOUT);
 			//if (forceLogDraw == false) {
-				if ((updated == false) && (forceRedrawElapsed < FORCEREDRAW_TIMEOUT))					
+				if ((updated == false) && (forceRedraw == false))					
 				{
-					if (forceLog) LOG_DEBUG("Got into skip condition");
+					if (forceLog) LOG_HOT_DEBUG("Got into skip condition");
 					std::this_thread::yield();
 					continue;
 				}
@@ -308,40 +440,80 @@ int main(int argc, char* argv[])
 			//if (forceLogAfterSkip) LOG_DEBUG("Got after skip, clockMainNow={0}, clockMainPrev={1}, clockMainElapsed={2}, elapsedMicro={3}, foregroundElapsed={4}, forceRedrawElapsed={5}, forceResetTimersElapsed={6}, fpsTimeElapsed={7}, clockFreq={8}, clockReverseFreq={9}", clockMainNow.QuadPart, clockMainPrev.QuadPart, clockMainElapsed.QuadPart, elapsedMicro, foregroundElapsed, forceRedrawElapsed, forceResetTimersElapsed, fpsTimeElapsed, clockFreq.QuadPart, clockReverseFreq);
 
 			//restart redraw timer
-			if (forceRedrawElapsed >= FORCEREDRAW_TIMEOUT) forceRedrawElapsed -= FORCEREDRAW_TIMEOUT;
+			forceRedraw = false;
 
 			//move to foreground timer			
-			if (foregroundElapsed > FOREGROUND_TIMEOUT)
+			if (bringToForeground)
 			{
 				LOG_DEBUG("Set to foreground timer enter");
-				foregroundElapsed -= FOREGROUND_TIMEOUT;
+				bringToForeground = false;
 				//window.requestFocus();
-				SetWindowPos(hndl, HWND_TOPMOST, 0, 0, 0, 0, SWP_SHOWWINDOW | SWP_NOMOVE | SWP_NOSIZE);
-				SetForegroundWindow(hndl);
-				SetActiveWindow(hndl);
-				RedrawWindow(hndl, NULL, NULL, RDW_FRAME | RDW_INVALIDATE | RDW_ALLCHILDREN);
+				if (tiledBackend != nullptr) tiledBackend->BringToForeground();
+				else
+				{
+					SetWindowPos(hndl, HWND_TOPMOST, 0, 0, 0, 0, SWP_SHOWWINDOW | SWP_NOMOVE | SWP_NOSIZE);
+					SetForegroundWindow(hndl);
+					SetActiveWindow(hndl);
+					RedrawWindow(hndl, NULL, NULL, RDW_FRAME | RDW_INVALIDATE | RDW_ALLCHILDREN);
+				}
 				LOG_DEBUG("Set to foreground timer exit");
 			}
 
 			//if (forceLogAfterSkip) LOG_DEBUG("Before drawing");
+			profiler.Restart();
 
-			window.clear();	
-			manager.DrawFields(window);
+			//tiles and software compositing draw field bitmaps in Flush, fields must not change until it returns.
+			//Frame limit wait in Display runs unlocked, so commands and timers are not held up by it
+			std::unique_lock<std::recursive_mutex> fieldsLock;
+			if (tiledBackend != nullptr || softwareBackend != nullptr) fieldsLock = manager.LockFields();
+
+			backend->Clear(sf::Color::Black);	
+			manager.DrawFields(*backend);
 			fpsDrawCalls++;
 
 			//fpscounter
 			if (displayFPS)
 			{							
-				if (fpsTimeElapsed > 1)
+				if (fpsDue)
 				{
-					fpsTimeElapsed -= 1;
-					fpsCounterText.setString(std::to_wstring(fpsDrawCalls));					
+					fpsDue = false;
+					fpsKey.text = sf::String(std::to_wstring(fpsDrawCalls)).toUtf32();
+					fpsCounterText = fpsRasterizer.Render(fpsKey);
 					fpsDrawCalls = 0;
 				}
-				window.draw(fpsCounterText);
+				backend->PrepareBitmap(*fpsCounterText);
+				backend->DrawBitmap(*fpsCounterText, sf::IntRect(0, 0, fpsCounterText->width, fpsCounterText->height), fpsPos);
+			}
+
+			profiler.Mark(FrameProfiler::Draw);
+
+			backend->Flush();
+			if (fieldsLock.owns_lock()) fieldsLock.unlock();
+			backend->Display();	
+			profiler.Mark(FrameProfiler::Display);
+			profiler.FrameShown();
+
+			//frame time and running text statistics
+			if (logStatistics)
+			{
+				logStatistics = false;
+				statisticsReason = "periodic";
+			}
+			if (statisticsReason != nullptr)
+			{
+				profiler.LogSummary(statisticsReason);
+				manager.LogScrollStatistics();
+				profiler.Reset();
+				statisticsReason = nullptr;
 			}
 
-			window.display();	
+			//saving rendered frame
+			if (saveSnapshot)
+			{
+				saveSnapshot = false;
+				if (tiledBackend != nullptr) tiledBackend->SaveToFiles(settings.GetString(S_SNAPSHOTFILE));
+				else softwareBackend->SaveToFile(settings.GetString(S_SNAPSHOTFILE));
+			}
 
 			//if (forceLogAfterSkip) LOG_DEBUG("After drawing");
 
@@ -351,16 +523,20 @@ int main(int argc, char* argv[])
 		LOG_INFO("Main cicle exit");
 		//show console to know when program ends
 		ShowWindow(GetConsoleWindow(), SW_SHOW);
-		window.close();
+		//pixel buffers of export belong to window context
+		backend->SetFrameExport(nullptr);
+		if (window != nullptr) window->close();
 	}
 	catch (std::exception& e)
 	{
 		LOG_CRITICAL("Exception in main with message: {0}", e.what());
+		FlightRecorder::Get().RecordText(FlightEvent::Exception, 1, e.what(), 64);
 		return 1;
 	}
 	catch (...)
 	{
 		LOG_CRITICAL("Exception of unknown type in main, exiting");
+		FlightRecorder::Get().RecordText(FlightEvent::Exception, 1, "unknown type", 64);
 		return 1;
 	}
     
@@ -0,0 +1,200 @@
+#include "WindowRenderBackend.h"
+#include "Log.h"
+#include "Metrics.h"
+#include <SFML/OpenGL.hpp>
+
+//pixel buffer objects are OpenGL 2.1, gl.h of Windows has only 1.1
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#define GL_STREAM_READ 0x88E1
+#define GL_READ_ONLY 0x88B8
+#endif
+
+struct PixelBufferFunctions
+{
+	void (APIENTRY *genBuffers)(GLsizei count, GLuint* buffers);
+	void (APIENTRY *deleteBuffers)(GLsizei count, const GLuint* buffers);
+	void (APIENTRY *bindBuffer)(GLenum target, GLuint buffer);
+	void (APIENTRY *bufferData)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+	void* (APIENTRY *mapBuffer)(GLenum target, GLenum access);
+	GLboolean (APIENTRY *unmapBuffer)(GLenum target);
+};
+
+static PixelBufferFunctions gl = {};
+
+//needs active context, false if driver has no pixel buffer objects
+static bool LoadPixelBufferFunctions()
+{
+	gl.genBuffers = reinterpret_cast<decltype(gl.genBuffers)>(sf::Context::getFunction("glGenBuffers"));
+	gl.deleteBuffers = reinterpret_cast<decltype(gl.deleteBuffers)>(sf::Context::getFunction("glDeleteBuffers"));
+	gl.bindBuffer = reinterpret_cast<decltype(gl.bindBuffer)>(sf::Context::getFunction("glBindBuffer"));
+	gl.bufferData = reinterpret_cast<decltype(gl.bufferData)>(sf::Context::getFunction("glBufferData"));
+	gl.mapBuffer = reinterpret_cast<decltype(gl.mapBuffer)>(sf::Context::getFunction("glMapBuffer"));
+	gl.unmapBuffer = reinterpret_cast<decltype(gl.unmapBuffer)>(sf::Context::getFunction("glUnmapBuffer"));
+	return gl.genBuffers != nullptr && gl.deleteBuffers != nullptr && gl.bindBuffer != nullptr &&
+		gl.bufferData != nullptr && gl.mapBuffer != nullptr && gl.unmapBuffer != nullptr;
+}
+
+WindowRenderBackend::WindowRenderBackend(sf::RenderWindow & window) :
+	m_window(window),
+	m_sprite(),
+	m_frameExport(nullptr),
+	m_pixelBuffers(),
+	m_pixelBufferStates(),
+	m_pixelBufferFrames(),
+	m_frameCount(0)
+{
+	LOG_DEBUG("Window render backend created");
+}
+
+WindowRenderBackend::~WindowRenderBackend()
+{
+	//buffers are released with context if export was not stopped before window closed
+	if (m_frameExport != nullptr) m_frameExport->WaitIdle();
+}
+
+void WindowRenderBackend::PrepareBitmap(Bitmap & bitmap)
+{
+	Metrics::Add(Metrics::TextureUploadBytes, UploadBitmap(bitmap));
+}
+
+size_t WindowRenderBackend::UploadBitmap(Bitmap & bitmap)
+{
+	//pixels are not needed after upload
+	if (bitmap.pixels.empty()) return 0;
+	const size_t uploaded = size_t(bitmap.width) * bitmap.height * 4;
+
+	if (bitmap.streamed)
+	{
+		//same buffer gets next frame, only changed texture is uploaded
+		if (bitmap.texture.getSize() != sf::Vector2u(bitmap.width, bitmap.height)) bitmap.texture.create(bitmap.width, bitmap.height);
+		bitmap.texture.update(bitmap.pixels.data());
+		return uploaded;
+	}
+
+	bitmap.texture.create(bitmap.width, bitmap.height);
+	bitmap.texture.update(bitmap.pixels.data());
+	bitmap.texture.setRepeated(bitmap.repeated);
+	std::vector<sf::Uint8>().swap(bitmap.pixels);
+	return uploaded;
+}
+
+void WindowRenderBackend::Clear(const sf::Color & color)
+{
+	m_window.clear(color);
+}
+
+void WindowRenderBackend::DrawBitmap(const Bitmap & bitmap, const sf::IntRect & source, const sf::Vector2f & position)
+{
+	m_sprite.setTexture(bitmap.texture);
+	m_sprite.setTextureRect(source);
+	m_sprite.setPosition(position);
+	m_sprite.setScale(1, 1);
+	m_window.draw(m_sprite);
+}
+
+void WindowRenderBackend::DrawBitmapScaled(const Bitmap & bitmap, const sf::FloatRect & destination)
+{
+	m_sprite.setTexture(bitmap.texture, true);
+	m_sprite.setPosition(destination.left, destination.top);
+	m_sprite.setScale(destination.width / bitmap.width, destination.height / bitmap.height);
+	m_window.draw(m_sprite);
+}
+
+void WindowRenderBackend::Display()
+{
+	//back buffer is read before it is swapped
+	if (m_frameExport != nullptr) ReadBackFrame();
+	m_window.display();
+}
+
+sf::Vector2u WindowRenderBackend::GetSize() const
+{
+	return m_window.getSize();
+}
+
+void WindowRenderBackend::SetFrameExport(FrameExport * frameExport)
+{
+	if (m_frameExport != nullptr) ReleasePixelBuffers();
+	m_frameExport = nullptr;
+	if (frameExport == nullptr) return;
+
+	if (LoadPixelBufferFunctions() == false)
+	{
+		LOG_ERROR("Frame export is off, OpenGL driver has no pixel buffer objects");
+		return;
+	}
+	sf::Vector2u size = m_window.getSize();
+	gl.genBuffers(PIXEL_BUFFER_COUNT, m_pixelBuffers);
+	for (int i = 0; i < PIXEL_BUFFER_COUNT; i++)
+	{
+		gl.bindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffers[i]);
+		gl.bufferData(GL_PIXEL_PACK_BUFFER, ptrdiff_t(size.x) * size.y * 4, nullptr, GL_STREAM_READ);
+		m_pixelBufferStates[i] = Free;
+	}
+	gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_frameExport = frameExport;
+}
+
+void WindowRenderBackend::ReadBackFrame()
+{
+	m_frameCount++;
+	bool exportBusy = m_frameExport->IsBusy();
+	int oldestReading = -1;
+	for (int i = 0; i < PIXEL_BUFFER_COUNT; i++)
+	{
+		if (m_pixelBufferStates[i] == Exporting && exportBusy == false)
+		{
+			gl.bindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffers[i]);
+			gl.unmapBuffer(GL_PIXEL_PACK_BUFFER);
+			m_pixelBufferStates[i] = Free;
+		}
+		if (m_pixelBufferStates[i] == Reading && (oldestReading < 0 || m_pixelBufferFrames[i] < m_pixelBufferFrames[oldestReading])) oldestReading = i;
+	}
+
+	//frame read on one of previous Display calls is in buffer by now, so mapping does not wait for GPU
+	if (oldestReading >= 0 && exportBusy == false)
+	{
+		gl.bindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffers[oldestReading]);
+		const sf::Uint8* pixels = static_cast<const sf::Uint8*>(gl.mapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+		if (pixels != nullptr)
+		{
+			m_frameExport->Publish(pixels, true);
+			m_pixelBufferStates[oldestReading] = Exporting;
+		}
+		else m_pixelBufferStates[oldestReading] = Free;
+	}
+
+	if (m_frameExport->IsFrameDue())
+	{
+		int freeBuffer = -1;
+		for (int i = 0; i < PIXEL_BUFFER_COUNT && freeBuffer < 0; i++)
+		{
+			if (m_pixelBufferStates[i] == Free) freeBuffer = i;
+		}
+		if (freeBuffer >= 0)
+		{
+			//returns at once, GPU copies into buffer while next frame is prepared
+			sf::Vector2u size = m_window.getSize();
+			gl.bindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffers[freeBuffer]);
+			glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			m_pixelBufferStates[freeBuffer] = Reading;
+			m_pixelBufferFrames[freeBuffer] = m_frameCount;
+		}
+		else m_frameExport->SkipFrame();
+	}
+	gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void WindowRenderBackend::ReleasePixelBuffers()
+{
+	m_frameExport->WaitIdle();
+	for (int i = 0; i < PIXEL_BUFFER_COUNT; i++)
+	{
+		if (m_pixelBufferStates[i] != Exporting) continue;
+		gl.bindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffers[i]);
+		gl.unmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	gl.deleteBuffers(PIXEL_BUFFER_COUNT, m_pixelBuffers);
+}
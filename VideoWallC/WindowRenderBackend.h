@@ -0,0 +1,44 @@
+#pragma once
+#include "RenderBackend.h"
+#include "FrameExport.h"
+
+class WindowRenderBackend : public RenderBackend
+{
+public:
+	WindowRenderBackend(sf::RenderWindow& window);
+	~WindowRenderBackend();
+
+	void PrepareBitmap(Bitmap& bitmap) override;
+	//texture upload without counting it in metrics, returns bytes uploaded
+	size_t UploadBitmap(Bitmap& bitmap);
+
+	void Clear(const sf::Color& color) override;
+	void DrawBitmap(const Bitmap& bitmap, const sf::IntRect& source, const sf::Vector2f& position) override;
+	void DrawBitmapScaled(const Bitmap& bitmap, const sf::FloatRect& destination) override;
+	void Display() override;
+
+	sf::Vector2u GetSize() const override;
+	//frames are read back into pixel buffers and given to export one frame later, so GPU is never waited for.
+	//Call with nullptr while window is still open, buffers belong to its context
+	void SetFrameExport(FrameExport* frameExport) override;
+
+private:
+	enum PixelBufferState
+	{
+		Free,
+		Reading,	//GPU copies frame into buffer
+		Exporting	//mapped, export thread copies it
+	};
+	static const int PIXEL_BUFFER_COUNT = 2;
+
+	void ReadBackFrame();
+	void ReleasePixelBuffers();
+
+	sf::RenderWindow& m_window;
+	sf::Sprite m_sprite;
+	FrameExport* m_frameExport;
+	unsigned int m_pixelBuffers[PIXEL_BUFFER_COUNT];
+	PixelBufferState m_pixelBufferStates[PIXEL_BUFFER_COUNT];
+	uint64_t m_pixelBufferFrames[PIXEL_BUFFER_COUNT];  //order of reading
+	uint64_t m_frameCount;
+};